@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+/**
+ * Micro benchmarks for drawings (annotations).
+ *
+ * Builds a PathContainer with N strokes of M points, using BasicGraphicsPath
+ * (fixed width pen) or FullGraphicsPath (pressure sensitive pen), and
+ * measures:
+ * - appending strokes (one history step per stroke),
+ * - undo and redo chains over the full history,
+ * - PathContainer::copy (used in cumulative overlay mode),
+ * - writeXml and loadDrawings round trip,
+ * - painting all strokes to an offscreen QImage,
+ * - an eraser sweep through the page (eraserMicroStep, applyMicroStep).
+ * Results are printed as "type.NxM.name value unit" lines.
+ *
+ * Usage: bench-drawing [options], see --help.
+ * Without a display, set QT_QPA_PLATFORM=offscreen (this is the default
+ * here if the variable is not set).
+ */
+
+#include <QApplication>
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QGraphicsScene>
+#include <QImage>
+#include <QList>
+#include <QPainter>
+#include <QPen>
+#include <QPointF>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QStyleOptionGraphicsItem>
+#include <QTemporaryDir>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <cstdio>
+#include <utility>
+
+#include "src/config.h"
+#include "src/drawing/abstractgraphicspath.h"
+#include "src/drawing/basicgraphicspath.h"
+#include "src/drawing/drawtool.h"
+#include "src/drawing/fullgraphicspath.h"
+#include "src/drawing/pathcontainer.h"
+#include "src/preferences.h"
+
+namespace
+{
+/// Page size of beamer with aspect ratio 16:9 in points.
+constexpr qreal page_width = 453.54, page_height = 255.12;
+/// Width of the image used for painting in pixels.
+constexpr int image_width = 1920;
+/// Number of eraser positions in a sweep through the page.
+constexpr int eraser_steps = 200;
+
+/// Create path with given number of points as random walk.
+AbstractGraphicsPath *random_path(QRandomGenerator &random, const bool full,
+                                  const int points)
+{
+  QVector<QPointF> coordinates(points);
+  QVector<float> pressures(points);
+  QPointF point(page_width * random.generateDouble(),
+                page_height * random.generateDouble());
+  for (int i = 0; i < points; ++i) {
+    point += QPointF(4 * random.generateDouble() - 2,
+                     4 * random.generateDouble() - 2);
+    coordinates[i] = point;
+    pressures[i] = 0.5 + 0.5 * random.generateDouble();
+  }
+  const QPen pen(QColor::fromRgb(random.bounded(256), random.bounded(256),
+                                 random.bounded(256)),
+                 2, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin);
+  if (full)
+    return new FullGraphicsPath(DrawTool(Tool::Pen, Tool::AnyDevice, pen),
+                                coordinates, pressures);
+  return new BasicGraphicsPath(
+      DrawTool(Tool::FixedWidthPen, Tool::AnyDevice, pen), coordinates);
+}
+
+double ms(const qint64 ns) { return 1e-6 * ns; }
+
+void print_value(const QString &name, const double value, const char *unit)
+{
+  std::printf("%s %.6g %s\n", qPrintable(name), value, unit);
+}
+
+void bench(const bool full, const int strokes, const int points)
+{
+  const QString prefix = QString("%1.%2x%3.")
+                             .arg(full ? "full" : "basic")
+                             .arg(strokes)
+                             .arg(points);
+  QRandomGenerator random(42);
+  QList<QGraphicsItem *> items;
+  for (int i = 0; i < strokes; ++i)
+    items.append(random_path(random, full, points));
+
+  QGraphicsScene scene(0, 0, page_width, page_height);
+  auto container = new PathContainer();
+  QElapsedTimer timer;
+
+  // Append strokes as they would be drawn: one history step per stroke.
+  timer.start();
+  for (const auto item : std::as_const(items)) {
+    container->appendForeground(item);
+    scene.addItem(item);
+  }
+  print_value(prefix + "append", ms(timer.nsecsElapsed()), "ms");
+
+  // Undo and redo as many steps as the history allows.
+  int steps = 0;
+  timer.start();
+  while (container->undo(&scene)) ++steps;
+  const qint64 undo_ns = timer.nsecsElapsed();
+  timer.start();
+  for (int i = 0; i < steps; ++i) container->redo(&scene);
+  const qint64 redo_ns = timer.nsecsElapsed();
+  print_value(prefix + "history_steps", steps, "count");
+  if (steps > 0) {
+    print_value(prefix + "undo_step", ms(undo_ns) / steps, "ms");
+    print_value(prefix + "redo_step", ms(redo_ns) / steps, "ms");
+  }
+
+  // Copy as in cumulative overlay mode.
+  timer.start();
+  const PathContainer *copy = container->copy();
+  print_value(prefix + "copy", ms(timer.nsecsElapsed()), "ms");
+  timer.start();
+  delete copy;
+  print_value(prefix + "copy_delete", ms(timer.nsecsElapsed()), "ms");
+
+  // Round trip through XML.
+  QByteArray xml;
+  {
+    QBuffer buffer(&xml);
+    buffer.open(QBuffer::WriteOnly);
+    timer.start();
+    QXmlStreamWriter writer(&buffer);
+    writer.writeStartElement("layer");
+    container->writeXml(writer);
+    writer.writeEndElement();
+    print_value(prefix + "write_xml", ms(timer.nsecsElapsed()), "ms");
+  }
+  print_value(prefix + "xml_size", xml.size(), "bytes");
+  {
+    auto loaded = new PathContainer();
+    timer.start();
+    QXmlStreamReader reader(xml);
+    reader.readNextStartElement();
+    loaded->loadDrawings(reader);
+    print_value(prefix + "load_xml", ms(timer.nsecsElapsed()), "ms");
+    delete loaded;
+  }
+
+  // Paint all strokes to an image as in PdfMaster::paintDrawings.
+  {
+    const qreal resolution = image_width / page_width;
+    QImage image(image_width, qRound(resolution * page_height),
+                 QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    QStyleOptionGraphicsItem style;
+    timer.start();
+    for (const auto item : *container) {
+      painter.resetTransform();
+      painter.scale(resolution, resolution);
+      painter.setTransform(item->sceneTransform(), true);
+      item->paint(&painter, &style);
+    }
+    print_value(prefix + "paint", ms(timer.nsecsElapsed()), "ms");
+  }
+
+  // Eraser sweep horizontally through the middle of the page.
+  container->startMicroStep();
+  timer.start();
+  for (int i = 0; i < eraser_steps; ++i)
+    container->eraserMicroStep(
+        {page_width * i / (eraser_steps - 1), page_height / 2}, 10.);
+  print_value(prefix + "eraser_micro_step",
+              ms(timer.nsecsElapsed()) / eraser_steps, "ms");
+  timer.start();
+  container->applyMicroStep();
+  print_value(prefix + "eraser_apply", ms(timer.nsecsElapsed()), "ms");
+
+  // The container owns the items and must be deleted before the scene.
+  delete container;
+}
+
+QList<int> int_list(const QString &string)
+{
+  QList<int> list;
+  for (const auto &item : string.split(','))
+    if (item.toInt() > 0) list.append(item.toInt());
+  return list;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Drawing benchmark for BeamerPresenter");
+  parser.addHelpOption();
+  parser.addOptions({
+      {"strokes", "comma separated numbers of strokes", "list",
+       "100,1000,5000"},
+      {"points", "comma separated numbers of points per stroke", "list",
+       "20,200"},
+      {"types", "comma separated path types (basic,full)", "list",
+       "basic,full"},
+  });
+  parser.process(app);
+
+  QTemporaryDir tmp;
+  if (!tmp.isValid()) qFatal("Cannot create temporary directory");
+  // Use an empty configuration file and defaults for all settings.
+  GlobalPreferences::initialize(tmp.filePath("beamerpresenter.conf"));
+
+  const QStringList types = parser.value("types").split(',');
+  for (const int strokes : int_list(parser.value("strokes")))
+    for (const int points : int_list(parser.value("points"))) {
+      if (types.contains("basic")) bench(false, strokes, points);
+      if (types.contains("full")) bench(true, strokes, points);
+    }
+
+  delete preferences();
+  return 0;
+}
@@ -0,0 +1,481 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+/**
+ * Benchmark for rendering PDF pages with synthetic presentations.
+ *
+ * Generates reproducible PDF files ("decks") with QPdfWriter:
+ * - vector: many curves and some text on every page,
+ * - image: incompressible raster images on every page,
+ * - overlay: slides which are built up in several overlay steps,
+ * - huge: a large number of simple pages.
+ *
+ * For every deck and every compiled PDF engine (and optionally an external
+ * renderer) this measures the time for opening the document, the render
+ * latency per page, PNG encoding and decoding times as used by PixCache,
+ * and the hit rate and memory usage of a PixCache while navigating through
+ * the deck. Results are printed as "deck.backend.name value unit" lines.
+ *
+ * Usage: beamerpresenter-bench [options], see --help.
+ * Without a display, set QT_QPA_PLATFORM=offscreen (this is the default
+ * here if the variable is not set).
+ */
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QImage>
+#include <QList>
+#include <QPageSize>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPdfWriter>
+#include <QPixmap>
+#include <QRandomGenerator>
+#include <QSizeF>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <utility>
+
+#include "src/config.h"
+#include "src/enumerates.h"
+#include "src/preferences.h"
+#include "src/rendering/abstractrenderer.h"
+#include "src/rendering/pdfdocument.h"
+#include "src/rendering/pixcache.h"
+#include "src/rendering/pngpixmap.h"
+#ifdef USE_MUPDF
+#include "src/rendering/mupdfdocument.h"
+#endif
+#ifdef USE_POPPLER
+#include "src/rendering/popplerdocument.h"
+#endif
+#ifdef USE_QTPDF
+#include "src/rendering/qtdocument.h"
+#endif
+#ifdef USE_EXTERNAL_RENDERER
+#include "src/rendering/externalrenderer.h"
+#endif
+
+namespace
+{
+/// Page size of beamer with aspect ratio 16:9 in points.
+constexpr qreal page_width = 453.54, page_height = 255.12;
+/// Number of overlay steps per slide in the overlay deck.
+constexpr int overlay_steps = 8;
+
+/// Global preferences, set in main() which has write access.
+Preferences *writable_preferences = nullptr;
+
+struct Options {
+  int pages;
+  int huge_pages;
+  int samples;
+  int steps;
+  int dwell_ms;
+  int threads;
+  float memory;
+  QSizeF frame;
+  QString external_command;
+  QStringList external_arguments;
+};
+
+struct Backend {
+  const char *name;
+  PdfEngine engine;
+  bool external;
+};
+
+QPointF random_point(QRandomGenerator &random)
+{
+  return {page_width * random.generateDouble(),
+          page_height * random.generateDouble()};
+}
+
+QColor random_color(QRandomGenerator &random)
+{
+  return QColor::fromRgb(random.bounded(256), random.bounded(256),
+                         random.bounded(256));
+}
+
+/// Image filled with random pixels, which cannot be compressed.
+QImage noise_image(QRandomGenerator &random, const int width,
+                   const int height)
+{
+  QImage image(width, height, QImage::Format_RGB32);
+  random.fillRange(reinterpret_cast<quint32 *>(image.bits()),
+                   image.sizeInBytes() / sizeof(quint32));
+  return image;
+}
+
+void paint_vector_page(QPainter &painter, QRandomGenerator &random)
+{
+  for (int i = 0; i < 400; ++i) {
+    QPainterPath path(random_point(random));
+    for (int j = 0; j < 5; ++j)
+      path.cubicTo(random_point(random), random_point(random),
+                   random_point(random));
+    painter.setPen(
+        QPen(random_color(random), 0.2 + 2 * random.generateDouble()));
+    painter.drawPath(path);
+  }
+  painter.setPen(Qt::black);
+  for (int i = 0; i < 20; ++i)
+    painter.drawText(QPointF(10, 12 * (i + 1)),
+                     QString("Line %1 of some vector text").arg(i));
+}
+
+void paint_image_page(QPainter &painter, QRandomGenerator &random)
+{
+  painter.drawImage(QRectF(0, 0, page_width, page_height),
+                    noise_image(random, 640, 360));
+  painter.drawImage(QRectF(page_width / 4, page_height / 4, page_width / 2,
+                           page_height / 2),
+                    noise_image(random, 320, 180));
+}
+
+void paint_overlay_page(QPainter &painter, const int page)
+{
+  const int slide = page / overlay_steps, step = page % overlay_steps;
+  // Each overlay repeats the content of the previous overlay.
+  QRandomGenerator random(slide);
+  painter.drawText(QPointF(10, 20), QString("Slide %1").arg(slide + 1));
+  const qreal width = page_width / 4, height = (page_height - 30) / 2;
+  for (int block = 0; block <= step; ++block) {
+    const QRectF rect((block % 4) * width, 30 + (block / 4) * height, width,
+                      height);
+    if (block % 2) {
+      painter.drawImage(rect.adjusted(2, 2, -2, -2),
+                        noise_image(random, 160, 120));
+    } else {
+      QPolygonF polygon;
+      for (int i = 0; i < 200; ++i)
+        polygon.append(
+            {rect.left() + rect.width() * i / 200,
+             rect.bottom() - rect.height() * random.generateDouble()});
+      painter.setPen(QPen(random_color(random), 0.5));
+      painter.drawPolyline(polygon);
+    }
+  }
+}
+
+void paint_huge_page(QPainter &painter, QRandomGenerator &random,
+                     const int page)
+{
+  painter.drawText(QPointF(10, 20), QString("Page %1").arg(page + 1));
+  painter.setPen(QPen(random_color(random), 2));
+  painter.drawRect(QRectF(random_point(random), random_point(random)));
+  painter.drawLine(random_point(random), random_point(random));
+}
+
+/// Write deck to filename.
+void write_deck(const QString &filename, const QString &deck, const int pages)
+{
+  QPdfWriter writer(filename);
+  writer.setCreator("beamerpresenter-bench");
+  writer.setResolution(72);
+  writer.setPageSize(QPageSize(QSizeF(page_width, page_height),
+                               QPageSize::Point, QString(),
+                               QPageSize::ExactMatch));
+  writer.setPageMargins(QMarginsF());
+  QPainter painter(&writer);
+  painter.setRenderHint(QPainter::Antialiasing);
+  QRandomGenerator random(42);
+  for (int page = 0; page < pages; ++page) {
+    if (page > 0) writer.newPage();
+    if (deck == "vector")
+      paint_vector_page(painter, random);
+    else if (deck == "image")
+      paint_image_page(painter, random);
+    else if (deck == "overlay")
+      paint_overlay_page(painter, page);
+    else
+      paint_huge_page(painter, random, page);
+  }
+}
+
+std::shared_ptr<PdfDocument> open_document(const QString &filename,
+                                           const PdfEngine engine)
+{
+  switch (engine) {
+#ifdef USE_MUPDF
+    case PdfEngine::MuPdf:
+      return std::shared_ptr<PdfDocument>(new MuPdfDocument(filename));
+#endif
+#ifdef USE_POPPLER
+    case PdfEngine::Poppler:
+      return std::shared_ptr<PdfDocument>(new PopplerDocument(filename));
+#endif
+#ifdef USE_QTPDF
+    case PdfEngine::QtPDF:
+      return std::shared_ptr<PdfDocument>(new QtDocument(filename));
+#endif
+  }
+  return nullptr;
+}
+
+/// Resolution in pixels per point at which page fits in frame.
+qreal fit_resolution(const PdfDocument *doc, const int page,
+                     const QSizeF &frame)
+{
+  const QSizeF size = doc->pageSize(page);
+  if (size.isEmpty()) return -1.;
+  return std::min(frame.width() / size.width(),
+                  frame.height() / size.height());
+}
+
+/// Process events for given time.
+void wait_events(const int ms)
+{
+  QEventLoop loop;
+  QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+  loop.exec();
+}
+
+void print_value(const QString &name, const double value, const char *unit)
+{
+  std::printf("%s %.6g %s\n", qPrintable(name), value, unit);
+}
+
+/// Print mean, median, 95th percentile and maximum of times given in ns.
+void print_times(const QString &name, QVector<qint64> times)
+{
+  if (times.isEmpty()) return;
+  std::sort(times.begin(), times.end());
+  qint64 sum = 0;
+  for (const qint64 time : std::as_const(times)) sum += time;
+  const auto percentile = [&times](const double p) {
+    return 1e-6 * times[std::min(int(p * times.size()), times.size() - 1)];
+  };
+  print_value(name + "_mean", 1e-6 * sum / times.size(), "ms");
+  print_value(name + "_p50", percentile(0.5), "ms");
+  print_value(name + "_p95", percentile(0.95), "ms");
+  print_value(name + "_max", 1e-6 * times.last(), "ms");
+}
+
+/// Measure rendering and PNG compression for sample pages.
+void bench_rendering(const QString &prefix,
+                     const std::shared_ptr<PdfDocument> &doc,
+                     const AbstractRenderer *renderer, const Options &options)
+{
+  const int pages = doc->numberOfPages();
+  const int samples = std::min(options.samples, pages);
+  QVector<qint64> render, render_png, encode, decode;
+  qint64 png_bytes = 0;
+  QElapsedTimer timer;
+  for (int i = 0; i < samples; ++i) {
+    const int page = qint64(i) * pages / samples;
+    const qreal resolution = fit_resolution(doc.get(), page, options.frame);
+    timer.start();
+    const QPixmap pixmap = renderer->renderPixmap(page, resolution);
+    render.append(timer.nsecsElapsed());
+    if (pixmap.isNull()) {
+      std::printf("error: rendering %s page %d failed\n", qPrintable(prefix),
+                  page);
+      continue;
+    }
+    timer.start();
+    const PngPixmap png(pixmap, page, resolution);
+    encode.append(timer.nsecsElapsed());
+    if (png.isNull()) continue;
+    png_bytes += png.size();
+    timer.start();
+    const bool decoded = !png.pixmap().isNull();
+    decode.append(timer.nsecsElapsed());
+    if (!decoded) continue;
+    // renderPng is used by the PixCache threads.
+    timer.start();
+    delete renderer->renderPng(page, resolution);
+    render_png.append(timer.nsecsElapsed());
+  }
+  print_times(prefix + ".render", render);
+  print_times(prefix + ".render_png", render_png);
+  print_times(prefix + ".png_encode", encode);
+  print_times(prefix + ".png_decode", decode);
+  if (!encode.isEmpty())
+    print_value(prefix + ".png_size", double(png_bytes) / encode.size(),
+                "bytes");
+}
+
+/// Navigate through the document with a PixCache and count cache hits.
+void bench_cache(const QString &prefix, const std::shared_ptr<PdfDocument> &doc,
+                 const Options &options)
+{
+  const int pages = doc->numberOfPages();
+  writable_preferences->page = 0;
+  PixCache cache(doc, options.threads, FullPage);
+  cache.setMaxMemory(options.memory);
+  cache.init();
+  cache.updateFrame(options.frame);
+  // Reproducible navigation: mostly forward, sometimes back or jumping.
+  QRandomGenerator random(7);
+  int page = 0, hits = 0;
+  QVector<qint64> latencies;
+  QElapsedTimer timer;
+  for (int step = 0; step < options.steps; ++step) {
+    writable_preferences->page = page;
+    const qreal resolution = fit_resolution(doc.get(), page, options.frame);
+    qreal cached_resolution;
+    if (!cache
+             .cachedPage(doc.get(), FullPage, page, resolution * (1 - 1e-5),
+                         cached_resolution)
+             .isEmpty())
+      ++hits;
+    timer.start();
+    cache.pageNumberChanged(page, page);
+    QPixmap pixmap;
+    cache.getPixmap(page, pixmap, resolution);
+    latencies.append(timer.nsecsElapsed());
+    wait_events(options.dwell_ms);
+    const double r = random.generateDouble();
+    if (r < 0.85)
+      ++page;
+    else if (r < 0.95)
+      --page;
+    else
+      page = random.bounded(pages);
+    page = std::clamp(page, 0, pages - 1);
+  }
+  print_times(prefix + ".page_latency", latencies);
+  if (options.steps > 0)
+    print_value(prefix + ".cache_hit_rate", double(hits) / options.steps, "");
+  const int cached = cache.cachedPages();
+  print_value(prefix + ".cached_pages", cached, "count");
+  print_value(prefix + ".cache_memory", cache.getUsedMemory(), "bytes");
+  if (cached > 0)
+    print_value(prefix + ".memory_per_page",
+                double(cache.getUsedMemory()) / cached, "bytes");
+}
+
+void bench_backend(const QString &deck, const QString &filename,
+                   const Backend &backend, const Options &options)
+{
+  const QString prefix = deck + '.' + backend.name;
+  QElapsedTimer timer;
+  timer.start();
+  const auto doc = open_document(filename, backend.engine);
+  if (!doc || !doc->isValid()) {
+    std::printf("error: opening %s failed\n", qPrintable(prefix));
+    return;
+  }
+  doc->loadLabels();
+  print_value(prefix + ".open", 1e-6 * timer.nsecsElapsed(), "ms");
+
+  const Renderer renderer_type = writable_preferences->renderer;
+  const AbstractRenderer *renderer;
+#ifdef USE_EXTERNAL_RENDERER
+  if (backend.external) {
+    writable_preferences->renderer = Renderer::ExternalRenderer;
+    writable_preferences->rendering_command = options.external_command;
+    writable_preferences->rendering_arguments = options.external_arguments;
+    renderer = new ExternalRenderer(options.external_command,
+                                    options.external_arguments, doc);
+  } else
+#endif
+    renderer = createRenderer(doc, FullPage);
+  if (renderer && renderer->isValid()) {
+    bench_rendering(prefix, doc, renderer, options);
+    bench_cache(prefix, doc, options);
+  } else
+    std::printf("error: creating renderer for %s failed\n",
+                qPrintable(prefix));
+  delete renderer;
+  writable_preferences->renderer = renderer_type;
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  qRegisterMetaType<const PngPixmap *>("const PngPixmap*");
+  QGuiApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Rendering benchmark for BeamerPresenter");
+  parser.addHelpOption();
+  parser.addOptions({
+      {"decks", "comma separated decks (vector,image,overlay,huge)", "list",
+       "vector,image,overlay,huge"},
+      {"pages", "pages of vector, image and overlay decks", "number", "40"},
+      {"huge-pages", "pages of huge deck", "number", "2000"},
+      {"samples", "maximum number of rendered pages per deck", "number", "40"},
+      {"steps", "navigation steps with cache", "number", "100"},
+      {"dwell", "time per page when navigating (ms)", "number", "30"},
+      {"threads", "cache threads", "number", "2"},
+      {"memory", "cache memory (MiB, negative: unlimited)", "number", "100"},
+      {"width", "frame width (pixels)", "number", "1920"},
+      {"height", "frame height (pixels)", "number", "1080"},
+      {"external-command", "external renderer command", "command"},
+      {"external-arguments", "comma separated arguments of external renderer",
+       "list"},
+      {"keep", "write decks to directory and keep them", "directory"},
+  });
+  parser.process(app);
+
+  Options options;
+  options.pages = parser.value("pages").toInt();
+  options.huge_pages = parser.value("huge-pages").toInt();
+  options.samples = parser.value("samples").toInt();
+  options.steps = parser.value("steps").toInt();
+  options.dwell_ms = parser.value("dwell").toInt();
+  options.threads = parser.value("threads").toInt();
+  options.memory = parser.value("memory").toFloat() * (1 << 20);
+  options.frame = QSizeF(parser.value("width").toDouble(),
+                         parser.value("height").toDouble());
+  options.external_command = parser.value("external-command");
+  if (parser.isSet("external-arguments"))
+    options.external_arguments = parser.value("external-arguments").split(',');
+
+  QTemporaryDir tmp;
+  if (!tmp.isValid()) qFatal("Cannot create temporary directory");
+  // Use an empty configuration file and defaults for all settings.
+  GlobalPreferences::initialize(tmp.filePath("beamerpresenter.conf"));
+  writable_preferences = WritableGlobalPreferences::writable();
+
+  QList<Backend> backends;
+#ifdef USE_MUPDF
+  backends.append({"mupdf", PdfEngine::MuPdf, false});
+#endif
+#ifdef USE_POPPLER
+  backends.append({"poppler", PdfEngine::Poppler, false});
+#endif
+#ifdef USE_QTPDF
+  backends.append({"qtpdf", PdfEngine::QtPDF, false});
+#endif
+#ifdef USE_EXTERNAL_RENDERER
+  // The external renderer needs a PDF engine for page sizes.
+  if (!backends.isEmpty() && !options.external_command.isEmpty())
+    backends.append({"external", backends.first().engine, true});
+#endif
+
+  const QString dir =
+      parser.isSet("keep") ? parser.value("keep") : tmp.path();
+  QElapsedTimer timer;
+  for (const auto &deck : parser.value("decks").split(',')) {
+    if (deck != "vector" && deck != "image" && deck != "overlay" &&
+        deck != "huge") {
+      std::printf("error: unknown deck %s\n", qPrintable(deck));
+      continue;
+    }
+    const QString filename = dir + '/' + deck + ".pdf";
+    const int pages = deck == "huge" ? options.huge_pages : options.pages;
+    timer.start();
+    write_deck(filename, deck, pages);
+    print_value(deck + ".generate", timer.elapsed(), "ms");
+    print_value(deck + ".pages", pages, "count");
+    print_value(deck + ".file_size", QFileInfo(filename).size(), "bytes");
+    for (const auto &backend : std::as_const(backends))
+      bench_backend(deck, filename, backend, options);
+  }
+
+  delete preferences();
+  return 0;
+}
@@ -0,0 +1,233 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+/**
+ * Benchmark for reading stroke coordinates from a large .xopp file.
+ *
+ * Generates an uncompressed Xournal++ file with many pen strokes and reads
+ * all strokes with the former QString::split() based parsing (as baseline),
+ * with the FullGraphicsPath constructor used for parsing strokes, and with
+ * PathContainer::loadDrawings. Results are printed as "name value unit"
+ * lines.
+ *
+ * Usage: bench-xmlstrokes [pages] [strokes per page] [points per stroke]
+ * Without a display, set QT_QPA_PLATFORM=offscreen (this is the default
+ * here if the variable is not set).
+ */
+
+#include <QApplication>
+#include <QColor>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QPen>
+#include <QPointF>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <utility>
+
+#include "src/config.h"
+#include "src/drawing/abstractgraphicspath.h"
+#include "src/drawing/drawtool.h"
+#include "src/drawing/fullgraphicspath.h"
+#include "src/drawing/numberscanner.h"
+#include "src/drawing/pathcontainer.h"
+#include "src/preferences.h"
+
+namespace
+{
+void write_file(const QString &filename, const int pages, const int strokes,
+                const int points)
+{
+  QFile file(filename);
+  if (!file.open(QFile::WriteOnly)) qFatal("Cannot write test file");
+  QXmlStreamWriter writer(&file);
+  writer.writeStartDocument();
+  writer.writeStartElement("xournal");
+  QRandomGenerator random(42);
+  for (int page = 0; page < pages; ++page) {
+    writer.writeStartElement("page");
+    writer.writeAttribute("width", "595.276");
+    writer.writeAttribute("height", "841.89");
+    writer.writeStartElement("layer");
+    for (int stroke = 0; stroke < strokes; ++stroke) {
+      QString coordinates, widths;
+      qreal x = 50 + 500 * random.generateDouble(),
+            y = 50 + 750 * random.generateDouble();
+      for (int i = 0; i < points; ++i) {
+        x += random.generateDouble() - 0.5;
+        y += random.generateDouble() - 0.5;
+        coordinates += QString::number(x, 'f', 4) + ' ' +
+                       QString::number(y, 'f', 4) + ' ';
+        widths += QString::number(1 + random.generateDouble(), 'f', 4) + ' ';
+      }
+      coordinates.chop(1);
+      widths.chop(1);
+      writer.writeStartElement("stroke");
+      writer.writeAttribute("tool", "pen");
+      writer.writeAttribute("color", "#ff0000ff");
+      writer.writeAttribute("width", widths);
+      writer.writeCharacters(coordinates);
+      writer.writeEndElement();
+    }
+    writer.writeEndElement();  // "layer" element
+    writer.writeEndElement();  // "page" element
+  }
+  writer.writeEndElement();  // "xournal" element
+  writer.writeEndDocument();
+}
+
+/// Former implementation in FullGraphicsPath, kept as baseline.
+int parse_split(const QString &coordinate_string, const QString &weights)
+{
+  QStringList coordinate_list = coordinate_string.split(' ');
+  QStringList weight_list = weights.split(' ');
+  QVector<QPointF> coordinates(coordinate_list.length() / 2);
+  QVector<float> pressures(coordinate_list.length() / 2);
+  float w = 1.;
+  int i = 0;
+  while (coordinate_list.length() > 1) {
+    coordinates[i] = {coordinate_list.takeFirst().toDouble(),
+                      coordinate_list.takeFirst().toDouble()};
+    if (!weight_list.isEmpty()) w = weight_list.takeFirst().toFloat();
+    pressures[i++] = w;
+  }
+  return coordinates.size();
+}
+
+/// Parse stroke with the constructor of FullGraphicsPath.
+int parse_path(const QString &coordinate_string, const QString &weights)
+{
+  static const DrawTool tool(Tool::Pen, Tool::AnyNormalDevice,
+                             QPen(Qt::red, 1., Qt::SolidLine, Qt::RoundCap,
+                                  Qt::RoundJoin));
+  const FullGraphicsPath path(tool, coordinate_string, weights);
+  return path.size();
+}
+
+/// Compare all numbers parsed by NumberScanner with QString::toDouble().
+/// @return maximum relative deviation
+double check_values(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) qFatal("Cannot read test file");
+  QXmlStreamReader reader(&file);
+  double max_deviation = 0.;
+  while (!reader.atEnd()) {
+    if (reader.readNext() != QXmlStreamReader::StartElement ||
+        reader.name().toUtf8() != "stroke")
+      continue;
+    const QString widths = reader.attributes().value("width").toString();
+    for (const QString &string : {reader.readElementText(), widths}) {
+      NumberScanner scanner(string);
+      double value;
+      for (const QString &token : string.split(' ')) {
+        if (!scanner.next(value)) return 1.;
+        const double expected = token.toDouble();
+        if (value != expected)
+          max_deviation = std::max(max_deviation, std::abs(value - expected) /
+                                                      std::abs(expected));
+      }
+      if (scanner.next(value)) return 1.;
+    }
+  }
+  return max_deviation;
+}
+
+/// Read all strokes in file using parser.
+/// @return number of nodes and elapsed time in ms
+std::pair<qint64, qint64> read_file(const QString &filename,
+                                    int (*parser)(const QString &,
+                                                  const QString &))
+{
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) qFatal("Cannot read test file");
+  QElapsedTimer timer;
+  timer.start();
+  QXmlStreamReader reader(&file);
+  qint64 nodes = 0;
+  while (!reader.atEnd()) {
+    if (reader.readNext() == QXmlStreamReader::StartElement &&
+        reader.name().toUtf8() == "stroke") {
+      const QString widths = reader.attributes().value("width").toString();
+      nodes += parser(reader.readElementText(), widths);
+    }
+  }
+  return {nodes, timer.elapsed()};
+}
+
+/// Read all layers in file with PathContainer::loadDrawings.
+/// @return number of nodes and elapsed time in ms
+std::pair<qint64, qint64> load_file(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) qFatal("Cannot read test file");
+  QElapsedTimer timer;
+  timer.start();
+  QXmlStreamReader reader(&file);
+  qint64 nodes = 0;
+  while (!reader.atEnd()) {
+    if (reader.readNext() != QXmlStreamReader::StartElement ||
+        reader.name().toUtf8() != "layer")
+      continue;
+    PathContainer container;
+    container.loadDrawings(reader);
+    for (const auto item : container)
+      if (item->type() == FullGraphicsPath::Type)
+        nodes += static_cast<const AbstractGraphicsPath *>(item)->size();
+  }
+  return {nodes, timer.elapsed()};
+}
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+  const QStringList args = app.arguments();
+  const int pages = args.value(1, "100").toInt(),
+            strokes = args.value(2, "200").toInt(),
+            points = args.value(3, "200").toInt();
+  QTemporaryDir dir;
+  if (!dir.isValid()) qFatal("Cannot create temporary directory");
+  const QString filename = dir.filePath("large.xopp");
+  // Use an empty configuration file and defaults for all settings.
+  GlobalPreferences::initialize(dir.filePath("beamerpresenter.conf"));
+
+  QElapsedTimer timer;
+  timer.start();
+  write_file(filename, pages, strokes, points);
+  std::printf("generate %lld ms\n", (long long)timer.elapsed());
+  std::printf("file_size %lld bytes\n", (long long)QFile(filename).size());
+
+  const auto [split_nodes, split_ms] = read_file(filename, &parse_split);
+  std::printf("parse_split %lld ms\n", (long long)split_ms);
+  const auto [path_nodes, path_ms] = read_file(filename, &parse_path);
+  std::printf("parse_path %lld ms\n", (long long)path_ms);
+  const auto [load_nodes, load_ms] = load_file(filename);
+  std::printf("load_drawings %lld ms\n", (long long)load_ms);
+  std::printf("nodes %lld count\n", (long long)path_nodes);
+  int status = 0;
+  if (split_nodes != path_nodes || load_nodes != path_nodes) {
+    std::printf("error: parsers disagree (%lld nodes with split, %lld with "
+                "loadDrawings)\n",
+                (long long)split_nodes, (long long)load_nodes);
+    status = 1;
+  }
+  // Values may differ in the last bit, see NumberScanner::next.
+  const double deviation = check_values(filename);
+  std::printf("max_deviation %g relative\n", deviation);
+  if (deviation > 1e-15) {
+    std::printf("error: parsed values differ from QString::toDouble()\n");
+    status = 1;
+  }
+  delete preferences();
+  return status;
+}
@@ -0,0 +1,61 @@
+#!/usr/bin/env python3
+# SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+# SPDX-License-Identifier: AGPL-3.0-or-later
+"""
+Persistent render worker for the external renderer of BeamerPresenter.
+
+The PDF file is opened once using PyMuPDF. Each line on standard input is a
+request "<page> <resolution> <format> <width> <height>" with the page index
+starting from 0, the resolution in dpi and the format "png" or "pnm". For
+each request, the length of the image in bytes is written as one line to
+standard output, followed by the image data. Length 0 indicates an error.
+
+Configuration in beamerpresenter.conf:
+
+    [rendering]
+    renderer=mupdf external
+    rendering worker=true
+    rendering command=/path/to/render-worker.py
+    rendering arguments=%file
+"""
+
+import sys
+
+try:
+    import pymupdf
+except ImportError:
+    import fitz as pymupdf
+
+
+def render(document, line):
+    """Render the page requested in line and return the image data."""
+    fields = line.split()
+    page = int(fields[0])
+    zoom = float(fields[1]) / 72
+    image_format = "png" if fields[2] == "png" else "ppm"
+    pixmap = document[page].get_pixmap(
+        matrix=pymupdf.Matrix(zoom, zoom), alpha=False
+    )
+    return pixmap.tobytes(image_format)
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: render-worker.py <file.pdf>", file=sys.stderr)
+        return 1
+    document = pymupdf.open(sys.argv[1])
+    output = sys.stdout.buffer
+    for line in sys.stdin:
+        try:
+            data = render(document, line)
+        except Exception as error:
+            print("render-worker:", error, file=sys.stderr)
+            data = b""
+        output.write(b"%d\n" % len(data))
+        output.write(data)
+        output.flush()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
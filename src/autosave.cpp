@@ -0,0 +1,184 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/autosave.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+
+#include "src/log.h"
+#include "src/master.h"
+#include "src/pdfmaster.h"
+#include "src/preferences.h"
+
+void AutosaveWorker::write(AutosaveJob job)
+{
+  // The autosave file may have been discarded after the job was sent.
+  if (job.generation != generation()) return;
+  bool success = true;
+  for (auto &entry : job.entries)
+    if (!entry.encoded) {
+      success &= BinaryDrawings::encodeChunk(entry.chunk, entry.payload,
+                                             job.compression);
+      entry.payload.clear();
+      entry.encoded = true;
+    }
+  if (success) {
+    QDir().mkpath(QFileInfo(job.filename).absolutePath());
+    // QSaveFile writes to a temporary file and renames it on commit().
+    QSaveFile file(job.filename);
+    success = file.open(QFile::WriteOnly);
+    BinaryDrawings::Writer writer(&file, job.compression);
+    success = success && writer.writeFileHeader();
+    for (const auto &entry : std::as_const(job.entries))
+      success = success && writer.writeChunk(entry.chunk);
+    success = success && writer.writeChunk("END ", QByteArray());
+    if (success)
+      success = file.commit();
+    else
+      file.cancelWriting();
+  }
+  emit finished(job, success);
+}
+
+Autosave::Autosave(const QString &filename, QObject *parent)
+    : QObject(parent),
+      filename(filename),
+      worker(new AutosaveWorker()),
+      thread(new QThread())
+{
+  qRegisterMetaType<AutosaveJob>("AutosaveJob");
+  thread->setObjectName("autosave");
+  worker->moveToThread(thread);
+  connect(this, &Autosave::sendJob, worker, &AutosaveWorker::write,
+          Qt::QueuedConnection);
+  connect(worker, &AutosaveWorker::finished, this, &Autosave::receiveFinished,
+          Qt::QueuedConnection);
+  thread->start(QThread::LowPriority);
+}
+
+Autosave::~Autosave()
+{
+  if (stopThread()) {
+    delete worker;
+    delete thread;
+  } else {
+    // Deleting a running thread would crash. Delete it when it finishes.
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+  }
+}
+
+bool Autosave::stopThread()
+{
+  if (stopped) return false;
+  thread->quit();
+  if (thread->wait(thread_wait_time_ms)) return true;
+  qWarning() << "Autosave thread did not finish in time";
+  stopped = true;
+  return false;
+}
+
+QString Autosave::autosavePath(const QString &document)
+{
+  const QByteArray hash =
+      QCryptographicHash::hash(document.toUtf8(), QCryptographicHash::Sha1)
+          .toHex();
+  return QStandardPaths::writableLocation(
+             QStandardPaths::AppLocalDataLocation) +
+         "/autosave/" + QString::fromLatin1(hash) + ".bpb";
+}
+
+bool Autosave::save(const QList<std::shared_ptr<PdfMaster>> &documents,
+                    const QByteArray &header)
+{
+  if (busy || stopped) return false;
+  if (last_overlay_mode != preferences()->overlay_mode) {
+    cache.clear();
+    last_overlay_mode = preferences()->overlay_mode;
+  }
+  AutosaveJob job;
+  job.filename = filename;
+  job.compression = BinaryDrawings::defaultCompression();
+  job.generation = worker->generation();
+  QList<QPair<const PdfMaster *, int>> layout;
+  bool changed = header != last_header;
+  {
+    AutosaveJob::Entry entry;
+    entry.chunk.tag = "HEAD";
+    entry.payload = header;
+    job.entries.append(entry);
+  }
+  for (const auto &pdf : documents) {
+    AutosaveJob::Entry docu;
+    docu.chunk.tag = "DOCU";
+    docu.payload = pdf->getFilename().toUtf8();
+    job.entries.append(docu);
+    for (const int page : master()->pageIdx()) {
+      AutosaveJob::Entry entry;
+      entry.chunk.tag = "PAGE";
+      entry.pdf = pdf.get();
+      entry.page = page;
+      entry.revision = pdf->pageRevision(page);
+      const auto time = pdf->targetTimes().constFind(page);
+      entry.endtime =
+          time == pdf->targetTimes().cend() ? -1 : qint64(*time);
+      const auto cached = cache.constFind({pdf.get(), page});
+      if (cached != cache.cend() && cached->revision == entry.revision &&
+          cached->endtime == entry.endtime) {
+        entry.chunk = cached->chunk;
+        entry.encoded = true;
+      } else {
+        pdf->writePageBinary(entry.payload, page);
+        changed = true;
+      }
+      layout.append({pdf.get(), page});
+      job.entries.append(entry);
+    }
+  }
+  if (!changed && layout == last_layout) return false;
+  debug_msg(DebugDrawing, "autosave:" << job.entries.size() << "chunks");
+  busy = true;
+  last_header = header;
+  last_layout = layout;
+  emit sendJob(job);
+  return true;
+}
+
+void Autosave::receiveFinished(const AutosaveJob job, const bool success)
+{
+  // Jobs finished before discard() must not fill the cache again.
+  if (job.generation != worker->generation()) return;
+  busy = false;
+  if (!success) {
+    qWarning() << "Autosave failed:" << job.filename;
+    // Make sure that the next call to save() writes the file again.
+    last_header.clear();
+    return;
+  }
+  for (const auto &entry : job.entries)
+    if (entry.pdf)
+      cache[{entry.pdf, entry.page}] = {entry.revision, entry.endtime,
+                                        entry.chunk};
+}
+
+void Autosave::discard()
+{
+  // Jobs which are still queued in the worker thread would write the file
+  // again after it was removed.
+  worker->cancelJobs();
+  const bool restart = stopThread();
+  QFile::remove(filename);
+  cache.clear();
+  last_header.clear();
+  last_layout.clear();
+  if (restart) {
+    busy = false;
+    thread->start(QThread::LowPriority);
+  }
+}
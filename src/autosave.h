@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef AUTOSAVE_H
+#define AUTOSAVE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+#include "src/config.h"
+#include "src/drawing/binarydrawings.h"
+#include "src/enumerates.h"
+
+class PdfMaster;
+class QThread;
+
+/// Chunks of an autosave file as passed between Autosave and
+/// AutosaveWorker.
+struct AutosaveJob {
+  struct Entry {
+    /// Chunk, compressed if encoded is true.
+    BinaryDrawings::Chunk chunk;
+    /// Uncompressed payload, only used if encoded is false.
+    QByteArray payload;
+    /// Document, only set for "PAGE" chunks.
+    const PdfMaster *pdf = nullptr;
+    /// Page number for "PAGE" chunks.
+    int page = 0;
+    /// Revision of the page at the time of the snapshot.
+    quint64 revision = 0;
+    /// End time of the page at the time of the snapshot.
+    qint64 endtime = -1;
+    /// True if chunk contains the compressed payload.
+    bool encoded = false;
+  };
+  /// Target file name.
+  QString filename;
+  /// Compression used for all chunks.
+  BinaryDrawings::Compression compression = BinaryDrawings::NoCompression;
+  /// All chunks in the order in which they should be written.
+  QList<Entry> entries;
+  /// Generation of the worker when the job was created.
+  quint64 generation = 0;
+};
+Q_DECLARE_METATYPE(AutosaveJob);
+
+/**
+ * @brief Worker object writing autosave files in own thread
+ *
+ * Compresses the chunks which have changed since the last autosave and
+ * writes the full file. The file is first written to a temporary file, which
+ * replaces the autosave file only if writing was successful.
+ */
+class AutosaveWorker : public QObject
+{
+  Q_OBJECT
+
+  /// Jobs of other generations are dropped.
+  std::atomic<quint64> current_generation{0};
+
+ public:
+  /// Generation for new jobs. This is thread safe.
+  quint64 generation() const noexcept { return current_generation.load(); }
+
+  /// Drop all jobs which have not been started yet. This is thread safe.
+  void cancelJobs() noexcept { ++current_generation; }
+
+ public slots:
+  /// Compress and write job unless it has been cancelled.
+  void write(AutosaveJob job);
+
+ signals:
+  /// Send back the job with all chunks compressed.
+  void finished(const AutosaveJob job, const bool success);
+};
+
+/**
+ * @brief Periodic saving of drawings for crash recovery
+ *
+ * The drawings are written to a file in the binary drawings format in the
+ * application data directory. Pages are only serialized (in the main thread)
+ * if their PathContainers have changed since the last autosave, see
+ * PdfMaster::pageRevision(). Compression and writing are done in a separate
+ * thread using AutosaveWorker. Unchanged pages are written from a cache of
+ * compressed chunks.
+ *
+ * The autosave file is removed when the program is closed regularly. If it
+ * exists at startup, the program was not closed correctly and the drawings
+ * can be restored.
+ */
+class Autosave : public QObject
+{
+  Q_OBJECT
+
+  static constexpr int thread_wait_time_ms = 10000;
+
+  /// Cached compressed page chunk.
+  struct CachedPage {
+    quint64 revision;
+    qint64 endtime;
+    BinaryDrawings::Chunk chunk;
+  };
+
+  /// Compressed "PAGE" chunks of the latest autosave.
+  QHash<QPair<const PdfMaster *, int>, CachedPage> cache;
+  /// Payload of "HEAD" chunk of the latest autosave.
+  QByteArray last_header;
+  /// Order of pages in the latest autosave.
+  QList<QPair<const PdfMaster *, int>> last_layout;
+  /// Overlay mode at the latest autosave. The page chunks depend on it.
+  OverlayDrawingMode last_overlay_mode =
+      OverlayDrawingMode::InvalidOverlayMode;
+  /// Path of the autosave file.
+  QString filename;
+  /// Worker object, owned by this.
+  AutosaveWorker *worker;
+  /// Thread of worker, owned by this.
+  QThread *thread;
+  /// Job is being written.
+  bool busy = false;
+  /// The worker did not stop in time. No further jobs are accepted.
+  bool stopped = false;
+
+  /// Stop the worker thread. Return false if it did not stop in time.
+  bool stopThread();
+
+ public:
+  /// Constructor: create worker thread.
+  explicit Autosave(const QString &filename, QObject *parent = nullptr);
+
+  /// Destructor: wait for worker thread and delete it. If the thread does
+  /// not stop in time, it is deleted when it finishes.
+  ~Autosave();
+
+  /// Path of the autosave file for drawings on the given document.
+  static QString autosavePath(const QString &document);
+
+  /// Path of the autosave file.
+  const QString &file() const noexcept { return filename; }
+
+  /**
+   * Start an autosave in the worker thread if the drawings have changed.
+   * @param documents all documents with pages in the order of page_idx
+   * @param header payload of the "HEAD" chunk
+   * @return true if an autosave was started
+   */
+  bool save(const QList<std::shared_ptr<PdfMaster>> &documents,
+            const QByteArray &header);
+
+  /// Cancel pending jobs, wait for the worker and remove the autosave file.
+  /// The worker is restarted for later autosaves.
+  void discard();
+
+ private slots:
+  /// Update cache after the worker has written a file.
+  void receiveFinished(const AutosaveJob job, const bool success);
+
+ signals:
+  /// Send job to worker.
+  void sendJob(AutosaveJob job);
+};
+
+#endif  // AUTOSAVE_H
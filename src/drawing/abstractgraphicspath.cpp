@@ -3,6 +3,9 @@
 
 #include "src/drawing/abstractgraphicspath.h"
 
+#include <QTransform>
+#include <algorithm>
+
 #include "src/log.h"
 #include "src/preferences.h"
 
@@ -72,8 +75,89 @@ void AbstractGraphicsPath::finalize()
 #endif
   const QPointF new_scene_pos = mapToScene(bounding_rect.center());
   for (auto &point : coordinates) point = mapToScene(point) - new_scene_pos;
+  segment_index.clear();
   resetTransform();
   setPos(new_scene_pos);
   shape_cache = shape();
   bounding_rect = shape_cache.controlPointRect();
 }
+
+void AbstractGraphicsPath::buildSegmentIndex() const
+{
+  segment_index.clear();
+  const int length = coordinates.length();
+  segment_index.reserve((length + segment_block_size - 1) /
+                        segment_block_size);
+  for (int first = 0; first < length; first += segment_block_size) {
+    const int last = std::min(first + segment_block_size, length);
+    qreal left = coordinates[first].x(), right = left,
+          top = coordinates[first].y(), bottom = top;
+    for (int i = first + 1; i < last; ++i) {
+      const QPointF &point = coordinates[i];
+      if (point.x() < left)
+        left = point.x();
+      else if (point.x() > right)
+        right = point.x();
+      if (point.y() < top)
+        top = point.y();
+      else if (point.y() > bottom)
+        bottom = point.y();
+    }
+    segment_index.append(QRectF(QPointF(left, top), QPointF(right, bottom)));
+  }
+}
+
+bool AbstractGraphicsPath::eraseNodes(const QPointF &scene_pos,
+                                      const qreal size)
+{
+  if (coordinates.isEmpty()) return false;
+  const QTransform scene_transform = sceneTransform();
+  bool invertible;
+  const QTransform inverse = scene_transform.inverted(&invertible);
+  if (!invertible) return false;
+  // Rectangle containing the eraser in item coordinates.
+  const QRectF local_rect = inverse.mapRect(
+      QRectF(scene_pos.x() - size, scene_pos.y() - size, 2 * size, 2 * size));
+  if (segment_index.isEmpty()) buildSegmentIndex();
+  const qreal sizesq = size * size;
+  const int length = coordinates.length();
+  bool changed = false;
+  for (int block = 0; block < segment_index.length(); ++block) {
+    // Don't use QRectF::intersects here, because it fails for blocks of
+    // nodes on a horizontal or vertical line.
+    const QRectF &rect = segment_index[block];
+    if (rect.left() > local_rect.right() || rect.right() < local_rect.left() ||
+        rect.top() > local_rect.bottom() || rect.bottom() < local_rect.top())
+      continue;
+    const int last = std::min((block + 1) * segment_block_size, length);
+    for (int i = block * segment_block_size; i < last; ++i) {
+      if (!erased_nodes.isEmpty() && erased_nodes[i]) continue;
+      // Check the distance in scene coordinates.
+      const QPointF diff = scene_transform.map(coordinates[i]) - scene_pos;
+      if (QPointF::dotProduct(diff, diff) < sizesq) {
+        if (erased_nodes.isEmpty()) erased_nodes.fill(false, length);
+        erased_nodes[i] = true;
+        changed = true;
+      }
+    }
+  }
+  if (changed) update();
+  return changed;
+}
+
+std::vector<std::pair<int, int>> AbstractGraphicsPath::remainingRanges() const
+{
+  std::vector<std::pair<int, int>> ranges;
+  const int length = coordinates.length();
+  if (erased_nodes.isEmpty()) {
+    ranges.emplace_back(0, length);
+    return ranges;
+  }
+  int first = 0;
+  for (int i = 0; i <= length; ++i)
+    if (i == length || erased_nodes[i]) {
+      if (i - first > 1) ranges.emplace_back(first, i);
+      first = i + 1;
+    }
+  return ranges;
+}
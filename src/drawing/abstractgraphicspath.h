@@ -12,6 +12,8 @@
 #include <QRectF>
 #include <QString>
 #include <QVector>
+#include <utility>
+#include <vector>
 
 #include "src/config.h"
 #include "src/drawing/drawtool.h"
@@ -29,6 +31,11 @@
  * Different implementations of AbstractGraphicsPath can be distinguished by
  * their QGraphicsItem::type().
  *
+ * Erasing is done in two phases: During an eraser gesture, eraseNodes()
+ * only marks nodes as erased. Painting skips the erased nodes. When the
+ * gesture ends, the remaining ranges of nodes are turned into new paths
+ * using subpath().
+ *
  * @see BasicGraphicsPath
  * @see FullGraphicsPath
  */
@@ -52,8 +59,24 @@ class AbstractGraphicsPath : public QGraphicsItem
   /// Bounding rect
   QRectF bounding_rect;
 
+  /// Nodes marked as erased in the current eraser gesture. This is either
+  /// empty (nothing erased) or has the same length as coordinates.
+  QVector<bool> erased_nodes;
+
+  /// Number of nodes per block in segment_index.
+  static constexpr int segment_block_size = 16;
+
+  /// Index for finding nodes by position: bounding rectangles (in item
+  /// coordinates) of consecutive blocks of segment_block_size nodes.
+  /// This is built when required and cleared when coordinates change.
+  mutable QVector<QRectF> segment_index;
+
+  /// Fill segment_index.
+  void buildSegmentIndex() const;
+
   friend class BasicGraphicsPath;
   friend class ShapeRecognizer;
+  friend class BinaryDrawings;
   friend QDataStream &operator<<(QDataStream &stream,
                                  const QGraphicsItem *item);
   friend QDataStream &operator>>(QDataStream &stream, QGraphicsItem *&item);
@@ -109,20 +132,40 @@ class AbstractGraphicsPath : public QGraphicsItem
   /// Copy this.
   virtual AbstractGraphicsPath *copy() const = 0;
 
+  /// Create subpath including nodes first to last-1 of this.
+  /// The subpath uses the same position and transformation as this.
+  virtual AbstractGraphicsPath *subpath(int first, int last) const = 0;
+
   /**
    * @brief Erase at position pos.
    *
-   * Create list of paths obtained when erasing at position *scene_pos*
-   * with round eraser of radius *size*. This list is empty if this path
-   * is completely erased. Returns nullptr if nothing was erased.
+   * Mark all nodes within distance *size* of *scene_pos* as erased.
+   * Only nodes in blocks of the segment index which are close to
+   * *scene_pos* are checked.
    *
    * @param scene_pos position of eraser (scene coordinates)
    * @param size radius of eraser
-   * @return list of paths after erasing (possibly empty) or
-   * {nullptr} if nothing was erased.
+   * @return true if any node was newly marked as erased.
+   * @see remainingRanges()
+   */
+  bool eraseNodes(const QPointF &scene_pos, const qreal size);
+
+  /// @return true if any nodes are marked as erased.
+  bool hasErasedNodes() const noexcept { return !erased_nodes.isEmpty(); }
+
+  /// Remove all erased marks, show the full path again.
+  void clearErasedNodes()
+  {
+    if (erased_nodes.isEmpty()) return;
+    erased_nodes.clear();
+    update();
+  }
+
+  /**
+   * Ranges [first, last) of nodes that are not erased and contain at
+   * least two nodes. If no nodes are erased, this contains the full path.
    */
-  virtual QList<AbstractGraphicsPath *> splitErase(const QPointF &scene_pos,
-                                                   const qreal size) const = 0;
+  std::vector<std::pair<int, int>> remainingRanges() const;
 
   /// @return _tool
   const DrawTool &getTool() const noexcept { return _tool; }
@@ -4,13 +4,13 @@
 #include "src/drawing/basicgraphicspath.h"
 
 #include <QPainter>
-#include <QStringList>
 #include <QStyleOptionGraphicsItem>
 #include <QWidget>
 #include <QtConfig>
 #include <cmath>
 
 #include "src/drawing/drawtool.h"
+#include "src/drawing/numberscanner.h"
 #include "src/log.h"
 #include "src/preferences.h"
 
@@ -30,7 +30,7 @@ BasicGraphicsPath::BasicGraphicsPath(const DrawTool &tool,
                                      const QRectF &boundingRect) noexcept
     : AbstractGraphicsPath(tool, coordinates)
 {
-  if (bounding_rect.isEmpty()) {
+  if (boundingRect.isEmpty()) {
     shape_cache = shape();
     bounding_rect = shape_cache.boundingRect();
   } else
@@ -72,14 +72,16 @@ BasicGraphicsPath::BasicGraphicsPath(const DrawTool &tool,
     : AbstractGraphicsPath(tool)
 {
   debug_msg(DebugDrawing, coordinate_string);
-  QStringList coordinate_list = coordinate_string.split(' ');
   // Initialize coordinates with the correct length.
-  coordinates = QVector<QPointF>(coordinate_list.length() / 2);
+  coordinates = QVector<QPointF>(NumberScanner::count(coordinate_string) / 2);
   // Read coordinates.
-  int i = 0;
-  while (coordinate_list.length() > 1)
-    coordinates[i++] = {coordinate_list.takeFirst().toDouble(),
-                        coordinate_list.takeFirst().toDouble()};
+  NumberScanner scanner(coordinate_string);
+  qreal x, y;
+  for (auto &point : coordinates) {
+    scanner.next(x);
+    scanner.next(y);
+    point = {x, y};
+  }
   finalize();
 }
 
@@ -91,14 +93,20 @@ void BasicGraphicsPath::paint(QPainter *painter,
   painter->setRenderHint(QPainter::Antialiasing);
   painter->setPen(_tool.pen());
   painter->setCompositionMode(_tool.compositionMode());
+  if (_tool.brush().style() != Qt::NoBrush) painter->setBrush(_tool.brush());
   if (coordinates.length() == 1)
     painter->drawPoint(coordinates.first());
-  else if (_tool.brush().style() == Qt::NoBrush)
+  else if (!erased_nodes.isEmpty()) {
+    // Eraser gesture is active: only draw the remaining parts.
+    for (const auto &[first, last] : remainingRanges())
+      if (_tool.brush().style() == Qt::NoBrush)
+        painter->drawPolyline(coordinates.constData() + first, last - first);
+      else
+        painter->drawPolygon(coordinates.constData() + first, last - first);
+  } else if (_tool.brush().style() == Qt::NoBrush)
     painter->drawPolyline(coordinates.constData(), coordinates.size());
-  else {
-    painter->setBrush(_tool.brush());
+  else
     painter->drawPolygon(coordinates.constData(), coordinates.size());
-  }
 #ifdef QT_DEBUG
   // Show bounding box of stroke in verbose debugging mode.
   if ((preferences()->debug_level & (DebugDrawing | DebugVerbose)) ==
@@ -123,6 +131,7 @@ void BasicGraphicsPath::addPoint(const QPointF &point)
 #else
   shape_cache = QPainterPath();
 #endif
+  if (!segment_index.isEmpty()) segment_index.clear();
   coordinates.append(point);
   bool change = false;
   const qreal half_tool_width = 0.55 * _tool.width();
@@ -143,33 +152,6 @@ void BasicGraphicsPath::addPoint(const QPointF &point)
   if (change) prepareGeometryChange();
 }
 
-QList<AbstractGraphicsPath *> BasicGraphicsPath::splitErase(
-    const QPointF &scene_pos, const qreal size) const
-{
-  if (!sceneBoundingRect()
-           .marginsAdded(QMarginsF(size, size, size, size))
-           .contains(scene_pos))
-    // If returned list contains only a nullptr, this is interpreted as "no
-    // changes".
-    return {nullptr};
-
-  QList<AbstractGraphicsPath *> list;
-  const qreal sizesq = size * size;
-  int first = 0, last = 0;
-  while (last < coordinates.length()) {
-    const QPointF diff = mapToScene(coordinates[last++]) - scene_pos;
-    if (QPointF::dotProduct(diff, diff) < sizesq) {
-      if (last > first + 2)
-        list.append(new BasicGraphicsPath(this, first, last - 1));
-      first = last;
-    }
-  }
-  // If first == 0, then the path has not changed.
-  if (first == 0) return {nullptr};
-  if (last > first + 2) list.append(new BasicGraphicsPath(this, first, last));
-  return list;
-}
-
 void BasicGraphicsPath::changeTool(const DrawTool &newtool) noexcept
 {
   if (!(newtool.tool() & Tool::AnyDrawTool)) {
@@ -197,5 +179,6 @@ AbstractGraphicsPath *BasicGraphicsPath::copy() const
   newpath->setPos(pos());
   newpath->setTransform(transform());
   newpath->shape_cache = shape_cache;
+  newpath->segment_index = segment_index;
   return newpath;
 }
@@ -77,8 +77,10 @@ class BasicGraphicsPath : public AbstractGraphicsPath
   /// @param point new node
   void addPoint(const QPointF &point);
 
-  QList<AbstractGraphicsPath *> splitErase(const QPointF &scene_pos,
-                                           const qreal size) const override;
+  AbstractGraphicsPath *subpath(int first, int last) const override
+  {
+    return new BasicGraphicsPath(this, first, last);
+  }
 
   void changeTool(const DrawTool &newtool) noexcept override;
 
@@ -0,0 +1,558 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/drawing/binarydrawings.h"
+
+#include <zlib.h>
+
+#include <QFile>
+#include <QFont>
+#include <QFontInfo>
+#include <QGraphicsItem>
+#include <QIODevice>
+#include <QPen>
+#include <QTransform>
+#include <QtEndian>
+#include <QVector>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#include "src/drawing/basicgraphicspath.h"
+#include "src/drawing/fullgraphicspath.h"
+#include "src/drawing/textgraphicsitem.h"
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace
+{
+/// Magic bytes at the beginning of a .bpb file.
+constexpr char binary_magic[] = "BPBIN";
+constexpr int binary_magic_length = 5;
+
+/// Item types in binary files.
+enum ItemCode : quint8 {
+  BasicPathCode = 1,
+  FullPathCode = 2,
+  TextCode = 3,
+};
+
+/// Draw tools in binary files.
+enum ToolCode : quint8 {
+  FixedWidthPenCode = 0,
+  PenCode = 1,
+  HighlighterCode = 2,
+};
+
+/// Page parts in binary files.
+quint8 page_part_code(const PagePart part) noexcept
+{
+  switch (part) {
+    case LeftHalf:
+      return 1;
+    case RightHalf:
+      return 2;
+    case FullPage:
+      return 0;
+    default:
+      return 3;
+  }
+}
+
+PagePart page_part_from_code(const quint8 code) noexcept
+{
+  switch (code) {
+    case 0:
+      return FullPage;
+    case 1:
+      return LeftHalf;
+    case 2:
+      return RightHalf;
+    default:
+      return UnknownPagePart;
+  }
+}
+
+inline qint64 quantize(const qreal value) noexcept
+{
+  return std::llround(value * BinaryDrawings::coordinate_scale);
+}
+
+inline qreal dequantize(const qint64 value) noexcept
+{
+  return value / BinaryDrawings::coordinate_scale;
+}
+
+/// Write the common properties of a path.
+void write_path_tool(QByteArray &data, const DrawTool &tool)
+{
+  switch (tool.tool()) {
+    case Tool::Pen:
+      data.append(char(PenCode));
+      break;
+    case Tool::Highlighter:
+      data.append(char(HighlighterCode));
+      break;
+    default:
+      data.append(char(FixedWidthPenCode));
+      break;
+  }
+  BinaryDrawings::writeUInt32(data, tool.pen().color().rgba());
+  BinaryDrawings::writeUInt32(data, tool.brush().color().rgba());
+  data.append(char(tool.pen().style()));
+  data.append(char(tool.brush().style()));
+  data.append(char(tool.compositionMode()));
+  BinaryDrawings::writeDouble(data, tool.width());
+}
+
+/// Read the properties written by write_path_tool.
+DrawTool read_path_tool(BinaryDrawings::Cursor &cursor)
+{
+  Tool::BasicTool basic_tool;
+  switch (cursor.readByte()) {
+    case PenCode:
+      basic_tool = Tool::Pen;
+      break;
+    case HighlighterCode:
+      basic_tool = Tool::Highlighter;
+      break;
+    default:
+      basic_tool = Tool::FixedWidthPen;
+      break;
+  }
+  const QColor pen_color = QColor::fromRgba(cursor.readUInt32());
+  const QColor brush_color = QColor::fromRgba(cursor.readUInt32());
+  const auto pen_style = Qt::PenStyle(cursor.readByte());
+  const auto brush_style = Qt::BrushStyle(cursor.readByte());
+  const auto composition = QPainter::CompositionMode(cursor.readByte());
+  qreal width = cursor.readDouble();
+  if (!(width > 0)) width = 1.;
+  return DrawTool(basic_tool, Tool::AnyNormalDevice,
+                  QPen(pen_color, width, pen_style, Qt::RoundCap,
+                       Qt::RoundJoin),
+                  QBrush(brush_color, brush_style), composition);
+}
+
+/// Write coordinates in scene coordinates as differences.
+void write_coordinates(QByteArray &data, const QVector<QPointF> &coordinates,
+                       const QTransform &transform)
+{
+  BinaryDrawings::writeVarint(data, coordinates.size());
+  qint64 x = 0, y = 0;
+  for (const auto &point : coordinates) {
+    const QPointF scene_point = transform.map(point);
+    const qint64 new_x = quantize(scene_point.x()),
+                 new_y = quantize(scene_point.y());
+    BinaryDrawings::writeSignedVarint(data, new_x - x);
+    BinaryDrawings::writeSignedVarint(data, new_y - y);
+    x = new_x;
+    y = new_y;
+  }
+}
+
+/// Read coordinates written by write_coordinates.
+QVector<QPointF> read_coordinates(BinaryDrawings::Cursor &cursor)
+{
+  const quint64 length = cursor.readVarint();
+  // Each point requires at least 2 bytes. This check avoids huge
+  // allocations for corrupt files.
+  if (!cursor.isValid() || length > (quint64)INT_MAX / 2) return {};
+  QVector<QPointF> coordinates;
+  coordinates.reserve(length);
+  qint64 x = 0, y = 0;
+  for (quint64 i = 0; i < length && cursor.isValid(); ++i) {
+    x += cursor.readSignedVarint();
+    y += cursor.readSignedVarint();
+    coordinates.append({dequantize(x), dequantize(y)});
+  }
+  return coordinates;
+}
+}  // namespace
+
+quint64 BinaryDrawings::Cursor::readVarint() noexcept
+{
+  quint64 value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (pos >= end) {
+      ok = false;
+      return 0;
+    }
+    const quint8 byte = *pos++;
+    value |= quint64(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return value;
+  }
+  ok = false;
+  return 0;
+}
+
+qint64 BinaryDrawings::Cursor::readSignedVarint() noexcept
+{
+  const quint64 value = readVarint();
+  return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+quint8 BinaryDrawings::Cursor::readByte() noexcept
+{
+  if (pos >= end) {
+    ok = false;
+    return 0;
+  }
+  return *pos++;
+}
+
+quint32 BinaryDrawings::Cursor::readUInt32() noexcept
+{
+  if (end - pos < 4) {
+    ok = false;
+    pos = end;
+    return 0;
+  }
+  const quint32 value = qFromLittleEndian<quint32>(pos);
+  pos += 4;
+  return value;
+}
+
+double BinaryDrawings::Cursor::readDouble() noexcept
+{
+  if (end - pos < 8) {
+    ok = false;
+    pos = end;
+    return 0;
+  }
+  const quint64 bits = qFromLittleEndian<quint64>(pos);
+  pos += 8;
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+QString BinaryDrawings::Cursor::readString()
+{
+  const quint64 length = readVarint();
+  if (!ok || length > quint64(end - pos)) {
+    ok = false;
+    pos = end;
+    return QString();
+  }
+  const QString string = QString::fromUtf8(pos, length);
+  pos += length;
+  return string;
+}
+
+void BinaryDrawings::writeVarint(QByteArray &data, quint64 value)
+{
+  while (value >= 0x80) {
+    data.append(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  data.append(char(value));
+}
+
+void BinaryDrawings::writeUInt32(QByteArray &data, const quint32 value)
+{
+  char bytes[4];
+  qToLittleEndian(value, bytes);
+  data.append(bytes, 4);
+}
+
+void BinaryDrawings::writeDouble(QByteArray &data, const double value)
+{
+  quint64 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  char bytes[8];
+  qToLittleEndian(bits, bytes);
+  data.append(bytes, 8);
+}
+
+void BinaryDrawings::writeString(QByteArray &data, const QString &string)
+{
+  const QByteArray utf8 = string.toUtf8();
+  writeVarint(data, utf8.size());
+  data.append(utf8);
+}
+
+bool BinaryDrawings::writeItem(QByteArray &data, const QGraphicsItem *item)
+{
+  switch (item->type()) {
+    case BasicGraphicsPath::Type: {
+      const auto path = static_cast<const BasicGraphicsPath *>(item);
+      data.append(char(BasicPathCode));
+      write_path_tool(data, path->_tool);
+      write_coordinates(data, path->coordinates, path->sceneTransform());
+      return true;
+    }
+    case FullGraphicsPath::Type: {
+      const auto path = static_cast<const FullGraphicsPath *>(item);
+      data.append(char(FullPathCode));
+      write_path_tool(data, path->_tool);
+      write_coordinates(data, path->coordinates, path->sceneTransform());
+      qint64 width = 0;
+      for (const float pressure : path->pressures) {
+        const qint64 new_width = quantize(pressure);
+        writeSignedVarint(data, new_width - width);
+        width = new_width;
+      }
+      return true;
+    }
+    case TextGraphicsItem::Type: {
+      const auto text = static_cast<const TextGraphicsItem *>(item);
+      data.append(char(TextCode));
+      writeString(data, QFontInfo(text->font()).family());
+      writeDouble(data, text->font().pointSizeF());
+      writeUInt32(data, text->defaultTextColor().rgba());
+      writeDouble(data, text->x());
+      writeDouble(data, text->y());
+      const QTransform transform = text->transform();
+      for (const qreal value : {transform.m11(), transform.m12(),
+                                transform.m21(), transform.m22(),
+                                transform.dx(), transform.dy()})
+        writeDouble(data, value);
+      writeString(data, text->toPlainText());
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+QGraphicsItem *BinaryDrawings::readItem(Cursor &cursor)
+{
+  switch (cursor.readByte()) {
+    case BasicPathCode: {
+      const DrawTool tool = read_path_tool(cursor);
+      const QVector<QPointF> coordinates = read_coordinates(cursor);
+      if (!cursor.isValid() || coordinates.isEmpty()) return nullptr;
+      auto path = new BasicGraphicsPath(tool, coordinates);
+      path->finalize();
+      return path;
+    }
+    case FullPathCode: {
+      const DrawTool tool = read_path_tool(cursor);
+      const QVector<QPointF> coordinates = read_coordinates(cursor);
+      if (!cursor.isValid() || coordinates.isEmpty()) return nullptr;
+      QVector<float> pressures(coordinates.size());
+      qint64 width = 0;
+      for (auto &pressure : pressures) {
+        width += cursor.readSignedVarint();
+        pressure = dequantize(width);
+      }
+      if (!cursor.isValid()) return nullptr;
+      auto path = new FullGraphicsPath(tool, coordinates, pressures);
+      path->finalize();
+      return path;
+    }
+    case TextCode: {
+      QFont font(cursor.readString());
+      font.setPointSizeF(cursor.readDouble());
+      const QColor color = QColor::fromRgba(cursor.readUInt32());
+      const qreal x = cursor.readDouble(), y = cursor.readDouble();
+      qreal matrix[6];
+      for (auto &value : matrix) value = cursor.readDouble();
+      const QString string = cursor.readString();
+      if (!cursor.isValid() || string.isEmpty()) return nullptr;
+      auto text = new TextGraphicsItem();
+      text->setFont(font);
+      text->setDefaultTextColor(color);
+      text->setPos(x, y);
+      text->setTransform(QTransform(matrix[0], matrix[1], matrix[2],
+                                    matrix[3], matrix[4], matrix[5]));
+      text->setPlainText(string);
+      return text;
+    }
+    default:
+      return nullptr;
+  }
+}
+
+void BinaryDrawings::writePageHeader(QByteArray &data, const int page,
+                                     const qint64 endtime, const int layers)
+{
+  writeSignedVarint(data, page);
+  writeVarint(data, endtime < 0 ? 0 : endtime + 1);
+  writeVarint(data, layers);
+}
+
+void BinaryDrawings::writeLayerHeader(QByteArray &data, const PagePart part,
+                                      const int number)
+{
+  data.append(char(page_part_code(part)));
+  writeVarint(data, number);
+}
+
+bool BinaryDrawings::readPage(const QByteArray &payload, Page &page)
+{
+  Cursor cursor(payload);
+  page.page = cursor.readSignedVarint();
+  page.endtime = qint64(cursor.readVarint()) - 1;
+  const quint64 layers = cursor.readVarint();
+  for (quint64 i = 0; i < layers && cursor.isValid(); ++i) {
+    Layer layer;
+    layer.part = page_part_from_code(cursor.readByte());
+    const quint64 number = cursor.readVarint();
+    for (quint64 j = 0; j < number && cursor.isValid(); ++j) {
+      QGraphicsItem *item = readItem(cursor);
+      if (item) layer.items.append(item);
+    }
+    page.layers.append(layer);
+  }
+  return cursor.isValid();
+}
+
+bool BinaryDrawings::isBinaryFile(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) return false;
+  return file.read(binary_magic_length) ==
+         QByteArray(binary_magic, binary_magic_length);
+}
+
+BinaryDrawings::Compression BinaryDrawings::defaultCompression() noexcept
+{
+#ifdef USE_ZSTD
+  return ZstdCompression;
+#else
+  return ZlibCompression;
+#endif
+}
+
+bool BinaryDrawings::Writer::writeFileHeader()
+{
+  QByteArray header(binary_magic, binary_magic_length);
+  header.append(char(format_version));
+  header.append(char(compression));
+  return device->write(header) == header.size();
+}
+
+bool BinaryDrawings::encodeChunk(Chunk &chunk, const QByteArray &payload,
+                                 const Compression compression)
+{
+  chunk.size = payload.size();
+  switch (compression) {
+    case ZlibCompression: {
+      uLongf size = compressBound(payload.size());
+      chunk.stored.resize(size);
+      if (compress2(reinterpret_cast<Bytef *>(chunk.stored.data()), &size,
+                    reinterpret_cast<const Bytef *>(payload.constData()),
+                    payload.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+        return false;
+      chunk.stored.resize(size);
+      return true;
+    }
+#ifdef USE_ZSTD
+    case ZstdCompression: {
+      chunk.stored.resize(ZSTD_compressBound(payload.size()));
+      const size_t size =
+          ZSTD_compress(chunk.stored.data(), chunk.stored.size(),
+                        payload.constData(), payload.size(),
+                        ZSTD_CLEVEL_DEFAULT);
+      if (ZSTD_isError(size)) return false;
+      chunk.stored.resize(size);
+      return true;
+    }
+#endif
+    case NoCompression:
+      chunk.stored = payload;
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool BinaryDrawings::Writer::writeChunk(const char tag[4],
+                                        const QByteArray &payload)
+{
+  Chunk chunk{QByteArray(tag, 4)};
+  return encodeChunk(chunk, payload, compression) && writeChunk(chunk);
+}
+
+bool BinaryDrawings::Writer::writeChunk(const Chunk &chunk)
+{
+  QByteArray header = chunk.tag.left(4);
+  writeUInt32(header, chunk.stored.size());
+  writeUInt32(header, chunk.size);
+  return device->write(header) == header.size() &&
+         device->write(chunk.stored) == chunk.stored.size();
+}
+
+bool BinaryDrawings::Reader::readFileHeader()
+{
+  const QByteArray header = device->read(binary_magic_length + 2);
+  if (header.size() != binary_magic_length + 2 ||
+      !header.startsWith(QByteArray(binary_magic, binary_magic_length))) {
+    error = "not a binary drawings file";
+    return false;
+  }
+  if (quint8(header[binary_magic_length]) > format_version) {
+    error = "unsupported file format version";
+    return false;
+  }
+  compression = Compression(header[binary_magic_length + 1]);
+#ifndef USE_ZSTD
+  if (compression == ZstdCompression) {
+    error = "file is compressed with zstd, which is not supported";
+    return false;
+  }
+#endif
+  return true;
+}
+
+bool BinaryDrawings::Reader::nextChunk(QByteArray &tag, QByteArray &payload,
+                                       const QByteArray &skip)
+{
+  const QByteArray header = device->read(12);
+  if (header.size() != 12) {
+    error = "unexpected end of file";
+    return false;
+  }
+  tag = header.left(4);
+  const quint32 stored_size =
+      qFromLittleEndian<quint32>(header.constData() + 4);
+  const quint32 size = qFromLittleEndian<quint32>(header.constData() + 8);
+  if (tag == skip) {
+    payload.clear();
+    if (!device->skip(stored_size)) {
+      error = "unexpected end of file";
+      return false;
+    }
+    return true;
+  }
+  const QByteArray stored = device->read(stored_size);
+  if (stored.size() != qsizetype(stored_size)) {
+    error = "unexpected end of file";
+    return false;
+  }
+  switch (compression) {
+    case ZlibCompression: {
+      payload.resize(size);
+      uLongf dest_size = size;
+      if (uncompress(reinterpret_cast<Bytef *>(payload.data()), &dest_size,
+                     reinterpret_cast<const Bytef *>(stored.constData()),
+                     stored.size()) != Z_OK ||
+          dest_size != size) {
+        error = "decompressing chunk failed";
+        return false;
+      }
+      break;
+    }
+#ifdef USE_ZSTD
+    case ZstdCompression: {
+      payload.resize(size);
+      const size_t dest_size = ZSTD_decompress(
+          payload.data(), size, stored.constData(), stored.size());
+      if (ZSTD_isError(dest_size) || dest_size != size) {
+        error = "decompressing chunk failed";
+        return false;
+      }
+      break;
+    }
+#endif
+    case NoCompression:
+      payload = stored;
+      break;
+    default:
+      error = "unknown compression";
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,195 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef BINARYDRAWINGS_H
+#define BINARYDRAWINGS_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+#include "src/config.h"
+#include "src/enumerates.h"
+
+class QIODevice;
+class QGraphicsItem;
+
+/**
+ * @brief Compact binary file format for drawings (.bpb files)
+ *
+ * This is an alternative to the gzipped XML format (.bpr/.xopp) for
+ * sessions with a large amount of drawings. XML remains the format for
+ * exchange with Xournal++.
+ *
+ * File layout:
+ * - magic "BPBIN", format version (1 byte), compression (1 byte)
+ * - sequence of chunks. Each chunk has a 4 byte tag, the size of the
+ *   stored payload and the size of the uncompressed payload (both as
+ *   32 bit little endian integers), followed by the payload.
+ *
+ * Each chunk is compressed separately. Writing and reading is done one
+ * chunk at a time, so that the full file never needs to be held in memory.
+ *
+ * Chunk tags:
+ * - "HEAD": the XML element <beamerpresenter> (notes, documents, duration)
+ *   as written in .bpr files.
+ * - "DOCU": UTF-8 encoded path of a PDF document. All following pages
+ *   belong to this document.
+ * - "PAGE": page with drawings, see readPage() and writePageHeader().
+ * - "END ": end of file.
+ *
+ * Integers in payloads are stored as varints (LEB128), signed integers
+ * zigzag encoded. Coordinates and stroke widths are stored as differences
+ * to the previous value in units of 1/coordinate_scale points.
+ */
+class BinaryDrawings
+{
+ public:
+  /// Compression of the chunk payloads.
+  enum Compression : quint8 {
+    NoCompression = 0,
+    ZlibCompression = 1,
+    ZstdCompression = 2,
+  };
+
+  /// Version of the file format.
+  static constexpr quint8 format_version = 1;
+
+  /// Coordinates are stored as integers in units of 1/coordinate_scale pt.
+  static constexpr qreal coordinate_scale = 1000.;
+
+  /// Drawings of one layer (page part) of a page.
+  struct Layer {
+    PagePart part = FullPage;
+    QList<QGraphicsItem *> items;
+  };
+
+  /// Page with all its layers as stored in a "PAGE" chunk.
+  struct Page {
+    /// Page number as used in PdfMaster.
+    int page = 0;
+    /// Target time (end time) of this page in ms, or -1 if not set.
+    qint64 endtime = -1;
+    /// Drawings per page part.
+    QList<Layer> layers;
+  };
+
+  /// Chunk with compressed payload, ready for writing.
+  struct Chunk {
+    /// 4 byte tag.
+    QByteArray tag;
+    /// Payload as stored in the file (compressed).
+    QByteArray stored;
+    /// Size of the uncompressed payload.
+    quint32 size = 0;
+  };
+
+  /// Sequential reader for the payload of a chunk.
+  class Cursor
+  {
+    const char *pos;
+    const char *const end;
+    bool ok = true;
+
+   public:
+    explicit Cursor(const QByteArray &data) noexcept
+        : pos(data.constData()), end(data.constData() + data.size())
+    {
+    }
+    /// @return false if any read operation failed.
+    bool isValid() const noexcept { return ok; }
+    /// @return true if all data has been read.
+    bool atEnd() const noexcept { return pos >= end; }
+    quint64 readVarint() noexcept;
+    qint64 readSignedVarint() noexcept;
+    quint8 readByte() noexcept;
+    quint32 readUInt32() noexcept;
+    double readDouble() noexcept;
+    QString readString();
+  };
+
+  /// Streaming writer for .bpb files.
+  class Writer
+  {
+    QIODevice *device;
+    Compression compression;
+
+   public:
+    /// Construct writer on opened device.
+    Writer(QIODevice *device, const Compression compression) noexcept
+        : device(device), compression(compression)
+    {
+    }
+    /// Write magic and format version.
+    bool writeFileHeader();
+    /// Compress and write one chunk.
+    bool writeChunk(const char tag[4], const QByteArray &payload);
+    /// Write chunk that has already been compressed with the compression
+    /// of this writer.
+    bool writeChunk(const Chunk &chunk);
+  };
+
+  /// Streaming reader for .bpb files.
+  class Reader
+  {
+    QIODevice *device;
+    Compression compression = NoCompression;
+    QString error;
+
+   public:
+    /// Construct reader on opened device.
+    explicit Reader(QIODevice *device) noexcept : device(device) {}
+    /// Read magic and format version.
+    bool readFileHeader();
+    /**
+     * Read the next chunk. Chunks with tag equal to skip are not read
+     * and their payload is left empty.
+     * @return false at the end of the file or on errors.
+     */
+    bool nextChunk(QByteArray &tag, QByteArray &payload,
+                   const QByteArray &skip = QByteArray());
+    /// Error message, empty if no error occured.
+    const QString &errorString() const noexcept { return error; }
+  };
+
+  /// Check whether the file starts with the magic bytes of a .bpb file.
+  static bool isBinaryFile(const QString &filename);
+
+  /// Compression used for writing files, depending on compile options.
+  static Compression defaultCompression() noexcept;
+
+  /// Compress payload and store it in chunk. This is independent of the
+  /// device, so chunks can be prepared in other threads.
+  static bool encodeChunk(Chunk &chunk, const QByteArray &payload,
+                          const Compression compression);
+
+  static void writeVarint(QByteArray &data, quint64 value);
+  static void writeSignedVarint(QByteArray &data, const qint64 value)
+  {
+    writeVarint(data, (quint64(value) << 1) ^ quint64(value >> 63));
+  }
+  static void writeUInt32(QByteArray &data, const quint32 value);
+  static void writeDouble(QByteArray &data, const double value);
+  static void writeString(QByteArray &data, const QString &string);
+
+  /// Append item to data. Currently this supports BasicGraphicsPath,
+  /// FullGraphicsPath, and TextGraphicsItem. Other items are ignored.
+  /// @return true if the item was written.
+  static bool writeItem(QByteArray &data, const QGraphicsItem *item);
+  /// Read item from cursor.
+  /// @return new item or nullptr if reading failed.
+  static QGraphicsItem *readItem(Cursor &cursor);
+
+  /// Write page header of a "PAGE" chunk.
+  static void writePageHeader(QByteArray &data, const int page,
+                              const qint64 endtime, const int layers);
+  /// Write layer header in a "PAGE" chunk, followed by number items.
+  static void writeLayerHeader(QByteArray &data, const PagePart part,
+                               const int number);
+  /// Read the payload of a "PAGE" chunk. Items in page are owned by the
+  /// caller.
+  static bool readPage(const QByteArray &payload, Page &page);
+};
+
+#endif  // BINARYDRAWINGS_H
@@ -10,6 +10,7 @@
 #include <QWidget>
 #include <QtConfig>
 
+#include "src/drawing/numberscanner.h"
 #include "src/log.h"
 #include "src/preferences.h"
 
@@ -74,24 +75,26 @@ FullGraphicsPath::FullGraphicsPath(const DrawTool &tool,
                                    const QString &weights)
     : AbstractGraphicsPath(tool)
 {
-  QStringList coordinate_list = coordinate_string.split(' ');
-  QStringList weight_list = weights.split(' ');
-
   // Initialize vectors with the correct length.
-  coordinates = QVector<QPointF>(coordinate_list.length() / 2);
-  pressures = QVector<float>(coordinate_list.length() / 2);
+  const int length = NumberScanner::count(coordinate_string) / 2;
+  coordinates = QVector<QPointF>(length);
+  pressures = QVector<float>(length);
   float w = tool.width(), max_weight = 0;
 
-  // Copy data points from other and update bounding rect.
-  int i = 0;
-  while (coordinate_list.length() > 1) {
-    coordinates[i] = {coordinate_list.takeFirst().toDouble(),
-                      coordinate_list.takeFirst().toDouble()};
-    if (!weight_list.isEmpty()) {
-      w = weight_list.takeFirst().toFloat();
+  // Read data points. If weights has fewer entries than coordinates, the
+  // last weight is used for the remaining nodes.
+  NumberScanner coordinate_scanner(coordinate_string);
+  NumberScanner weight_scanner(weights);
+  qreal x, y, weight;
+  for (int i = 0; i < length; ++i) {
+    coordinate_scanner.next(x);
+    coordinate_scanner.next(y);
+    coordinates[i] = {x, y};
+    if (weight_scanner.next(weight)) {
+      w = weight;
       if (w > max_weight) max_weight = w;
     }
-    pressures[i++] = w;
+    pressures[i] = w;
   }
   max_weight *= tool_width_prefactor;
   _tool.setWidth(max_weight);
@@ -111,14 +114,38 @@ void FullGraphicsPath::paint(QPainter *painter,
     painter->drawPoint(coordinates.first());
     return;
   }
+  if (!erased_nodes.isEmpty()) {
+    // Eraser gesture is active: only draw the remaining parts.
+    for (const auto &[first, last] : remainingRanges())
+      paintRange(painter, pen, first, last);
+  } else
+    paintRange(painter, pen, 0, coordinates.length());
+#ifdef QT_DEBUG
+  // Show bounding box of stroke in verbose debugging mode.
+  if ((preferences()->debug_level & (DebugDrawing | DebugVerbose)) ==
+      (DebugDrawing | DebugVerbose)) {
+    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
+    painter->setPen(QPen(QBrush(Qt::black), 0.5));
+    painter->drawRect(boundingRect());
+    painter->drawLine(bounding_rect.topLeft(), {0, 0});
+    painter->drawLine(bounding_rect.topRight(), {0, 0});
+    painter->drawLine(bounding_rect.bottomLeft(), {0, 0});
+    painter->drawLine(bounding_rect.bottomRight(), {0, 0});
+  }
+#endif
+}
+
+void FullGraphicsPath::paintRange(QPainter *painter, QPen &pen,
+                                  const int first, const int last) const
+{
   if (_tool.brush().style() != Qt::NoBrush) {
     painter->setPen(Qt::NoPen);
     painter->setBrush(_tool.brush());
-    painter->drawPolygon(coordinates.constData(), coordinates.size());
+    painter->drawPolygon(coordinates.constData() + first, last - first);
   }
-  const auto &cend = coordinates.cend();
-  auto cit = coordinates.cbegin();
-  auto pit = pressures.cbegin();
+  const auto cend = coordinates.cbegin() + last;
+  auto cit = coordinates.cbegin() + first;
+  auto pit = pressures.cbegin() + first;
   if (pen.style() == Qt::SolidLine) {
     while (++cit != cend) {
       pen.setWidthF(*++pit);
@@ -137,19 +164,6 @@ void FullGraphicsPath::paint(QPainter *painter,
       len += line.length();
     }
   }
-#ifdef QT_DEBUG
-  // Show bounding box of stroke in verbose debugging mode.
-  if ((preferences()->debug_level & (DebugDrawing | DebugVerbose)) ==
-      (DebugDrawing | DebugVerbose)) {
-    painter->setCompositionMode(QPainter::CompositionMode_SourceOver);
-    painter->setPen(QPen(QBrush(Qt::black), 0.5));
-    painter->drawRect(boundingRect());
-    painter->drawLine(bounding_rect.topLeft(), {0, 0});
-    painter->drawLine(bounding_rect.topRight(), {0, 0});
-    painter->drawLine(bounding_rect.bottomLeft(), {0, 0});
-    painter->drawLine(bounding_rect.bottomRight(), {0, 0});
-  }
-#endif
 }
 
 void FullGraphicsPath::addPoint(const QPointF &point, const float pressure)
@@ -159,6 +173,7 @@ void FullGraphicsPath::addPoint(const QPointF &point, const float pressure)
 #else
   shape_cache = QPainterPath();
 #endif
+  if (!segment_index.isEmpty()) segment_index.clear();
   coordinates.append(point);
   pressures.append(_tool.width() * pressure);
   bool change = false;
@@ -180,33 +195,6 @@ void FullGraphicsPath::addPoint(const QPointF &point, const float pressure)
   if (change) prepareGeometryChange();
 }
 
-QList<AbstractGraphicsPath *> FullGraphicsPath::splitErase(
-    const QPointF &scene_pos, const qreal size) const
-{
-  if (!sceneBoundingRect()
-           .marginsAdded(QMarginsF(size, size, size, size))
-           .contains(scene_pos))
-    // If returned list contains only a nullptr, this is interpreted as "no
-    // changes".
-    return {nullptr};
-
-  QList<AbstractGraphicsPath *> list;
-  const qreal sizesq = size * size;
-  int first = 0, last = 0;
-  while (last < coordinates.length()) {
-    const QPointF diff = mapToScene(coordinates[last++]) - scene_pos;
-    if (QPointF::dotProduct(diff, diff) < sizesq) {
-      if (last > first + 2)
-        list.append(new FullGraphicsPath(this, first, last - 1));
-      first = last;
-    }
-  }
-  // If first == 0, then the path has not changed.
-  if (first == 0) return {nullptr};
-  if (last > first + 2) list.append(new FullGraphicsPath(this, first, last));
-  return list;
-}
-
 void FullGraphicsPath::changeWidth(const float newwidth) noexcept
 {
 #if (QT_VERSION >= QT_VERSION_CHECK(5, 13, 0))
@@ -259,5 +247,6 @@ AbstractGraphicsPath *FullGraphicsPath::copy() const
   newpath->setPos(pos());
   newpath->setTransform(transform());
   newpath->shape_cache = shape_cache;
+  newpath->segment_index = segment_index;
   return newpath;
 }
@@ -37,7 +37,12 @@ class FullGraphicsPath : public AbstractGraphicsPath
   /// coordinates and pressures must always have the same length.
   QVector<float> pressures;
 
+  /// Paint nodes first to last-1 (including filling) using given pen.
+  void paintRange(QPainter *painter, QPen &pen, const int first,
+                  const int last) const;
+
   friend class ShapeRecognizer;
+  friend class BinaryDrawings;
   friend QDataStream &operator<<(QDataStream &stream,
                                  const QGraphicsItem *item);
   friend QDataStream &operator>>(QDataStream &stream, QGraphicsItem *&item);
@@ -92,8 +97,10 @@ class FullGraphicsPath : public AbstractGraphicsPath
   /// @param pressure pen pressure at next node
   void addPoint(const QPointF &point, const float pressure);
 
-  QList<AbstractGraphicsPath *> splitErase(const QPointF &scene_pos,
-                                           const qreal size) const override;
+  AbstractGraphicsPath *subpath(int first, int last) const override
+  {
+    return new FullGraphicsPath(this, first, last);
+  }
 
   /// Change width in-place.
   /// @param newwidth new tool width
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef NUMBERSCANNER_H
+#define NUMBERSCANNER_H
+
+#include <QChar>
+#include <QStringView>
+#include <QtGlobal>
+#include <cmath>
+
+#include "src/config.h"
+
+/**
+ * @brief Scanner for lists of decimal numbers in strings
+ *
+ * Reads numbers separated by spaces or commas (as used in stroke
+ * coordinates and widths in Xournal++ files) directly from the string
+ * data, without creating intermediate string lists or allocating memory.
+ * Parsing follows the C locale. Tokens which are not numbers are read
+ * as 0, like QString::toDouble() does for invalid input.
+ */
+class NumberScanner
+{
+  const QChar *pos;
+  const QChar *const end;
+
+  static bool isSeparator(const QChar c) noexcept
+  {
+    return c == ' ' || c == ',' || c == '\n' || c == '\t' || c == '\r';
+  }
+
+  static bool isDigit(const QChar c) noexcept
+  {
+    return unsigned(c.unicode() - '0') < 10u;
+  }
+
+  static double power10(const int exponent) noexcept
+  {
+    // Powers of 10 up to 10^22 are exactly representable as double.
+    static constexpr double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return exponent <= 22 ? powers[exponent] : std::pow(10., exponent);
+  }
+
+  void skipSeparators() noexcept
+  {
+    while (pos < end && isSeparator(*pos)) ++pos;
+  }
+
+ public:
+  /// Construct scanner on string. The string must outlive this scanner.
+  explicit NumberScanner(QStringView string) noexcept
+      : pos(string.data()), end(string.data() + string.size())
+  {
+  }
+
+  /**
+   * Read next number.
+   * @param value is set to the number that was read.
+   * @return false if the end of the string was reached.
+   */
+  bool next(double &value) noexcept
+  {
+    skipSeparators();
+    if (pos >= end) return false;
+    bool negative = false;
+    if (*pos == '-' || *pos == '+') negative = (pos++)->unicode() == '-';
+    quint64 mantissa = 0;
+    int exponent = 0, digits = 0;
+    for (; pos < end && isDigit(*pos); ++pos, ++digits) {
+      // More than 19 digits do not fit into mantissa.
+      if (digits < 19)
+        mantissa = 10 * mantissa + (pos->unicode() - '0');
+      else
+        ++exponent;
+    }
+    if (pos < end && *pos == '.') {
+      for (++pos; pos < end && isDigit(*pos); ++pos, ++digits) {
+        if (digits < 19) {
+          mantissa = 10 * mantissa + (pos->unicode() - '0');
+          --exponent;
+        }
+      }
+    }
+    if (digits > 0 && pos < end && (*pos == 'e' || *pos == 'E')) {
+      ++pos;
+      bool negative_exponent = false;
+      if (pos < end && (*pos == '-' || *pos == '+'))
+        negative_exponent = (pos++)->unicode() == '-';
+      int explicit_exponent = 0;
+      for (; pos < end && isDigit(*pos); ++pos)
+        if (explicit_exponent < 10000)
+          explicit_exponent = 10 * explicit_exponent + (pos->unicode() - '0');
+      exponent += negative_exponent ? -explicit_exponent : explicit_exponent;
+    }
+    if (digits == 0 || (pos < end && !isSeparator(*pos))) {
+      // Invalid token: skip it.
+      while (pos < end && !isSeparator(*pos)) ++pos;
+      value = 0.;
+      return true;
+    }
+    // The result is correctly rounded only if mantissa < 2^53 and the power
+    // of 10 is exactly representable (up to 10^22). Otherwise it may differ
+    // from QString::toDouble() in the last bits, which does not matter for
+    // coordinates.
+    value = mantissa;
+    if (exponent < 0)
+      value /= power10(-exponent);
+    else if (exponent > 0)
+      value *= power10(exponent);
+    if (negative) value = -value;
+    return true;
+  }
+
+  /// Count the numbers (tokens) in string without parsing them.
+  static int count(QStringView string) noexcept
+  {
+    int number = 0;
+    bool in_token = false;
+    for (const QChar c : string) {
+      if (isSeparator(c))
+        in_token = false;
+      else if (!in_token) {
+        in_token = true;
+        ++number;
+      }
+    }
+    return number;
+  }
+};
+
+#endif  // NUMBERSCANNER_H
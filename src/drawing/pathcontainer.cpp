@@ -4,19 +4,22 @@
 #include "src/drawing/pathcontainer.h"
 
 #include <QGraphicsItem>
-#include <QGraphicsItemGroup>
 #include <QGraphicsScene>
 #include <QMargins>
-#include <QStringList>
+#include <QStringView>
 #include <QTextDocument>
 #include <QTransform>
 #include <QXmlStreamReader>
 #include <QXmlStreamWriter>
 #include <iterator>
+#include <utility>
+#include <vector>
 
 #include "src/drawing/basicgraphicspath.h"
+#include "src/drawing/binarydrawings.h"
 #include "src/drawing/fullgraphicspath.h"
 #include "src/drawing/graphicspictureitem.h"
+#include "src/drawing/numberscanner.h"
 #include "src/drawing/textgraphicsitem.h"
 #include "src/log.h"
 #include "src/names.h"
@@ -93,12 +96,28 @@ qreal PathContainer::zValueAfter(const QGraphicsItem *item) const noexcept
 void PathContainer::deleteStep(const drawHistory::Step &step) noexcept
 {
   debug_verbose(DebugDrawing, "deleting history step" << inHistory);
-  for (const auto &[item, z] : step.z_value_changes) releaseItem(item);
-  for (const auto &[item, z] : step.transformedItems) releaseItem(item);
-  for (const auto &[item, z] : step.textPropertiesChanges) releaseItem(item);
-  for (const auto &[item, z] : step.drawToolChanges) releaseItem(item);
-  for (const auto item : step.createdItems) releaseItem(item);
-  for (const auto item : step.deletedItems) releaseItem(item);
+  for (quint64 i = step.begin; i < step.end; ++i)
+    releaseItem(command(i).item);
+}
+
+void PathContainer::dropLastStep()
+{
+  const drawHistory::Step step = history.takeLast();
+  commands.erase(commands.end() - step.size(), commands.end());
+}
+
+void PathContainer::deleteFirstStep() noexcept
+{
+  const drawHistory::Step step = history.takeFirst();
+  deleteStep(step);
+  commands.erase(commands.begin(), commands.begin() + step.size());
+  commands_offset += step.size();
+}
+
+void PathContainer::deleteLastStep() noexcept
+{
+  deleteStep(history.last());
+  dropLastStep();
 }
 
 bool PathContainer::undo(QGraphicsScene *scene)
@@ -111,56 +130,52 @@ bool PathContainer::undo(QGraphicsScene *scene)
 
   const drawHistory::Step &step = history[history.length() - inHistory];
 
-  // 1. Undo transformations.
-  if (!step.transformedItems.empty())
-    for (const auto &[item, trans] : step.transformedItems)
-      item->setTransform(trans.inverted(), true);
-
-  // 2. Undo z value changes
-  if (!step.z_value_changes.empty())
-    for (const auto &[item, pair] : step.z_value_changes) {
+  // Undo all changes in reverse order.
+  for (quint64 i = step.end; i-- > step.begin;) {
+    const auto &[item, delta] = command(i);
+    if (const auto trans = std::get_if<drawHistory::TransformChange>(&delta))
+      // Undo transformation.
+      item->setTransform(trans->transform().inverted(), true);
+    else if (const auto z = std::get_if<drawHistory::ZValueChange>(&delta)) {
+      // Undo z value change.
       removeFromZOrder(item);
-      item->setZValue(pair.old_z);
+      item->setZValue(z->old_z);
       _z_order.insert(item);
-    }
-
-  // 3. Undo draw tool changes.
-  if (!step.drawToolChanges.empty())
-    for (const auto &[item, diff] : step.drawToolChanges) {
-      DrawTool tool = item->getTool();
-      tool.setPen(diff.old_pen);
-      tool.setCompositionMode(diff.old_mode);
-      tool.brush() = diff.old_brush;
-      item->changeTool(tool);
-      item->update();
-    }
-
-  // 4. Undo text tool changes.
-  if (!step.textPropertiesChanges.empty())
-    for (const auto &[item, prop] : step.textPropertiesChanges) {
-      item->setFont(prop.old_font);
-      item->setDefaultTextColor(
-          QColor::fromRgba(item->defaultTextColor().rgba() ^ prop.color_diff));
-      item->update();
-    }
-
-  // 5. Remove newly created items.
-  for (const auto item : step.createdItems) {
-    _ref_count[item].visible = false;
-    if (item->scene()) {
-      item->clearFocus();
-      item->scene()->removeItem(item);
-    }
-  }
-
-  // 6. Restore old items.
-  for (const auto item : step.deletedItems)
-    if (scene) {
+    } else if (const auto diff =
+                   std::get_if<drawHistory::DrawToolDifference>(&delta)) {
+      // Undo draw tool change.
+      auto path = static_cast<AbstractGraphicsPath *>(item);
+      DrawTool tool = path->getTool();
+      tool.setPen(diff->old_pen);
+      tool.setCompositionMode(diff->old_mode);
+      tool.brush() = diff->old_brush;
+      path->changeTool(tool);
+      path->update();
+    } else if (const auto prop =
+                   std::get_if<drawHistory::TextPropertiesDifference>(&delta)) {
+      // Undo text tool change.
+      auto text = static_cast<TextGraphicsItem *>(item);
+      text->setFont(prop->old_font);
+      text->setDefaultTextColor(
+          QColor::fromRgba(text->defaultTextColor().rgba() ^ prop->color_diff));
+      text->update();
+    } else if (std::holds_alternative<drawHistory::ItemCreated>(delta)) {
+      // Remove newly created item.
+      _ref_count[item].visible = false;
+      if (item->scene()) {
+        item->clearFocus();
+        item->scene()->removeItem(item);
+      }
+    } else if (std::holds_alternative<drawHistory::ItemDeleted>(delta) &&
+               scene) {
+      // Restore old item.
       scene->addItem(item);
       item->show();
       _ref_count[item].visible = true;
     }
+  }
 
+  _revision = ++revision_counter;
   return true;
 }
 
@@ -174,56 +189,53 @@ bool PathContainer::redo(QGraphicsScene *scene)
   // Move forward in history.
   inHistory--;
 
-  // 1. First remove items which were deleted in this step.
-  for (const auto item : step.deletedItems) {
-    _ref_count[item].visible = false;
-    if (item->scene()) {
-      item->clearFocus();
-      item->scene()->removeItem(item);
-    }
-  }
-
-  // 2. Restore newly created items.
-  for (const auto item : step.createdItems)
-    if (scene) {
-      scene->addItem(item);
-      item->show();
-      _ref_count[item].visible = true;
-    }
-
-  // 3. Redo draw tool changes.
-  if (!step.textPropertiesChanges.empty())
-    for (const auto &[item, prop] : step.textPropertiesChanges) {
-      item->setFont(prop.new_font);
-      item->setDefaultTextColor(
-          QColor::fromRgba(item->defaultTextColor().rgba() ^ prop.color_diff));
-      item->update();
-    }
-
-  // 4. Redo text tool changes.
-  if (!step.drawToolChanges.empty())
-    for (const auto &[item, diff] : step.drawToolChanges) {
-      DrawTool tool = item->getTool();
-      tool.setPen(diff.new_pen);
-      tool.setCompositionMode(diff.new_mode);
-      tool.brush() = diff.new_brush;
-      item->changeTool(tool);
-      item->update();
-    }
-
-  // 5. Redo z value changes
-  if (!step.z_value_changes.empty())
-    for (const auto &[item, pair] : step.z_value_changes) {
+  // Redo all changes in the order in which they were recorded.
+  for (quint64 i = step.begin; i < step.end; ++i) {
+    const auto &[item, delta] = command(i);
+    if (std::holds_alternative<drawHistory::ItemDeleted>(delta)) {
+      // Remove item which was deleted in this step.
+      _ref_count[item].visible = false;
+      if (item->scene()) {
+        item->clearFocus();
+        item->scene()->removeItem(item);
+      }
+    } else if (std::holds_alternative<drawHistory::ItemCreated>(delta)) {
+      // Restore newly created item.
+      if (scene) {
+        scene->addItem(item);
+        item->show();
+        _ref_count[item].visible = true;
+      }
+    } else if (const auto prop =
+                   std::get_if<drawHistory::TextPropertiesDifference>(&delta)) {
+      // Redo text tool change.
+      auto text = static_cast<TextGraphicsItem *>(item);
+      text->setFont(prop->new_font);
+      text->setDefaultTextColor(
+          QColor::fromRgba(text->defaultTextColor().rgba() ^ prop->color_diff));
+      text->update();
+    } else if (const auto diff =
+                   std::get_if<drawHistory::DrawToolDifference>(&delta)) {
+      // Redo draw tool change.
+      auto path = static_cast<AbstractGraphicsPath *>(item);
+      DrawTool tool = path->getTool();
+      tool.setPen(diff->new_pen);
+      tool.setCompositionMode(diff->new_mode);
+      tool.brush() = diff->new_brush;
+      path->changeTool(tool);
+      path->update();
+    } else if (const auto z = std::get_if<drawHistory::ZValueChange>(&delta)) {
+      // Redo z value change.
       removeFromZOrder(item);
-      item->setZValue(pair.new_z);
+      item->setZValue(z->new_z);
       _z_order.insert(item);
-    }
-
-  // 6. Redo transformations.
-  if (!step.transformedItems.empty())
-    for (const auto &[item, trans] : step.transformedItems)
-      item->setTransform(trans, true);
+    } else if (const auto trans =
+                   std::get_if<drawHistory::TransformChange>(&delta))
+      // Redo transformation.
+      item->setTransform(trans->transform(), true);
+  }
 
+  _revision = ++revision_counter;
   return true;
 }
 
@@ -242,7 +254,7 @@ void PathContainer::truncateHistory()
     // Clean up all "redo" options:
     // Delete the last <inHistory> history entries.
     while (inHistory > 0) {
-      deleteStep(history.takeLast());
+      deleteLastStep();
       --inHistory;
     }
   }
@@ -260,7 +272,7 @@ void PathContainer::clearHistory(int n)
   // history.length() - inHistory <= n .
   for (int i = history.length() - inHistory; i > n; i--)
     // Take the first step from history and remove it.
-    deleteStep(history.takeFirst());
+    deleteFirstStep();
 }
 
 bool PathContainer::clearPaths()
@@ -268,8 +280,7 @@ bool PathContainer::clearPaths()
   if (_ref_count.empty()) return false;
   truncateHistory();
   // Create a new history step.
-  history.append(drawHistory::Step());
-  auto &deletedItems = history.last().deletedItems;
+  appendStep();
 
   // Remove all paths from scene and fill history step.
   for (auto &[item, lookup] : _ref_count)
@@ -277,13 +288,13 @@ bool PathContainer::clearPaths()
       lookup.visible = false;
       if (item->scene()) {
         ++(lookup.ref_count);
-        deletedItems.append(item);
+        record(item, drawHistory::ItemDeleted());
         item->clearFocus();
         item->scene()->removeItem(item);
       }
     }
-  if (history.last().deletedItems.empty()) {
-    history.pop_back();
+  if (history.last().empty()) {
+    dropLastStep();
     return false;
   }
   limitHistory();
@@ -297,8 +308,8 @@ void PathContainer::appendForeground(QGraphicsItem *item)
   truncateHistory();
   keepItem(item, true);
   _z_order.insert(item);
-  history.append(drawHistory::Step());
-  history.last().createdItems.append(item);
+  appendStep();
+  record(item, drawHistory::ItemCreated());
   limitHistory();
 }
 
@@ -307,7 +318,7 @@ void PathContainer::startMicroStep()
   // Remove all "redo" options.
   truncateHistory();
   // Create new, empty history step.
-  history.append(drawHistory::Step());
+  appendStep();
   inHistory = -1;
 }
 
@@ -328,87 +339,19 @@ void PathContainer::eraserMicroStep(const QPointF &scene_pos, const qreal size)
   // intersect with scene_pos.
   // TODO: how inefficient is it to iterate over all paths (including hidden
   // paths)?
-  auto &step = history.last();
   for (const auto &[item, lookup] : _ref_count) {
     if (lookup.visible && item->scene() &&
+        (item->type() == FullGraphicsPath::Type ||
+         item->type() == BasicGraphicsPath::Type) &&
         item->sceneBoundingRect()
             .marginsAdded(QMargins(size, size, size, size))
             .contains(scene_pos)) {
-      QGraphicsScene *scene = item->scene();
-      switch (item->type()) {
-        case AbstractGraphicsPath::Type:
-        case FullGraphicsPath::Type:
-        case BasicGraphicsPath::Type: {
-          auto path = static_cast<AbstractGraphicsPath *>(item);
-          // Apply eraser to path. Get a list of paths obtained by splitting
-          // path using the eraser.
-          const QList<AbstractGraphicsPath *> list =
-              path->splitErase(scene_pos, size);
-          // The special case list == {nullptr} is used to indicate that
-          // the eraser did not touch the path.
-          if (!list.empty() && !list.first()) break;
-          // Mark in history step that this path is deleted.
-          step.deletedItems.append(path);
-          keepItem(path, false);
-          // Hide the path, remove it from scene (if possible).
-          if (scene) scene->removeItem(path);
-
-          if (list.empty()) break;
-
-          // Path has changed or was split into multiple paths by erasing.
-          // Replace path by a QGraphicsItemGroup containing all new paths
-          // created from this path.
-
-          // Create the QGraphicsItemGroup.
-          const auto group = new QGraphicsItemGroup();
-          step.createdItems.append(group);
-          keepItem(group);
-          // Add all paths in list (which were obtained by erasing in path)
-          // to group.
-          for (const auto item : list) group->addToGroup(item);
-          // Replace path by group in scene (if possible).
-          if (scene) {
-            scene->addItem(group);
-            group->setZValue(path->zValue() + 1e-4);
-          } else
-            path->hide();
-          keepItem(group, true);
-          break;
-        }
-        case QGraphicsItemGroup::Type: {
-          // Here a path has already been split into a QGraphicsItemGroup by
-          // erasing. Apply eraser again to all items of the group. Within the
-          // group, stacking order is irrelevant since all items were created
-          // from the same path by erasing.
-          const auto group = static_cast<QGraphicsItemGroup *>(item);
-          const auto children = group->childItems();
-          for (const auto child : children)
-            // All items in the group should be paths. But we better check
-            // again.
-            if (child && (child->type() == FullGraphicsPath::Type ||
-                          child->type() == BasicGraphicsPath::Type)) {
-              // Apply eraser to child.
-              const auto list =
-                  static_cast<AbstractGraphicsPath *>(child)->splitErase(
-                      scene_pos, size);
-              // Again, if list.first() == nullptr, we should do nothing
-              // because the eraser did not hit the path.
-              if (list.empty() || list.first()) {
-                for (auto item : list) group->addToGroup(item);
-                group->removeFromGroup(child);
-                if (scene) {
-                  child->clearFocus();
-                  scene->removeItem(child);
-                }
-                // This item is not stored in any history and can be deleted.
-                delete child;  // TODO: Check if this breaks something.
-              }
-            }
-          break;
-        }
-        default:
-          break;
-      }
+      auto path = static_cast<AbstractGraphicsPath *>(item);
+      // Only mark the erased nodes in path. New paths are created in
+      // applyMicroStep().
+      const bool was_erased = path->hasErasedNodes();
+      if (path->eraseNodes(scene_pos, size) && !was_erased)
+        erased_paths.append(path);
     }
   }
 }
@@ -427,54 +370,37 @@ bool PathContainer::applyMicroStep()
     return false;
   }
 
-  debug_msg(DebugDrawing, "applying micro steps. Deleted items:"
-                              << history.last().deletedItems);
+  debug_msg(DebugDrawing,
+            "applying micro steps. Erased paths:" << erased_paths.size());
   const bool finalize =
       preferences()->global_flags & Preferences::FinalizeDrawnPaths;
-  auto &step = history.last();
-  {
-    qreal z;
-    QGraphicsScene *scene;
-    QGraphicsItemGroup *group;
-    QList<QGraphicsItem *> newItems;
-#if (QT_VERSION_MAJOR >= 6)
-    auto it = step.createdItems.cbegin();
-    while (it != step.createdItems.cend())
-#else
-    auto it = step.createdItems.begin();
-    while (it != step.createdItems.end())
-#endif
-    {
-      if (!*it)
-        it = step.createdItems.erase(it);
-      else if ((*it)->type() == QGraphicsItemGroup::Type) {
-        group = static_cast<QGraphicsItemGroup *>(*it);
-        z = group->zValue();
-        scene = group->scene();
-        // TODO: check whether the transformation of the group must be taken
-        // into account
-        const auto children = group->childItems();
-        for (const auto child : children) {
-          if (finalize && (child->type() == BasicGraphicsPath::Type ||
-                           child->type() == FullGraphicsPath::Type))
-            static_cast<AbstractGraphicsPath *>(child)->finalize();
-          group->removeFromGroup(child);
-          child->setZValue(z);
-          keepItem(child, true);
-          newItems << child;
-          _z_order.insert(child);
-        }
-        it = step.createdItems.erase(it);
-        if (scene) scene->removeItem(group);
-        releaseItem(group);
-      } else
-        ++it;
+  // Replace each path in which nodes were erased by its remaining parts.
+  for (const auto path : std::as_const(erased_paths)) {
+    const auto ranges = path->remainingRanges();
+    path->clearErasedNodes();
+    QGraphicsScene *scene = path->scene();
+    const qreal z = path->zValue() + 1e-4;
+    // Mark in history step that this path is deleted.
+    record(path, drawHistory::ItemDeleted());
+    keepItem(path, false);
+    if (scene) {
+      path->clearFocus();
+      scene->removeItem(path);
+    }
+    for (const auto &[first, last] : ranges) {
+      AbstractGraphicsPath *newpath = path->subpath(first, last);
+      if (finalize) newpath->finalize();
+      newpath->setZValue(z);
+      keepItem(newpath, true);
+      _z_order.insert(newpath);
+      record(newpath, drawHistory::ItemCreated());
+      if (scene) scene->addItem(newpath);
     }
-    step.createdItems << newItems;
   }
+  erased_paths.clear();
   inHistory = 0;
-  if (step.empty()) {
-    history.removeLast();
+  if (history.last().empty()) {
+    dropLastStep();
     return false;
   }
   limitHistory();
@@ -485,6 +411,7 @@ PathContainer *PathContainer::copy() const noexcept
 {
   PathContainer *container = new PathContainer(parent());
   container->inHistory = -2;
+  container->_source_revision = _revision;
   for (const auto &[item, lookup] : _ref_count)
     if (lookup.visible) switch (item->type()) {
         case TextGraphicsItem::Type: {
@@ -613,6 +540,19 @@ void PathContainer::writeXml(QXmlStreamWriter &writer) const
   }
 }
 
+void PathContainer::writeBinary(QByteArray &data, const PagePart part) const
+{
+  std::multiset<QGraphicsItem *, decltype(&cmp_by_z)> itemlist{&cmp_by_z};
+  for (const auto &[item, lookup] : _ref_count)
+    if (lookup.visible) itemlist.insert(item);
+  QByteArray items;
+  int number = 0;
+  for (const auto item : itemlist)
+    if (BinaryDrawings::writeItem(items, item)) ++number;
+  BinaryDrawings::writeLayerHeader(data, part, number);
+  data.append(items);
+}
+
 AbstractGraphicsPath *loadPath(QXmlStreamReader &reader)
 {
   const auto attr = reader.attributes();
@@ -671,19 +611,18 @@ TextGraphicsItem *loadTextItem(QXmlStreamReader &reader)
   item->setFont(font);
   item->setDefaultTextColor(
       rgba_to_color(reader.attributes().value("color").toString()));
-  QString transform_string = reader.attributes().value("transform").toString();
+  const QStringView transform_string = reader.attributes().value("transform");
   if (transform_string.length() >= 19 &&
-      transform_string.startsWith("matrix(") &&
-      transform_string.endsWith(")")) {
-    // TODO: this is inefficient
-    transform_string.remove("matrix(");
-    transform_string.remove(")");
-    const QStringList list =
-        transform_string.trimmed().replace(" ", ",").split(",");
-    if (list.length() == 6)
-      item->setTransform(QTransform(list[0].toDouble(), list[1].toDouble(),
-                                    list[2].toDouble(), list[3].toDouble(),
-                                    list[4].toDouble(), list[5].toDouble()));
+      transform_string.startsWith(QLatin1String("matrix(")) &&
+      transform_string.endsWith(QLatin1Char(')'))) {
+    const QStringView values =
+        transform_string.mid(7, transform_string.length() - 8);
+    if (NumberScanner::count(values) == 6) {
+      NumberScanner scanner(values);
+      qreal m[6];
+      for (auto &value : m) scanner.next(value);
+      item->setTransform(QTransform(m[0], m[1], m[2], m[3], m[4], m[5]));
+    }
   }
   const QString text = reader.readElementText();
   if (text.isEmpty()) {
@@ -698,7 +637,7 @@ void PathContainer::loadDrawings(QXmlStreamReader &reader)
 {
   truncateHistory();
   QGraphicsItem *item;
-  history.append(drawHistory::Step());
+  appendStep();
   while (reader.readNextStartElement()) {
     if (reader.name().toUtf8() == "stroke")
       item = loadPath(reader);
@@ -714,11 +653,11 @@ void PathContainer::loadDrawings(QXmlStreamReader &reader)
       item->setZValue(topZValue() + 10);
       keepItem(item, true);
       _z_order.insert(item);
-      history.last().createdItems.append(item);
+      record(item, drawHistory::ItemCreated());
     }
   }
   if (history.last().empty())
-    history.removeLast();
+    dropLastStep();
   else
     limitHistory();
 }
@@ -741,30 +680,36 @@ void PathContainer::loadDrawings(QXmlStreamReader &reader,
       item = loadPath(reader);
     else if (reader.name().toUtf8() == "text")
       item = loadTextItem(reader);
-    if (item) {
-      switch (current_layer) {
-        case FullPage:
-          if (center) center->appendForeground(item);
-          break;
-        case LeftHalf:
-          if (left) left->appendForeground(item);
-          break;
-        case RightHalf:
-          if (right) right->appendForeground(item);
-          break;
-        default:
-          if (center) center->appendForeground(item);
-          if (item->sceneBoundingRect().center().x() < page_half) {
-            if (left) left->appendForeground(item);
-          } else if (right)
-            right->appendForeground(item);
-          break;
-      }
-    }
+    if (item)
+      distributeItem(item, current_layer, center, left, right, page_half);
     if (!reader.isEndElement()) reader.skipCurrentElement();
   }
 }
 
+void PathContainer::distributeItem(QGraphicsItem *item, const PagePart part,
+                                   PathContainer *center, PathContainer *left,
+                                   PathContainer *right, const qreal page_half)
+{
+  switch (part) {
+    case FullPage:
+      if (center) center->appendForeground(item);
+      break;
+    case LeftHalf:
+      if (left) left->appendForeground(item);
+      break;
+    case RightHalf:
+      if (right) right->appendForeground(item);
+      break;
+    default:
+      if (center) center->appendForeground(item);
+      if (item->sceneBoundingRect().center().x() < page_half) {
+        if (left) left->appendForeground(item);
+      } else if (right)
+        right->appendForeground(item);
+      break;
+  }
+}
+
 QRectF PathContainer::boundingBox() const noexcept
 {
   QRectF rect;
@@ -780,13 +725,9 @@ void PathContainer::replaceItem(QGraphicsItem *olditem, QGraphicsItem *newitem)
   truncateHistory();
   if (olditem && !history.empty()) {
     const auto &laststep = history.last();
-    if (laststep.createdItems.size() == 1 &&
-        laststep.createdItems.first() == olditem &&
-        laststep.deletedItems.size() == 0 &&
-        laststep.z_value_changes.size() == 0 &&
-        laststep.transformedItems.size() == 0 &&
-        laststep.drawToolChanges.size() == 0 &&
-        laststep.textPropertiesChanges.size() == 0 &&
+    if (laststep.size() == 1 && command(laststep.begin).item == olditem &&
+        std::holds_alternative<drawHistory::ItemCreated>(
+            command(laststep.begin).delta) &&
         olditem->type() == TextGraphicsItem::Type &&
         static_cast<TextGraphicsItem *>(olditem)->isEmpty()) {
       debug_msg(DebugDrawing, "Deleting empty text item" << olditem);
@@ -802,11 +743,10 @@ void PathContainer::replaceItem(QGraphicsItem *olditem, QGraphicsItem *newitem)
       olditem = nullptr;
     }
   }
-  history.append(drawHistory::Step());
-  auto &step = history.last();
+  appendStep();
   if (olditem) {
     keepItem(olditem, false);
-    step.deletedItems.append(olditem);
+    record(olditem, drawHistory::ItemDeleted());
     if (olditem->scene()) {
       olditem->clearFocus();
       olditem->scene()->removeItem(olditem);
@@ -839,7 +779,7 @@ void PathContainer::replaceItem(QGraphicsItem *olditem, QGraphicsItem *newitem)
       }
     } else
       _z_order.insert(newitem);
-    step.createdItems.append(newitem);
+    record(newitem, drawHistory::ItemCreated());
   }
   limitHistory();
 }
@@ -848,15 +788,14 @@ void PathContainer::addItemsForeground(const QList<QGraphicsItem *> &items)
 {
   if (items.empty()) return;
   truncateHistory();
-  history.append(drawHistory::Step());
-  auto &createdItems = history.last().createdItems;
+  appendStep();
   qreal z = topZValue();
   for (const auto item : items)
     if (item) {
       z += 10;
       item->setZValue(z);
       keepItem(item, true);
-      createdItems.append(item);
+      record(item, drawHistory::ItemCreated());
       _z_order.insert(item);
     }
   limitHistory();
@@ -866,11 +805,10 @@ void PathContainer::removeItems(const QList<QGraphicsItem *> &items)
 {
   if (items.empty()) return;
   truncateHistory();
-  history.append(drawHistory::Step());
-  auto &deletedItems = history.last().deletedItems;
+  appendStep();
   for (const auto item : items)
     if (item) {
-      deletedItems.append(item);
+      record(item, drawHistory::ItemDeleted());
       keepItem(item, false);
       if (item->scene()) {
         item->clearFocus();
@@ -885,28 +823,33 @@ bool PathContainer::addChanges(
     std::map<AbstractGraphicsPath *, drawHistory::DrawToolDifference> *tools,
     std::map<TextGraphicsItem *, drawHistory::TextPropertiesDifference> *texts)
 {
-  drawHistory::Step step;
+  if ((!transforms || transforms->empty()) && (!tools || tools->empty()) &&
+      (!texts || texts->empty()))
+    return false;
+  truncateHistory();
+  appendStep();
   if (transforms)
     for (const auto &[item, trans] : *transforms)
       if (item) {
         keepItem(item);
-        step.transformedItems.insert({item, trans});
+        record(item, drawHistory::TransformChange(trans));
       }
   if (tools)
     for (const auto &[item, chng] : *tools)
       if (item) {
         keepItem(item);
-        step.drawToolChanges.insert({item, chng});
+        record(item, chng);
       }
   if (texts)
     for (const auto &[item, text] : *texts)
       if (item) {
         keepItem(item);
-        step.textPropertiesChanges.insert({item, text});
+        record(item, text);
       }
-  if (step.empty()) return false;
-  truncateHistory();
-  history.append(step);
+  if (history.last().empty()) {
+    dropLastStep();
+    return false;
+  }
   limitHistory();
   return true;
 }
@@ -935,11 +878,11 @@ bool PathContainer::bringToForeground(
     return false;
   // add an offset of 10
   z += 10;
-  history.append(drawHistory::Step());
-  auto &changes = history.last().z_value_changes;
+  appendStep();
   for (const auto item : to_foreground)
     if (item) {
-      changes.insert({item, {item->zValue(), item->zValue() + z}});
+      record(item,
+             drawHistory::ZValueChange{item->zValue(), item->zValue() + z});
       keepItem(item);
       removeFromZOrder(item);
       item->setZValue(item->zValue() + z);
@@ -963,11 +906,11 @@ bool PathContainer::bringToBackground(
   // z is now a scaling prefactor for z values
   z = 0.9 * z_bottom / z;
   if (z <= 0) return false;
-  history.append(drawHistory::Step());
-  auto &changes = history.last().z_value_changes;
+  appendStep();
   for (const auto item : to_background)
     if (item) {
-      changes.insert({item, {item->zValue(), z * item->zValue()}});
+      record(item,
+             drawHistory::ZValueChange{item->zValue(), z * item->zValue()});
       keepItem(item);
       removeFromZOrder(item);
       item->setZValue(z * item->zValue());
@@ -18,9 +18,11 @@
 #include <QPointF>
 #include <QString>
 #include <QTransform>
+#include <deque>
 #include <map>
 #include <set>
 #include <unordered_map>
+#include <variant>
 
 #include "src/config.h"
 #include "src/drawing/drawtool.h"
@@ -63,42 +65,67 @@ struct ZValueChange {
   qreal old_z;  ///< old Z value
   qreal new_z;  ///< new Z value
 };
+/**
+ * Transformation applied to an item, relative to its previous transformation.
+ * Only the affine part of a QTransform is stored: items are only translated,
+ * rotated and scaled (by SelectionTool), and the 6 values need less than
+ * half the memory of a full QTransform.
+ */
+struct TransformChange {
+  qreal m11, m12, m21, m22, dx, dy;
+  TransformChange(const QTransform &transform) noexcept
+      : m11(transform.m11()),
+        m12(transform.m12()),
+        m21(transform.m21()),
+        m22(transform.m22()),
+        dx(transform.dx()),
+        dy(transform.dy())
+  {
+  }
+  /// Reconstruct the QTransform.
+  QTransform transform() const noexcept
+  {
+    return QTransform(m11, m12, m21, m22, dx, dy);
+  }
+};
+/// Item was created (or shown) in a history step.
+struct ItemCreated {
+};
+/// Item was deleted (or hidden) in a history step.
+struct ItemDeleted {
+};
+
+/// Variant-encoded change of a single item.
+using Delta = std::variant<ItemCreated, ItemDeleted, ZValueChange,
+                           TransformChange, DrawToolDifference,
+                           TextPropertiesDifference>;
+
+/// One entry in the command log: an item and its change.
+struct Command {
+  /// Item that is changed. For DrawToolDifference this is an
+  /// AbstractGraphicsPath, for TextPropertiesDifference a TextGraphicsItem.
+  QGraphicsItem *item;
+  /// Change of the item.
+  Delta delta;
+};
 
 /**
  * One single step in the history of drawing.
- * This uses std::map to enable ranged expressions also in Qt 5.
+ *
+ * A step does not own its changes. It is a range [begin, end) of absolute
+ * indices in the command log of a PathContainer. Steps are contiguous:
+ * the end of one step is the begin of the next step.
  */
 struct Step {
-  // TODO: check if a std::variant would provide a more efficient history:
-  // std::map<QGraphicsItem*,
-  // std::variant<ZValueChange,QTransform,DrawToolDifference,TextPropertiesDifference>>
-  // changes;
-
-  /// Changes in the order of items.
-  std::map<QGraphicsItem *, ZValueChange> z_value_changes;
-
-  /// Items with the transformation applied in this history step.
-  std::map<QGraphicsItem *, QTransform> transformedItems;
-
-  /// Changes of draw tool.
-  std::map<AbstractGraphicsPath *, DrawToolDifference> drawToolChanges;
-
-  /// Changes of text properties.
-  std::map<TextGraphicsItem *, TextPropertiesDifference> textPropertiesChanges;
-
-  /// Newly created items with their index after the history step.
-  QList<QGraphicsItem *> createdItems;
-
-  /// Deleted items with their indices before the history step.
-  QList<QGraphicsItem *> deletedItems;
+  /// Absolute index of the first command of this step.
+  quint64 begin = 0;
+  /// Absolute index after the last command of this step.
+  quint64 end = 0;
 
   /// Check whether this step includes any changes.
-  bool empty() const
-  {
-    return transformedItems.empty() && drawToolChanges.empty() &&
-           textPropertiesChanges.empty() && createdItems.empty() &&
-           deletedItems.empty() && z_value_changes.empty();
-  }
+  bool empty() const noexcept { return begin == end; }
+  /// Number of commands in this step.
+  quint64 size() const noexcept { return end - begin; }
 };
 }  // namespace drawHistory
 Q_DECLARE_METATYPE(drawHistory::Step);
@@ -164,10 +191,57 @@ class PathContainer : public QObject
   /// It contains all items, including history.
   std::multiset<QGraphicsItem *, decltype(&cmp_by_z)> _z_order{&cmp_by_z};
 
+  /// Log of all changes of items in history. Steps in history refer to
+  /// ranges in this log. std::deque allocates the commands in large blocks,
+  /// which are reused when history is truncated or cleared.
+  std::deque<drawHistory::Command> commands;
+
+  /// Absolute index of commands.front(). This increases when the oldest
+  /// history steps are removed.
+  quint64 commands_offset = 0;
+
   /// List of changes forming the history of this, in the order in which they
   /// were created.
   QList<drawHistory::Step> history;
 
+  /// Absolute index after the last command in commands.
+  quint64 commandsEnd() const noexcept
+  {
+    return commands_offset + commands.size();
+  }
+  /// Command in the log at absolute index.
+  const drawHistory::Command &command(const quint64 index) const
+  {
+    return commands[index - commands_offset];
+  }
+  /// Append a new, empty step to history.
+  void appendStep()
+  {
+    const quint64 end = commandsEnd();
+    history.append({end, end});
+  }
+  /// Record a change of an item in the latest history step.
+  void record(QGraphicsItem *item, drawHistory::Delta &&delta)
+  {
+    commands.push_back({item, std::move(delta)});
+    ++history.last().end;
+    _revision = ++revision_counter;
+  }
+
+  /// Counter for revisions of all PathContainers.
+  inline static quint64 revision_counter = 0;
+  /// Revision of the drawings in this container.
+  /// @see revision()
+  quint64 _revision = ++revision_counter;
+  /// For copies: revision of the container from which this was copied.
+  quint64 _source_revision = 0;
+  /// Paths in which nodes were marked as erased in the current eraser step.
+  QList<AbstractGraphicsPath *> erased_paths;
+
+  /// Remove the latest step from history and the command log.
+  /// This does not release the items in this step.
+  void dropLastStep();
+
   /**
    * Decrease reference count for item. Delete item if reference
    * count reaches zero. Only deletes item if item was in _ref_count. */
@@ -189,6 +263,10 @@ class PathContainer : public QObject
   }
   /// Cleans up items in a history step.
   void deleteStep(const drawHistory::Step &step) noexcept;
+  /// Remove the oldest step from history and release its items.
+  void deleteFirstStep() noexcept;
+  /// Remove the latest step from history and release its items.
+  void deleteLastStep() noexcept;
 
   /**
    * Current position in history, measured from history.last().
@@ -343,10 +421,9 @@ class PathContainer : public QObject
 
   /**
    * Apply the micro steps forming an eraser step. In the eraser micro steps
-   * paths and history.last() do not have the usual form. Instead of
-   * top-level QGraphicsItems, paths also contains QGraphicsItemGroups of
-   * paths split by erasing. This is all fixed and brought to the usual form
-   * in applyMicroStep().
+   * paths are only marked as partially erased and history.last() is empty.
+   * Here each path in which nodes were erased is replaced by new paths
+   * containing the remaining parts, and the changes are added to history.
    * @return true if anything has changed, false otherwise.
    * @see startMicroStep()
    * @see eraserMicroStep()
@@ -354,14 +431,19 @@ class PathContainer : public QObject
   bool applyMicroStep();
 
   /**
-   * Single eraser move event. This erasees paths at scene_pos with given
-   * eraser size. Before this function startMicroStep() has to be called and
-   * afterwards a call to applyMicroStep() is necessary.
+   * Single eraser move event. This marks nodes of paths at scene_pos with
+   * given eraser size as erased. Before this function startMicroStep() has
+   * to be called and afterwards a call to applyMicroStep() is necessary.
    * @see startMicroStep()
    * @see applyMicroStep()
    */
   void eraserMicroStep(const QPointF &scene_pos, const qreal size = 10.);
 
+  /// Revision of the visible drawings. This changes whenever drawings are
+  /// added, removed, or modified, including undo and redo. Revisions are
+  /// unique among all PathContainers and increase monotonically.
+  quint64 revision() const noexcept { return _revision; }
+
   /// Check if this contains any information.
   /// @return true if this contains any elements or history steps.
   bool empty() const noexcept { return _ref_count.empty(); }
@@ -373,10 +455,21 @@ class PathContainer : public QObject
   /// @return true if inHistory == -2
   bool isPlainCopy() const noexcept { return inHistory == -2; }
 
+  /// Check if this is an unchanged copy of other and other has not changed
+  /// since this copy was created.
+  bool isPlainCopyOf(const PathContainer *other) const noexcept
+  {
+    return inHistory == -2 && _source_revision == other->_revision;
+  }
+
   /// Save drawings in xml format.
   /// @see loadDrawings(QXmlStreamReader &reader)
   void writeXml(QXmlStreamWriter &writer) const;
 
+  /// Append layer with all visible drawings in binary format to data.
+  /// @see BinaryDrawings
+  void writeBinary(QByteArray &data, const PagePart part) const;
+
   /// Load drawings for one specific page.
   /// @see writeXml(QXmlStreamWriter &writer) const
   void loadDrawings(QXmlStreamReader &reader);
@@ -388,6 +481,12 @@ class PathContainer : public QObject
                            PathContainer *left, PathContainer *right,
                            const qreal page_half);
 
+  /// Add item to the containers for given page part. Items of unknown page
+  /// part are sorted by their position relative to page_half.
+  static void distributeItem(QGraphicsItem *item, const PagePart part,
+                             PathContainer *center, PathContainer *left,
+                             PathContainer *right, const qreal page_half);
+
   /// @return bounding box of all drawings
   QRectF boundingBox() const noexcept;
 
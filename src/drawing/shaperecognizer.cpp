@@ -57,45 +57,54 @@ inline qreal distance_squared(const QPointF &p) noexcept
   return p.x() * p.x() + p.y() * p.y();
 }
 
-void ShapeRecognizer::calc_higher_moments() noexcept
+void ShapeRecognizer::addNode(const QPointF &p, const qreal weight)
 {
-  if (sxxxx > 0) return;
+  Moments next = cumulative_moments.constLast();
+  next.s += weight;
+  next.sx += weight * p.x();
+  next.sy += weight * p.y();
+  next.sxx += weight * p.x() * p.x();
+  next.sxy += weight * p.x() * p.y();
+  next.syy += weight * p.y() * p.y();
+  cumulative_moments.append(next);
+  sxxx += weight * p.x() * p.x() * p.x();
+  sxxy += weight * p.x() * p.x() * p.y();
+  sxyy += weight * p.x() * p.y() * p.y();
+  syyy += weight * p.y() * p.y() * p.y();
+  sxxxx += weight * p.x() * p.x() * p.x() * p.x();
+  sxxyy += weight * p.x() * p.x() * p.y() * p.y();
+  syyyy += weight * p.y() * p.y() * p.y() * p.y();
+}
+
+void ShapeRecognizer::update()
+{
+  int done = cumulative_moments.size() - 1;
+  if (done > path->size()) {
+    // The path was changed. Start again.
+    cumulative_moments = {Moments()};
+    sxxx = sxxy = sxyy = syyy = sxxxx = sxxyy = syyyy = 0.;
+    done = 0;
+  }
+  cumulative_moments.reserve(path->size() + 1);
   if (path->type() == FullGraphicsPath::Type) {
-    auto fullpath = static_cast<const FullGraphicsPath *>(path);
-    auto pit = fullpath->pressures.cbegin();
-    const auto pit_end = fullpath->pressures.cend();
-    auto cit = fullpath->coordinates.cbegin();
-    const auto cit_end = fullpath->coordinates.cend();
-    for (; cit != cit_end && pit != pit_end; ++pit, ++cit) {
-      sxxx += *pit * cit->x() * cit->x() * cit->x();
-      sxxy += *pit * cit->x() * cit->x() * cit->y();
-      sxyy += *pit * cit->x() * cit->y() * cit->y();
-      syyy += *pit * cit->y() * cit->y() * cit->y();
-      sxxxx += *pit * cit->x() * cit->x() * cit->x() * cit->x();
-      sxxyy += *pit * cit->x() * cit->x() * cit->y() * cit->y();
-      syyyy += *pit * cit->y() * cit->y() * cit->y() * cit->y();
-    }
+    const auto &pressures =
+        static_cast<const FullGraphicsPath *>(path)->pressures;
+    for (int i = done; i < path->size() && i < pressures.size(); ++i)
+      addNode(path->coordinates[i], pressures[i]);
   } else {
-    for (const QPointF &p : path->coordinates) {
-      sxxx += p.x() * p.x() * p.x();
-      sxxy += p.x() * p.x() * p.y();
-      sxyy += p.x() * p.y() * p.y();
-      syyy += p.y() * p.y() * p.y();
-      sxxxx += p.x() * p.x() * p.x() * p.x();
-      sxxyy += p.x() * p.x() * p.y() * p.y();
-      syyyy += p.y() * p.y() * p.y() * p.y();
-    }
+    for (int i = done; i < path->size(); ++i)
+      addNode(path->coordinates[i], 1.);
   }
 }
 
 BasicGraphicsPath *ShapeRecognizer::recognize()
 {
+  update();
   findLines();
   BasicGraphicsPath *generated_path = recognizeRect();
   if (generated_path) return generated_path;
   generated_path = recognizeLine();
   if (generated_path) return generated_path;
-  calc_higher_moments();
   generated_path = recognizeEllipse();
   return generated_path;
 }
@@ -162,54 +171,51 @@ BasicGraphicsPath *ShapeRecognizer::recognizeLine() const
   return pathitem;
 }
 
-void ShapeRecognizer::findLines() noexcept
+void ShapeRecognizer::findLines()
 {
   // 1. Collect line segments.
+  // Moments of nodes first to last-1 are the difference of prefix sums.
+  const auto range = [this](const int first, const int last) -> Moments {
+    const Moments &a = cumulative_moments[first],
+                  &b = cumulative_moments[last];
+    return {b.s - a.s,     b.sx - a.sx,   b.sy - a.sy,
+            b.sxx - a.sxx, b.sxy - a.sxy, b.syy - a.syy};
+  };
+  const int size = cumulative_moments.size() - 1;
+  line_segments.clear();
+  moments = cumulative_moments.constLast();
   qreal oldloss = -1;
-  const int step = path->size() >= 2 * PATH_SEGMENTS_LINE
-                       ? path->size() / PATH_SEGMENTS_LINE
-                       : 1;
-  const QPointF *p;
+  const int step =
+      size >= 2 * PATH_SEGMENTS_LINE ? size / PATH_SEGMENTS_LINE : 1;
   QList<Line> segment_lines;
   QList<Moments> segment_moments;
   Moments newmoments, oldmoments;
   Line line;
-  float weight = 1.;
-  const auto *pressures =
-      path->type() == FullGraphicsPath::Type
-          ? &static_cast<const FullGraphicsPath *>(path)->pressures
-          : nullptr;
   debug_msg(DebugDrawing, "Start searching lines");
-  for (int i = 0, start = 0; i < path->size(); ++i) {
-    if (pressures) weight = pressures->at(i);
-    p = &path->coordinates[i];
-    newmoments.s += weight;
-    newmoments.sx += weight * p->x();
-    newmoments.sy += weight * p->y();
-    newmoments.sxx += weight * p->x() * p->x();
-    newmoments.sxy += weight * p->x() * p->y();
-    newmoments.syy += weight * p->y() * p->y();
-    if (i > start + 2 && i % step == 0) {
-      line = newmoments.line(false);
-      if (oldloss >= 0 &&
-          (line.loss > LINE_LOSS_THRESHOLD ||
-           (oldloss - line.loss) > 8 * step / (i - start) * line.loss)) {
-        segment_moments.append(oldmoments);
-        moments += newmoments;
-        segment_lines.append(oldmoments.line());
-        newmoments.reset();
-        start = i;
-        oldloss = -1;
-      } else {
-        oldmoments = newmoments;
-        oldloss = line.loss;
-      }
+  // A segment contains the nodes begin to i. Lines are only fitted at
+  // multiples of step.
+  int start = 0, begin = 0;
+  for (int i = step; i < size; i += step) {
+    if (i <= start + 2) continue;
+    newmoments = range(begin, i + 1);
+    line = newmoments.line(false);
+    if (oldloss >= 0 &&
+        (line.loss > LINE_LOSS_THRESHOLD ||
+         (oldloss - line.loss) > 8 * step / (i - start) * line.loss)) {
+      segment_moments.append(oldmoments);
+      segment_lines.append(oldmoments.line());
+      start = i;
+      begin = i + 1;
+      oldloss = -1;
+    } else {
+      oldmoments = newmoments;
+      oldloss = line.loss;
     }
   }
+  // Last segment: all nodes after the last split.
+  newmoments = range(begin, size);
   segment_moments.append(newmoments);
   segment_lines.append(newmoments.line());
-  moments += newmoments;
-
   // 2. Filter and combine line segments.
   const qreal total_var = moments.std();
   oldmoments = {0, 0, 0, 0, 0, 0};
@@ -5,6 +5,7 @@
 #define SHAPERECOGNIZER_H
 
 #include <QList>
+#include <QVector>
 #include <QtGlobal>
 #include <cmath>
 
@@ -14,12 +15,19 @@
 constexpr qreal PI = 3.1415926535897932384626433;
 
 class BasicGraphicsPath;
+class QPointF;
 class AbstractGraphicsPath;
 
 /**
- * @brief ShapeRecognizer: use only temporarily to analyze a path
+ * @brief ShapeRecognizer: analyze a path while it is drawn
  *
- * Objects of this class should only briefly be created for a given path and
+ * The moments of the path are updated incrementally when nodes are added to
+ * the path. Prefix sums of the moments are kept for all nodes, such that
+ * finding line segments only needs to fit lines at a fixed number of
+ * positions. recognize() can therefore be called while drawing (e.g. for a
+ * preview) and at the end of the stroke without a noticeable delay.
+ *
+ * The path must not be changed except for adding nodes, and the recognizer
  * must be deleted before deleting the path.
  */
 class ShapeRecognizer
@@ -107,6 +115,9 @@ class ShapeRecognizer
   /// Lines recognized in this path.
   QList<Line> line_segments;
 
+  /// Prefix sums of moments: cumulative_moments[i] contains nodes 0 to i-1.
+  QVector<Moments> cumulative_moments{Moments()};
+
   /// 0th, 1st and 2nd moments
   Moments moments;
   qreal sxxx = 0.,  ///< weighted sum of x*x*x
@@ -201,8 +212,8 @@ class ShapeRecognizer
            4 * bc * my * moments.sy;
   }
 
-  /// Compute third and fourth statistical moments of points in path.
-  void calc_higher_moments() noexcept;
+  /// Add node with given weight to cumulative_moments and higher moments.
+  void addNode(const QPointF &p, const qreal weight);
 
   /// Check if path is a line.
   /// Return a BasicGraphicsPath* representing this line if
@@ -221,7 +232,7 @@ class ShapeRecognizer
 
   /// Recognize line segments in this stoke. Populate moments and line_segments.
   /// This function must be called before trying to fit any shapes.
-  void findLines() noexcept;
+  void findLines();
 
  public:
   /// Trivial constructor.
@@ -230,7 +241,10 @@ class ShapeRecognizer
   /// Trivial destructor.
   ~ShapeRecognizer() {}
 
-  /// Try to recognize a known shape in path.
+  /// Update moments with nodes added to the path since the last update.
+  void update();
+
+  /// Try to recognize a known shape in path. This includes update().
   /// Return nullptr if no shape was detected.
   BasicGraphicsPath *recognize();
 };
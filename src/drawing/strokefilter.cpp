@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/drawing/strokefilter.h"
+
+#include <cmath>
+
+void StrokeFilter::start(const QPointF &pos, const float pressure,
+                         const qreal min_distance, const qreal smoothing)
+{
+  pending.clear();
+  last_accepted = last_raw = {pos, pressure};
+  smoothed = velocity_pos = pos;
+  min_distance_squared = min_distance * min_distance;
+  this->smoothing = smoothing > 0. && smoothing < 1. ? smoothing : 0.;
+  velocity = QPointF();
+  velocity_time = 0.;
+  clock.start();
+}
+
+void StrokeFilter::push(const QPointF &pos, const float pressure)
+{
+  last_raw = {pos, pressure};
+
+  // Events often arrive in bursts. Only update the velocity if enough time
+  // has passed to get a meaningful value.
+  const qreal time = 1e-6 * clock.nsecsElapsed();
+  if (time - velocity_time >= velocity_interval) {
+    const QPointF current = (pos - velocity_pos) / (time - velocity_time);
+    velocity = velocity.isNull() ? current : 0.5 * (velocity + current);
+    velocity_time = time;
+    velocity_pos = pos;
+  }
+
+  smoothed = smoothing * smoothed + (1. - smoothing) * pos;
+  const QPointF diff = smoothed - last_accepted.pos;
+  if (QPointF::dotProduct(diff, diff) < min_distance_squared &&
+      std::abs(pressure - last_accepted.pressure) < pressure_threshold)
+    return;
+  last_accepted = {smoothed, pressure};
+  pending.append(last_accepted);
+}
+
+QVector<StrokeFilter::Sample> StrokeFilter::take()
+{
+  QVector<Sample> samples;
+  samples.swap(pending);
+  return samples;
+}
+
+QVector<StrokeFilter::Sample> StrokeFilter::finish()
+{
+  if (last_raw.pos != last_accepted.pos) {
+    last_accepted = last_raw;
+    pending.append(last_raw);
+  }
+  velocity = QPointF();
+  return take();
+}
@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef STROKEFILTER_H
+#define STROKEFILTER_H
+
+#include <QElapsedTimer>
+#include <QPointF>
+#include <QVector>
+
+#include "src/config.h"
+
+/**
+ * @brief Filter for input samples of freehand strokes
+ *
+ * Tablets may send several hundred events per second. SlideScene collects
+ * these samples here and adds them to the path once per display frame.
+ *
+ * Positions are smoothed with an exponential moving average. Samples closer
+ * than a minimal distance to the previous node are dropped, unless the
+ * pressure has changed noticeably. The pressure is never smoothed. finish()
+ * keeps the last raw sample, such that the stroke ends where the pen was
+ * lifted.
+ *
+ * The velocity of the input is used to predict the position of the pen a
+ * few milliseconds ahead. The prediction is only shown while drawing and
+ * never added to the path.
+ */
+class StrokeFilter
+{
+ public:
+  /// Input sample in scene coordinates.
+  struct Sample {
+    QPointF pos;
+    float pressure;
+  };
+
+ private:
+  /// Samples with smaller pressure difference to the previous node may be
+  /// dropped.
+  static constexpr float pressure_threshold = 0.05;
+  /// Minimal time in ms between two updates of the velocity.
+  static constexpr qreal velocity_interval = 4.;
+
+  /// Accepted samples which have not been taken yet.
+  QVector<Sample> pending;
+  /// Latest accepted sample.
+  Sample last_accepted;
+  /// Latest raw sample.
+  Sample last_raw;
+  /// Smoothed position.
+  QPointF smoothed;
+  /// Square of the minimal distance between nodes.
+  qreal min_distance_squared = 0.;
+  /// Weight of the previous position in smoothing (0 to <1).
+  qreal smoothing = 0.;
+
+  /// Clock for velocity estimation.
+  QElapsedTimer clock;
+  /// Time (ms) and position of the latest velocity update.
+  qreal velocity_time = 0.;
+  QPointF velocity_pos;
+  /// Estimated velocity in points per ms.
+  QPointF velocity;
+
+ public:
+  /// Start a new stroke at pos. The first sample is not returned by take().
+  /// @param min_distance minimal distance between nodes in points
+  /// @param smoothing weight of previous position, 0 disables smoothing
+  void start(const QPointF &pos, const float pressure,
+             const qreal min_distance, const qreal smoothing);
+
+  /// Add raw sample.
+  void push(const QPointF &pos, const float pressure);
+
+  /// Check whether accepted samples are waiting.
+  bool hasPending() const noexcept { return !pending.isEmpty(); }
+
+  /// Return and clear accepted samples.
+  QVector<Sample> take();
+
+  /// Return and clear accepted samples, including the latest raw sample if
+  /// it differs from the latest node.
+  QVector<Sample> finish();
+
+  /// Predicted pen position ahead_ms after the latest sample.
+  QPointF predict(const qreal ahead_ms) const noexcept
+  {
+    return last_raw.pos + ahead_ms * velocity;
+  }
+};
+
+#endif  // STROKEFILTER_H
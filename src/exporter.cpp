@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/exporter.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+#include <QPicture>
+#include <QRunnable>
+#include <QSvgGenerator>
+#include <QThreadPool>
+#include <QVector>
+#include <algorithm>
+#include <atomic>
+
+#include "src/log.h"
+#include "src/pdfmaster.h"
+#include "src/preferences.h"
+#include "src/rendering/abstractrenderer.h"
+#include "src/rendering/pdfdocument.h"
+#ifdef USE_MUPDF
+#include "src/rendering/mupdfdocument.h"
+#endif
+
+namespace
+{
+/// Worker in the thread pool, which processes pages until all pages are
+/// done.
+class PageTask : public QRunnable
+{
+  const Exporter::PageFunction &task;
+  const int pages;
+  std::atomic<int> &next_page;
+  std::atomic<int> &failures;
+
+ public:
+  PageTask(const Exporter::PageFunction &task, const int pages,
+           std::atomic<int> &next_page, std::atomic<int> &failures)
+      : task(task), pages(pages), next_page(next_page), failures(failures)
+  {
+  }
+
+  void run() override
+  {
+    // The renderer is created when it is first needed and then used for
+    // all pages of this worker.
+    std::unique_ptr<AbstractRenderer> renderer;
+    for (int page = next_page++; page < pages; page = next_page++)
+      if (!task(page, renderer)) ++failures;
+  }
+};
+}  // namespace
+
+Exporter::Exporter(std::shared_ptr<PdfMaster> pdf, const qreal dpi,
+                   const int threads)
+    : pdf(pdf),
+      page_part(preferences()->default_page_part),
+      resolution(dpi / 72),
+      threads(std::max(threads, 1))
+{
+}
+
+Exporter::Format Exporter::parseFormat(const QString &format,
+                                       const QString &target)
+{
+  const QString name = format.isEmpty()
+                           ? QFileInfo(target).suffix().toLower()
+                           : format.toLower();
+  if (name == "png" || (format.isEmpty() && name.isEmpty())) return PngFormat;
+  if (name == "svg") return SvgFormat;
+  if (name == "pdf") return PdfFormat;
+  return InvalidFormat;
+}
+
+bool Exporter::exportFiles(const QString &target, const Format format) const
+{
+  if (!pdf || target.isEmpty()) return false;
+  // Copies of drawings in cumulative overlay mode must be created in the
+  // main thread.
+  if (preferences()->overlay_mode == OverlayDrawingMode::Cumulative)
+    for (int page = 0; page < pdf->numberOfPages(); ++page)
+      pdf->pathContainerCreate({page, page_part});
+  switch (format) {
+    case PngFormat:
+      return exportPng(target);
+    case SvgFormat:
+      return exportSvg(target);
+    case PdfFormat:
+      return exportPdf(target);
+    default:
+      qCritical() << tr("Invalid export format");
+      return false;
+  }
+}
+
+int Exporter::forAllPages(const PageFunction &task) const
+{
+  std::atomic<int> next_page{0}, failures{0};
+  const int pages = pdf->numberOfPages();
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  for (int i = 0; i < std::min(threads, pages); ++i)
+    pool.start(new PageTask(task, pages, next_page, failures));
+  pool.waitForDone();
+  return failures;
+}
+
+QVector<QPicture> Exporter::recordDrawings() const
+{
+  QVector<QPicture> drawings(pdf->numberOfPages());
+  for (int page = 0; page < drawings.size(); ++page)
+    drawings[page] = pdf->recordDrawings({page, page_part});
+  return drawings;
+}
+
+QString Exporter::pageFileName(const QDir &dir, const int page,
+                               const QString &suffix) const
+{
+  const int digits = QString::number(pdf->numberOfPages()).size();
+  return dir.absoluteFilePath(
+      QString("page-%1.").arg(page + 1, digits, 10, QChar('0')) + suffix);
+}
+
+QImage Exporter::renderPage(const int page,
+                            std::unique_ptr<AbstractRenderer> &renderer) const
+{
+  QImage image;
+  if (!renderer)
+    renderer.reset(createRenderer(pdf->getDocument(), page_part));
+  if (renderer && renderer->isValid())
+    image = renderer->renderImage(
+        page, resolution,
+        AbstractRenderer::partRect(pdf->getDocument()->pageSize(page),
+                                   page_part));
+  if (image.isNull())
+    qCritical() << tr("Rendering page failed for (page, resolution) =")
+                << page << resolution;
+  return image;
+}
+
+bool Exporter::exportPng(const QString &dirname) const
+{
+  QDir dir(dirname);
+  if (!dir.mkpath(".")) return false;
+  const QVector<QPicture> drawings = recordDrawings();
+  const int failures = forAllPages([&](const int page, auto &renderer) {
+    QImage image = renderPage(page, renderer);
+    if (image.isNull()) return false;
+    image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.scale(resolution, resolution);
+    painter.drawPicture(0, 0, drawings[page]);
+    painter.end();
+    return image.save(pageFileName(dir, page, "png"), "PNG");
+  });
+  debug_msg(DebugRendering, "exported PNG images:" << failures << "failures");
+  return failures == 0;
+}
+
+bool Exporter::exportSvg(const QString &dirname) const
+{
+  QDir dir(dirname);
+  if (!dir.mkpath(".")) return false;
+  const QVector<QPicture> drawings = recordDrawings();
+  const int failures = forAllPages([&](const int page, auto &renderer) {
+    const QImage image = renderPage(page, renderer);
+    if (image.isNull()) return false;
+    QSvgGenerator generator;
+    generator.setFileName(pageFileName(dir, page, "svg"));
+    pdf->writeSvg(generator, {page, page_part}, true, image, &drawings[page]);
+    return true;
+  });
+  debug_msg(DebugRendering, "exported SVG images:" << failures << "failures");
+  return failures == 0;
+}
+
+bool Exporter::exportPdf(const QString &filename) const
+{
+#ifdef USE_MUPDF
+  if (pdf->getDocument()->type() != PdfEngine::MuPdf) {
+    qCritical() << tr("Exporting PDF files requires the MuPDF engine");
+    return false;
+  }
+  // Write drawings to SVG in parallel. MuPDF then combines them with the
+  // pages in this thread.
+  QVector<QByteArray> overlays(pdf->numberOfPages());
+  QByteArray *const data = overlays.data();
+  const QVector<QPicture> drawings = recordDrawings();
+  const int failures = forAllPages([&](const int page, auto &) {
+    if (drawings[page].isNull()) return true;
+    QBuffer buffer(&data[page]);
+    QSvgGenerator generator;
+    generator.setOutputDevice(&buffer);
+    pdf->writeSvg(generator, {page, page_part}, true, QImage(),
+                  &drawings[page]);
+    return true;
+  });
+  const auto doc =
+      std::static_pointer_cast<const MuPdfDocument>(pdf->getDocument());
+  return failures == 0 && doc->exportPdf(filename, page_part, overlays);
+#else
+  qCritical() << tr("Exporting PDF files requires the MuPDF engine");
+  return false;
+#endif
+}
@@ -0,0 +1,100 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <QCoreApplication>
+#include <QImage>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+#include "src/config.h"
+#include "src/enumerates.h"
+
+class QDir;
+class QPicture;
+class AbstractRenderer;
+class PdfMaster;
+
+/**
+ * @brief Export of all pages including drawings without GUI
+ *
+ * Used for the command line option --export. Pages are rendered and
+ * combined with the drawings in parallel using a QThreadPool. The drawings
+ * are recorded as QPictures in the calling (main) thread before, such that
+ * the worker threads do not access the graphics items. Each worker uses its
+ * own renderer.
+ *
+ * Output formats:
+ * - PNG: one image per page.
+ * - SVG: one file per page containing the rendered page as image and the
+ *   drawings as vector graphics.
+ * - PDF: single file, written by MuPDF. The PDF content is kept and the
+ *   drawings are added as vector graphics.
+ */
+class Exporter
+{
+  Q_DECLARE_TR_FUNCTIONS(Exporter)
+
+ public:
+  enum Format {
+    InvalidFormat,
+    PngFormat,
+    SvgFormat,
+    PdfFormat,
+  };
+
+  /// Task for one page, executed in a worker thread. The renderer belongs
+  /// to the worker and is nullptr until the task creates it.
+  using PageFunction =
+      std::function<bool(const int, std::unique_ptr<AbstractRenderer> &)>;
+
+ private:
+  /// Document with drawings.
+  std::shared_ptr<PdfMaster> pdf;
+  /// Page part which is exported.
+  PagePart page_part;
+  /// Resolution in pixels per point.
+  qreal resolution;
+  /// Maximum number of threads.
+  int threads;
+
+  /// Run task for all pages in a thread pool with at most threads workers.
+  /// @return number of pages for which task returned false
+  int forAllPages(const PageFunction &task) const;
+
+  /// Record the drawings of all pages. Must be called in the main thread.
+  QVector<QPicture> recordDrawings() const;
+
+  /// File name for page in dir, numbered from 1.
+  QString pageFileName(const QDir &dir, const int page,
+                       const QString &suffix) const;
+
+  /// Render page and return it as image. Create renderer if it is nullptr.
+  QImage renderPage(const int page,
+                    std::unique_ptr<AbstractRenderer> &renderer) const;
+
+ public:
+  /// Constructor: use default page part from preferences.
+  Exporter(std::shared_ptr<PdfMaster> pdf, const qreal dpi, const int threads);
+
+  /// Get format from its name or from the suffix of target.
+  static Format parseFormat(const QString &format, const QString &target);
+
+  /// Export all pages to target in given format.
+  bool exportFiles(const QString &target, const Format format) const;
+
+  /// Export pages as PNG images to directory.
+  bool exportPng(const QString &dirname) const;
+
+  /// Export pages as SVG images to directory.
+  bool exportSvg(const QString &dirname) const;
+
+  /// Export pages to single PDF file.
+  bool exportPdf(const QString &filename) const;
+};
+
+#endif  // EXPORTER_H
@@ -321,6 +321,30 @@ void SettingsWidget::initMisc()
   spin_box->setMaximum(1000);
   layout->addRow(tr("History length hidden slides"), spin_box);
 
+  // Autosave
+  explanation_label = new QLabel(
+      tr("Drawings are saved automatically in the given interval (in seconds) "
+         "and can be restored after a crash. 0 disables autosave."),
+      misc);
+  explanation_label->setTextFormat(Qt::PlainText);
+  explanation_label->setWordWrap(true);
+  layout->addRow(explanation_label);
+
+  spin_box = new QSpinBox(misc);
+  spin_box->setMinimum(0);
+  spin_box->setMaximum(3600);
+  spin_box->setValue(preferences()->autosave_interval);
+#if (QT_VERSION_MAJOR >= 6)
+  connect(spin_box, &QSpinBox::valueChanged,
+          WritableGlobalPreferences::writable(),
+          &Preferences::setAutosaveInterval);
+#else
+  connect(spin_box, QOverload<int>::of(&QSpinBox::valueChanged),
+          WritableGlobalPreferences::writable(),
+          &Preferences::setAutosaveInterval);
+#endif
+  layout->addRow(tr("Autosave interval"), spin_box);
+
   // Enable/disable logging output
   explanation_label =
       new QLabel(tr("If opened in a terminal, slide changes can be logged to "
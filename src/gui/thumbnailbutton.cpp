@@ -38,11 +38,11 @@ void ThumbnailButton::keyPressEvent(QKeyEvent *event)
       event->accept();
       break;
     case Qt::Key_Left:
-      focusPreviousChild();
+      emit focusLeftRight(-1);
       event->accept();
       break;
     case Qt::Key_Right:
-      focusNextChild();
+      emit focusLeftRight(1);
       event->accept();
       break;
     case Qt::Key_Up:
@@ -109,6 +109,9 @@ class ThumbnailButton : public QLabel
   void updateFocus(ThumbnailButton *self);
   /// Tell thumbnail widget to move focus to the row above/below (updown=-1/+1).
   void focusUpDown(const char updown);
+  /// Tell thumbnail widget to move focus to the previous/next thumbnail
+  /// (leftright=-1/+1).
+  void focusLeftRight(const char leftright);
 };
 
 #endif  // THUMBNAILBUTTON_H
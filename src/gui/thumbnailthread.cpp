@@ -3,18 +3,28 @@
 
 #include "src/gui/thumbnailthread.h"
 
-#include <QPixmap>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #include "src/log.h"
 #include "src/preferences.h"
 #include "src/rendering/abstractrenderer.h"
 #include "src/rendering/pdfdocument.h"
+#include "src/rendering/pixcache.h"
 #ifdef USE_EXTERNAL_RENDERER
 #include "src/rendering/externalrenderer.h"
 #endif
 
-ThumbnailThread::ThumbnailThread(std::shared_ptr<const PdfDocument> document)
-    : document(document)
+ThumbnailThread::ThumbnailThread(std::shared_ptr<const PdfDocument> document,
+                                 const QList<const PixCache *> &caches)
+    : document(document), caches(caches)
 {
   if (!document) return;
 
@@ -23,7 +33,8 @@ ThumbnailThread::ThumbnailThread(std::shared_ptr<const PdfDocument> document)
   if (preferences()->renderer == Renderer::ExternalRenderer)
     renderer = new ExternalRenderer(preferences()->rendering_command,
                                     preferences()->rendering_arguments,
-                                    document, preferences()->default_page_part);
+                                    document, preferences()->default_page_part,
+                                    preferences()->rendering_worker);
   else
 #endif
     renderer = createRenderer(document, preferences()->default_page_part);
@@ -34,15 +45,115 @@ ThumbnailThread::ThumbnailThread(std::shared_ptr<const PdfDocument> document)
     qCritical() << tr("Creating renderer failed");
     return;
   }
+
+  cache_dir = thumbnailDirectory(document.get());
+  if (!cache_dir.isEmpty()) QDir().mkpath(cache_dir);
+}
+
+QString ThumbnailThread::thumbnailDirectory(const PdfDocument *document)
+{
+  const QString base =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  const QFileInfo info(document->getPath());
+  if (base.isEmpty() || !info.exists()) return QString();
+  // One directory per document path, containing one directory per
+  // modification time of the document.
+  const QByteArray key = QCryptographicHash::hash(
+      info.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+  return base + "/thumbnails/" + QString::fromLatin1(key.toHex()) + "/" +
+         QString::number(info.lastModified().toMSecsSinceEpoch());
+}
+
+void ThumbnailThread::pruneThumbnails(const PdfDocument *document)
+{
+  const QString current = thumbnailDirectory(document);
+  if (current.isEmpty()) return;
+  const QFileInfo current_info(current);
+  const QDir document_dir = current_info.dir();
+  // Thumbnails of older versions of this document.
+  for (const auto &entry :
+       document_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    if (entry.fileName() != current_info.fileName())
+      QDir(entry.absoluteFilePath()).removeRecursively();
+  // Mark the document as used.
+  QDir().mkpath(document_dir.absolutePath());
+  QFile used(document_dir.filePath("used"));
+  if (used.open(QFile::WriteOnly | QFile::Truncate)) used.close();
+  // Thumbnails of documents which have not been used for a long time.
+  const QDateTime limit =
+      QDateTime::currentDateTime().addDays(-max_thumbnail_age_days);
+  const QDir thumbnails_dir(QFileInfo(document_dir.absolutePath()).path());
+  for (const auto &entry :
+       thumbnails_dir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+    const QFileInfo stamp(entry.absoluteFilePath() + "/used");
+    const QDateTime last_used =
+        stamp.exists() ? stamp.lastModified() : entry.lastModified();
+    if (last_used < limit) {
+      debug_msg(DebugWidgets, "removing old thumbnails" << entry.fileName());
+      QDir(entry.absoluteFilePath()).removeRecursively();
+    }
+  }
+}
+
+QString ThumbnailThread::cachePath(const queue_entry &entry) const
+{
+  if (cache_dir.isEmpty()) return QString();
+  return cache_dir + QString("/%1-%2-%3.png")
+                         .arg(entry.page)
+                         .arg(int(renderer->pagePart()))
+                         .arg(qRound(1e4 * entry.resolution));
+}
+
+QImage ThumbnailThread::createThumbnail(const queue_entry &entry) const
+{
+  QImage image;
+  const QString path = cachePath(entry);
+  if (!path.isEmpty() && image.load(path, "PNG")) {
+    debug_verbose(DebugRendering, "thumbnail from disk" << entry.page);
+    return image;
+  }
+
+  // Downscale the page if it is available in a cache in sufficiently high
+  // resolution.
+  for (const auto cache : caches) {
+    qreal resolution;
+    const QByteArray data =
+        cache->cachedPage(document.get(), renderer->pagePart(), entry.page,
+                          entry.resolution, resolution);
+    if (!data.isEmpty() && image.loadFromData(data, "PNG")) {
+      debug_verbose(DebugRendering, "thumbnail from cache" << entry.page);
+      image = image.scaledToWidth(
+          qRound(image.width() * entry.resolution / resolution),
+          Qt::SmoothTransformation);
+      break;
+    }
+  }
+  if (image.isNull())
+    image = renderer->renderImage(
+        entry.page, entry.resolution,
+        AbstractRenderer::partRect(document->pageSize(entry.page),
+                                   renderer->pagePart()));
+
+  if (!path.isEmpty() && !image.isNull()) {
+    // QSaveFile avoids incomplete files if another thread or process writes
+    // the same thumbnail.
+    QSaveFile file(path);
+    if (file.open(QFile::WriteOnly) && image.save(&file, "PNG"))
+      file.commit();
+    else
+      file.cancelWriting();
+  }
+  return image;
 }
 
-void ThumbnailThread::timerEvent(QTimerEvent* event)
+void ThumbnailThread::timerEvent(QTimerEvent *event)
 {
-  if (!renderer || queue.isEmpty())
+  if (!renderer || queue.isEmpty()) {
     killTimer(event->timerId());
-  else {
+    timer_id = 0;
+  } else {
     queue_entry entry = queue.takeFirst();
-    emit sendThumbnail(entry.button_index,
-                       renderer->renderPixmap(entry.page, entry.resolution));
+    emit sendThumbnail(entry.button_index, entry.page, entry.resolution,
+                       createThumbnail(entry));
   }
 }
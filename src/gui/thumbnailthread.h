@@ -6,21 +6,31 @@
 
 #include <QList>
 #include <QObject>
+#include <QString>
 #include <memory>
 
 #include "src/config.h"
 #include "src/rendering/abstractrenderer.h"
 
-class QPixmap;
+class QImage;
 class PdfDocument;
+class PixCache;
 
 /**
- * @brief Worker object for rendering thumbnails in own thread
+ * @brief Worker object for creating thumbnails in own thread
  *
  * Created by ThumbnailWidget and moved to own thread, the ThumbnailThread
- * object renders thumbnail images and sends them to ThumbailWidget.
+ * object creates thumbnail images and sends them to ThumbailWidget.
  * The images are connected to the ThumbnailButtons, at which they will
- * be shown.
+ * be shown. ThumbnailWidget may use several ThumbnailThreads in parallel.
+ *
+ * Thumbnails are obtained from the first available source:
+ * 1. thumbnails stored on disk in a previous session,
+ * 2. pages in the cache of a slide (PixCache), which are downscaled,
+ * 3. rendering the page with the own renderer.
+ * New thumbnails are stored on disk. Thumbnails of older versions of a
+ * document and of documents which have not been opened for a while are
+ * removed, see pruneThumbnails().
  *
  * The images are not directly shown in the buttons from this thread,
  * because that should happen in the main thread.
@@ -32,6 +42,10 @@ class ThumbnailThread : public QObject
 {
   Q_OBJECT
 
+  /// Thumbnails of documents which were not used for this number of days
+  /// are removed from disk.
+  static constexpr int max_thumbnail_age_days = 30;
+
   /// container of page, button and resolution as queued for rendering
   struct queue_entry {
     /// Button which should receive the thumbnail
@@ -46,8 +60,22 @@ class ThumbnailThread : public QObject
   AbstractRenderer *renderer{nullptr};
   /// document, not owned by this.
   std::shared_ptr<const PdfDocument> document;
+  /// caches of slides from which thumbnails can be downscaled, not owned by
+  /// this.
+  QList<const PixCache *> caches;
+  /// directory for thumbnails of document on disk, empty if thumbnails
+  /// should not be stored.
+  QString cache_dir;
   /// queue of pages/thumbnails which should be rendered
   QList<queue_entry> queue;
+  /// id of the timer used for rendering, 0 if not rendering
+  int timer_id{0};
+
+  /// File name of a thumbnail in cache_dir.
+  QString cachePath(const queue_entry &entry) const;
+
+  /// Create thumbnail from the first available source.
+  QImage createThumbnail(const queue_entry &entry) const;
 
  protected:
   /// Timer event: render next slide;
@@ -55,28 +83,44 @@ class ThumbnailThread : public QObject
 
  public:
   /// Constructor: create renderer if document is not nullptr.
-  ThumbnailThread(std::shared_ptr<const PdfDocument> document = nullptr);
+  ThumbnailThread(std::shared_ptr<const PdfDocument> document = nullptr,
+                  const QList<const PixCache *> &caches = {});
 
   /// Destructor: delete renderer.
   ~ThumbnailThread() { delete renderer; }
 
+  /// Directory in which thumbnails of a document are stored.
+  static QString thumbnailDirectory(const PdfDocument *document);
+
+  /// Remove thumbnails of other versions of document and of documents
+  /// which have not been used for max_thumbnail_age_days.
+  static void pruneThumbnails(const PdfDocument *document);
+
  public slots:
-  /// Add entries to rendering queue.
-  void append(int button_index, qreal resolution, int page)
+  /// Add entries to rendering queue if target is this. Entries are
+  /// rendered in the order in which they are added.
+  void append(const ThumbnailThread *target, int button_index,
+              qreal resolution, int page)
   {
-    if (resolution > 0) queue.append({button_index, resolution, page});
+    if (target == this && resolution > 0)
+      queue.append({button_index, resolution, page});
   }
 
   /// Clear the queue.
   void clearQueue() { queue.clear(); }
 
   /// Do the work: render thumbnails for the queued pages.
-  void renderImages() { startTimer(0); }
+  void renderImages()
+  {
+    if (timer_id == 0) timer_id = startTimer(0);
+  }
 
  signals:
-  /// Send thumbnail back to ThumbnailWidget, which sets the pixmap
-  /// from the main thread.
-  void sendThumbnail(int button_index, const QPixmap pixmap);
+  /// Send thumbnail back to ThumbnailWidget, which converts it to a pixmap
+  /// in the main thread. page and resolution identify the request, because
+  /// the buttons may have changed in the meantime.
+  void sendThumbnail(int button_index, int page, qreal resolution,
+                     const QImage image);
 };
 
 #endif  // THUMBNAILTHREAD_H
@@ -3,11 +3,11 @@
 
 #include "src/gui/thumbnailwidget.h"
 
-#include <QGridLayout>
+#include <QImage>
 #include <QKeyEvent>
-#include <QLayoutItem>
 #include <QList>
 #include <QPixmap>
+#include <QScrollBar>
 #include <QScroller>
 #include <QShowEvent>
 #include <QSizeF>
@@ -29,33 +29,36 @@ ThumbnailWidget::ThumbnailWidget(std::shared_ptr<const PdfDocument> doc,
   setFocusPolicy(Qt::NoFocus);
   setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
   setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &ThumbnailWidget::updateVisible);
   initialize();
 }
 
-ThumbnailWidget::~ThumbnailWidget()
+ThumbnailWidget::~ThumbnailWidget() { deleteRenderingThreads(10000); }
+
+void ThumbnailWidget::deleteRenderingThreads(const int wait_ms)
 {
   emit interruptThread();
-  if (render_thread) {
+  for (const auto render_thread : std::as_const(render_threads))
     render_thread->thread()->quit();
-    render_thread->thread()->wait(10000);
+  for (const auto render_thread : std::as_const(render_threads)) {
+    render_thread->thread()->wait(wait_ms);
     delete render_thread;
   }
+  render_threads.clear();
 }
 
 void ThumbnailWidget::initialize()
 {
   debug_msg(DebugWidgets, "initializing ThumbnailWidget");
-  focused_button = nullptr;
-  current_page_button = nullptr;
-  delete widget();
-  delete layout();
-  setWidget(nullptr);
-  QGridLayout *layout = new QGridLayout(this);
-  layout->setSizeConstraint(QLayout::SetFixedSize);
-  layout->setSpacing(0);
-  QWidget *widget = new QWidget(this);
-  widget->setLayout(layout);
-  setWidget(widget);
+  focused_position = -1;
+  current_position = -1;
+  first_row = end_row = -1;
+  qDeleteAll(buttons);
+  buttons.clear();
+  pending.clear();
+  // Keep the widget, other objects may have installed event filters on it.
+  if (!widget()) setWidget(new QWidget(this));
   QScroller::grabGesture(this);
 }
 
@@ -67,13 +70,10 @@ void ThumbnailWidget::showEvent(QShowEvent *event)
   if (!event->spontaneous()) focusPage(preferences()->page);
 }
 
-ThumbnailButton *ThumbnailWidget::buttonAtPage(int page)
+int ThumbnailWidget::positionOfPage(int page) const
 {
-  if (!document || page < 0 || page >= preferences()->number_of_pages ||
-      !widget())
-    return nullptr;
-  QLayout *layout = widget()->layout();
-  if (!layout) return nullptr;
+  if (!document || page < 0 || page >= preferences()->number_of_pages)
+    return -1;
   if (_flags & SkipOverlays) {
     // Get sorted list of page label indices from master document.
     const QList<int> &list = document->overlayIndices();
@@ -84,22 +84,43 @@ ThumbnailButton *ThumbnailWidget::buttonAtPage(int page)
       page = it - list.cbegin();
     }
   }
-  QLayoutItem *item = layout->itemAt(page);
-  if (!item) return nullptr;
-  return dynamic_cast<ThumbnailButton *>(item->widget());
+  return page < entries.size() ? page : -1;
+}
+
+QRect ThumbnailWidget::cellRect(const int position) const
+{
+  const int row = position / columns;
+  return QRect((position % columns) * col_width, row_top[row], col_width,
+               row_top[row + 1] - row_top[row]);
+}
+
+ThumbnailButton *ThumbnailWidget::showPosition(const int position)
+{
+  if (position < 0 || position >= entries.size() || !widget()) return nullptr;
+  const QRect rect = cellRect(position);
+  // This calls updateVisible() if the view is scrolled.
+  ensureVisible(rect.center().x(), rect.center().y(), rect.width() / 2,
+                rect.height() / 2);
+  ThumbnailButton *button = buttons.value(position, nullptr);
+  if (!button) {
+    button = createButton(position);
+    requestThumbnail(position);
+    emit startRendering();
+  }
+  return button;
 }
 
 void ThumbnailWidget::focusPage(const int page)
 {
   if (!isVisible()) return;
-  ThumbnailButton *button = buttonAtPage(page);
-  if (current_page_button && current_page_button != button)
-    current_page_button->clearFocus();
-  if (button) {
-    ensureWidgetVisible(button);
-    button->giveFocus();
+  const int position = positionOfPage(page);
+  if (current_position != position) {
+    ThumbnailButton *old_button = buttons.value(current_position, nullptr);
+    if (old_button) old_button->clearFocus();
   }
-  current_page_button = button;
+  current_position = position;
+  ThumbnailButton *button = showPosition(position);
+  if (button) button->giveFocus();
 }
 
 void ThumbnailWidget::keyPressEvent(QKeyEvent *event)
@@ -123,10 +144,10 @@ void ThumbnailWidget::keyPressEvent(QKeyEvent *event)
 
 void ThumbnailWidget::focusInEvent(QFocusEvent *event)
 {
-  if (focused_button)
-    focused_button->giveFocus();
-  else if (current_page_button)
-    current_page_button->giveFocus();
+  ThumbnailButton *button = buttons.value(focused_position, nullptr);
+  if (!button) button = buttons.value(current_position, nullptr);
+  if (button)
+    button->giveFocus();
   else
     focusPage(preferences()->page);
 }
@@ -134,15 +155,10 @@ void ThumbnailWidget::focusInEvent(QFocusEvent *event)
 void ThumbnailWidget::handleAction(const Action action)
 {
   if (action == PdfFilesChanged) {
-    emit interruptThread();
-    focused_button = nullptr;
-    if (render_thread) {
-      render_thread->thread()->quit();
-      render_thread->thread()->wait(max_render_time_ms);
-      delete render_thread;
-      render_thread = nullptr;
-    }
+    deleteRenderingThreads(max_render_time_ms);
     ref_width = -100;
+    entries.clear();
+    row_top.clear();
     initialize();
     if (isVisible()) {
       generate();
@@ -151,130 +167,206 @@ void ThumbnailWidget::handleAction(const Action action)
   }
 }
 
-void ThumbnailWidget::initRenderingThread()
+void ThumbnailWidget::initRenderingThreads()
 {
-  debug_msg(DebugWidgets, "initializing rendering thread");
-  render_thread = new ThumbnailThread(document);
-  render_thread->moveToThread(new QThread(render_thread));
-  connect(this, &ThumbnailWidget::interruptThread, render_thread,
-          &ThumbnailThread::clearQueue, Qt::QueuedConnection);
-  connect(this, &ThumbnailWidget::sendToRenderThread, render_thread,
-          &ThumbnailThread::append, Qt::QueuedConnection);
-  connect(this, &ThumbnailWidget::startRendering, render_thread,
-          &ThumbnailThread::renderImages, Qt::QueuedConnection);
-  connect(render_thread, &ThumbnailThread::sendThumbnail, this,
-          &ThumbnailWidget::receiveThumbnail, Qt::QueuedConnection);
-  render_thread->thread()->start();
-  debug_msg(DebugWidgets, "started rendering thread");
+  debug_msg(DebugWidgets, "initializing rendering threads" << thread_number);
+  next_thread = 0;
+  // Thumbnails can be downscaled from pages in the caches of all slides.
+  const QList<const PixCache *> caches = master()->pixcaches();
+  if (document) ThumbnailThread::pruneThumbnails(document.get());
+  for (int i = 0; i < thread_number; ++i) {
+    ThumbnailThread *render_thread = new ThumbnailThread(document, caches);
+    render_thread->moveToThread(new QThread(render_thread));
+    connect(this, &ThumbnailWidget::interruptThread, render_thread,
+            &ThumbnailThread::clearQueue, Qt::QueuedConnection);
+    connect(this, &ThumbnailWidget::sendToRenderThread, render_thread,
+            &ThumbnailThread::append, Qt::QueuedConnection);
+    connect(this, &ThumbnailWidget::startRendering, render_thread,
+            &ThumbnailThread::renderImages, Qt::QueuedConnection);
+    connect(render_thread, &ThumbnailThread::sendThumbnail, this,
+            &ThumbnailWidget::receiveThumbnail, Qt::QueuedConnection);
+    render_thread->thread()->start();
+    render_threads.append(render_thread);
+  }
+  debug_msg(DebugWidgets, "started rendering threads");
 }
 
 void ThumbnailWidget::generate()
 {
   debug_msg(DebugWidgets, "(re-)generating thumbnail widget" << size());
-  focused_button = nullptr;
-  current_page_button = nullptr;
-  if (!widget()) initialize();
-
   emit interruptThread();
   if (!document) document = preferences()->document;
-  if (!render_thread) initRenderingThread();
+  if (render_threads.isEmpty()) initRenderingThreads();
+  initialize();
 
-  QGridLayout *layout = dynamic_cast<QGridLayout *>(widget()->layout());
-  if (!layout) {
-    initialize();
-    layout = dynamic_cast<QGridLayout *>(widget()->layout());
-  }
-  const int col_width =
-      (viewport()->width() - (columns + 1) * layout->horizontalSpacing()) /
-      columns;
+  col_width = viewport()->width() / columns;
   ref_width = width();
-  int position = 0;
+  entries.clear();
   if (_flags & SkipOverlays) {
     const QList<int> &list = document->overlayIndices();
     if (!list.empty()) {
       int link_page = list.first();
       for (auto it = list.cbegin() + 1; it != list.cend(); link_page = *it++)
-        createButton(*it - 1, link_page, position++, col_width);
-      createButton(document->numberOfPages() - 1, list.last(), position++,
-                   col_width);
+        appendEntry(*it - 1, link_page);
+      appendEntry(document->numberOfPages() - 1, list.last());
     }
   }
-  if (position == 0) {
-    for (; position < document->numberOfPages(); position++)
-      createButton(position, position, position, col_width);
+  if (entries.isEmpty())
+    for (int page = 0; page < document->numberOfPages(); page++)
+      appendEntry(page, page);
+
+  // Row heights are given by the highest thumbnail in each row.
+  const int rows = (entries.size() + columns - 1) / columns;
+  row_top.fill(0, rows + 1);
+  for (int position = 0; position < entries.size(); ++position) {
+    const int row = position / columns;
+    row_top[row + 1] = std::max(row_top[row + 1], entries[position].height);
   }
-  current_page_button =
-      dynamic_cast<ThumbnailButton *>(layout->itemAt(0)->widget());
-  emit startRendering();
+  for (int row = 0; row < rows; ++row) row_top[row + 1] += row_top[row];
+  widget()->setFixedSize(columns * col_width, row_top.last());
+  updateVisible();
 }
 
-void ThumbnailWidget::createButton(const int display_page, const int link_page,
-                                   const int position, const int col_width)
+void ThumbnailWidget::appendEntry(const int display_page, const int link_page)
 {
-  QGridLayout *layout = dynamic_cast<QGridLayout *>(widget()->layout());
-  if (!layout) return;
-  QLayoutItem *item = layout->itemAt(position);
-  ThumbnailButton *button =
-      item ? dynamic_cast<ThumbnailButton *>(item->widget()) : nullptr;
-  if (!item || !button) {
-    button = new ThumbnailButton(link_page, this);
-    connect(button, &ThumbnailButton::sendNavigationSignal, master(),
-            &Master::navigateToPage);
-    connect(button, &ThumbnailButton::updateFocus, this,
-            &ThumbnailWidget::setFocusButton);
-    connect(button, &ThumbnailButton::focusUpDown, this,
-            &ThumbnailWidget::moveFocusUpDown);
-    layout->addWidget(button, position / columns, position % columns);
-  }
   QSizeF size = document->pageSize(display_page);
   if (preferences()->default_page_part) size.rwidth() /= 2;
-  button->setMinimumSize(col_width, col_width * size.height() / size.width());
-  emit sendToRenderThread(
-      position, (col_width - 2 * ThumbnailButton::line_width) / size.width(),
-      display_page);
+  entries.append({display_page, link_page,
+                  int(col_width * size.height() / size.width()),
+                  (col_width - 2 * ThumbnailButton::line_width) /
+                      size.width()});
+}
+
+ThumbnailButton *ThumbnailWidget::createButton(const int position)
+{
+  ThumbnailButton *button =
+      new ThumbnailButton(entries[position].link_page, widget());
+  connect(button, &ThumbnailButton::sendNavigationSignal, master(),
+          &Master::navigateToPage);
+  connect(button, &ThumbnailButton::updateFocus, this,
+          &ThumbnailWidget::setFocusButton);
+  connect(button, &ThumbnailButton::focusUpDown, this,
+          &ThumbnailWidget::moveFocusUpDown);
+  connect(button, &ThumbnailButton::focusLeftRight, this,
+          &ThumbnailWidget::moveFocusLeftRight);
+  button->setGeometry(cellRect(position));
+  // Set style for current page.
+  button->clearFocus();
+  button->show();
+  buttons[position] = button;
+  pending.insert(position);
+  return button;
+}
+
+void ThumbnailWidget::requestThumbnail(const int position)
+{
+  if (!pending.contains(position) || render_threads.isEmpty()) return;
+  // Distribute requests in order of priority among the threads.
+  next_thread = (next_thread + 1) % render_threads.size();
+  emit sendToRenderThread(render_threads[next_thread], position,
+                          entries[position].resolution,
+                          entries[position].display_page);
+}
+
+void ThumbnailWidget::updateVisible()
+{
+  if (row_top.size() < 2 || !widget()) return;
+  const int rows = row_top.size() - 1;
+  const int top = verticalScrollBar()->value();
+  const int bottom = top + viewport()->height();
+  const int visible_first = std::max(
+      int(std::upper_bound(row_top.cbegin(), row_top.cend(), top) -
+          row_top.cbegin()) -
+          1,
+      0);
+  const int visible_end = std::min(
+      int(std::lower_bound(row_top.cbegin(), row_top.cend(), bottom) -
+          row_top.cbegin()),
+      rows);
+  const int first = std::max(visible_first - margin_rows, 0),
+            end = std::min(visible_end + margin_rows, rows);
+  if (first == first_row && end == end_row) return;
+  first_row = first;
+  end_row = end;
+
+  // Delete buttons outside the range, but keep buttons for the current page
+  // and the focused button.
+  const int first_position = first * columns,
+            end_position = std::min(end * columns, int(entries.size()));
+  for (auto it = buttons.begin(); it != buttons.end();) {
+    if ((it.key() < first_position || it.key() >= end_position) &&
+        it.key() != focused_position && it.key() != current_position &&
+        !it.value()->hasFocus()) {
+      it.value()->hide();
+      it.value()->deleteLater();
+      pending.remove(it.key());
+      it = buttons.erase(it);
+    } else
+      ++it;
+  }
+
+  // Replace the rendering queue: visible rows first, then the margin below
+  // and finally the margin above the visible area.
+  emit interruptThread();
+  const auto request_row = [&](const int row) {
+    for (int position = row * columns;
+         position < (row + 1) * columns && position < entries.size();
+         ++position) {
+      if (!buttons.contains(position)) createButton(position);
+      requestThumbnail(position);
+    }
+  };
+  for (int row = visible_first; row < visible_end; ++row) request_row(row);
+  for (int row = visible_end; row < end; ++row) request_row(row);
+  for (int row = visible_first - 1; row >= first; --row) request_row(row);
+  emit startRendering();
 }
 
-void ThumbnailWidget::receiveThumbnail(const int button_index,
-                                       const QPixmap pixmap)
+void ThumbnailWidget::receiveThumbnail(const int button_index, const int page,
+                                       const qreal resolution,
+                                       const QImage image)
 {
-  if (pixmap.isNull() || button_index < 0) return;
-  QLayout *layout = widget() ? widget()->layout() : nullptr;
-  if (!layout) return;
-  const auto item = layout->itemAt(button_index);
-  if (!item) return;
-  ThumbnailButton *button = dynamic_cast<ThumbnailButton *>(item->widget());
-  if (button) button->setPixmap(pixmap);
+  if (image.isNull() || button_index < 0 || button_index >= entries.size() ||
+      entries[button_index].display_page != page ||
+      entries[button_index].resolution != resolution)
+    return;
+  ThumbnailButton *button = buttons.value(button_index, nullptr);
+  if (button) {
+    // QPixmap may only be created in the main thread.
+    button->setPixmap(QPixmap::fromImage(image));
+    pending.remove(button_index);
+  }
 }
 
-void ThumbnailWidget::resizeEvent(QResizeEvent *)
+void ThumbnailWidget::resizeEvent(QResizeEvent *event)
 {
+  QScrollArea::resizeEvent(event);
   // Only recalculate if changes in the widget's width lie above a threshold of
   // 10%.
-  if (std::abs(ref_width - width()) > ref_width / inverse_tolerance) generate();
+  if (std::abs(ref_width - width()) > ref_width / inverse_tolerance)
+    generate();
+  else
+    updateVisible();
 }
 
 void ThumbnailWidget::setFocusButton(ThumbnailButton *button)
 {
-  if (focused_button == button || !button) return;
-  if (focused_button) focused_button->clearFocus();
-  focused_button = button;
-  ensureWidgetVisible(focused_button);
+  if (!button) return;
+  const int position = buttons.key(button, -1);
+  if (position < 0 || position == focused_position) return;
+  ThumbnailButton *old_button = buttons.value(focused_position, nullptr);
+  if (old_button) old_button->clearFocus();
+  focused_position = position;
+  ensureWidgetVisible(button);
 }
 
-void ThumbnailWidget::moveFocusUpDown(const qint8 updown)
+void ThumbnailWidget::moveFocus(const int delta)
 {
-  QWidget *target = focused_button;
-  if (updown > 0)
-    for (int i = updown * columns; target && i > 0; --i)
-      target = target->nextInFocusChain();
-  else
-    for (int i = updown * columns; target && i < 0; ++i)
-      target = target->previousInFocusChain();
-  auto button = dynamic_cast<ThumbnailButton *>(target);
-  if (button) {
-    focused_button->clearFocus();
-    focused_button = button;
-    focused_button->giveFocus();
-    ensureWidgetVisible(focused_button);
-  }
+  const int target = focused_position + delta;
+  if (focused_position < 0 || target < 0 || target >= entries.size()) return;
+  ThumbnailButton *old_button = buttons.value(focused_position, nullptr);
+  if (old_button) old_button->clearFocus();
+  focused_position = target;
+  ThumbnailButton *button = showPosition(target);
+  if (button) button->giveFocus();
 }
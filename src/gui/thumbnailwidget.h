@@ -4,8 +4,14 @@
 #ifndef THUMBNAILWIDGET_H
 #define THUMBNAILWIDGET_H
 
+#include <QHash>
+#include <QList>
+#include <QRect>
 #include <QScrollArea>
+#include <QSet>
 #include <QSize>
+#include <QVector>
+#include <algorithm>
 #include <memory>
 
 #include "src/config.h"
@@ -15,12 +21,20 @@
 class QShowEvent;
 class QKeyEvent;
 class QFocusEvent;
-class QPixmap;
+class QImage;
 class PdfDocument;
 class ThumbnailThread;
 
 /**
- * @brief Widget showing thumbnail slides on grid layout in scroll area.
+ * @brief Widget showing thumbnail slides on grid in scroll area.
+ *
+ * The grid is virtualized: The scroll area contains an empty widget of the
+ * full size of the grid. ThumbnailButtons are only created for the visible
+ * rows and margin_rows rows above and below, and thumbnails are only
+ * rendered for these buttons. When scrolling, buttons which leave this range
+ * are deleted and the rendering queue is replaced, such that the visible
+ * thumbnails are rendered first. The thumbnails are distributed among
+ * several ThumbnailThreads.
  *
  * @see ThumbnailButton
  * @see ThumbnailThread
@@ -37,6 +51,10 @@ class ThumbnailWidget : public QScrollArea
   /// maximum waiting time for rendering (ms)
   static constexpr int max_render_time_ms = 2000;
 
+  /// number of rows above and below the visible area for which buttons
+  /// are created and thumbnails are rendered
+  static constexpr int margin_rows = 2;
+
  public:
   enum ThumbnailFlag {
     /// show one thumbnail per page label instead of per page
@@ -46,38 +64,88 @@ class ThumbnailWidget : public QScrollArea
   Q_FLAG(ThumbnailFlags);
 
  private:
-  /// QObject for rendering. which is moved to an own thread.
-  /// Communication to render_thread is almost exclusively done via the
-  /// signal/slot mechanism since it lives in another thread.
-  ThumbnailThread *render_thread{nullptr};
+  /// Thumbnail in the grid.
+  struct Entry {
+    /// page shown in the thumbnail
+    int display_page;
+    /// page to which the thumbnail button links
+    int link_page;
+    /// height of the thumbnail in pixels
+    int height;
+    /// resolution for rendering the thumbnail
+    qreal resolution;
+  };
+
+  /// QObjects for rendering. which are moved to own threads.
+  /// Communication to render_threads is almost exclusively done via the
+  /// signal/slot mechanism since they live in other threads.
+  QList<ThumbnailThread *> render_threads;
+  /// Number of render threads.
+  int thread_number{2};
+  /// Render thread which receives the next request.
+  int next_thread{0};
   /// Document shown by these thumbnails.
   std::shared_ptr<const PdfDocument> document;
 
+  /// All thumbnails in the order in which they are shown. Positions used
+  /// in this class are indices in this list.
+  QVector<Entry> entries;
+  /// y coordinate of the upper edge of each row. Contains one additional
+  /// element, which is the total height.
+  QVector<int> row_top;
+  /// Existing buttons by position.
+  QHash<int, ThumbnailButton *> buttons;
+  /// Positions of buttons which have not received a thumbnail yet.
+  QSet<int> pending;
+  /// Range of rows (first, end) for which buttons were created.
+  int first_row{-1}, end_row{-1};
+
   /// width of widget when thumbnails were rendered, in pixels.
   int ref_width{0};
+  /// width of a column in pixels.
+  int col_width{0};
   /// number of columns
   unsigned char columns{4};
   /// flags: currently only SkipOverlays.
   ThumbnailFlags _flags = {};
-  /// currently focused page index
-  ThumbnailButton *focused_button{nullptr};
-  /// button for current page
-  ThumbnailButton *current_page_button{nullptr};
+  /// position of focused button or -1
+  int focused_position{-1};
+  /// position of button for current page or -1
+  int current_position{-1};
 
-  /// Create widget and layout.
+  /// Create widget if necessary and delete all buttons.
   void initialize();
 
-  /// Initialize (create and start) rendering thread.
-  void initRenderingThread();
+  /// Initialize (create and start) rendering threads.
+  void initRenderingThreads();
+
+  /// Stop and delete rendering threads.
+  void deleteRenderingThreads(const int wait_ms);
+
+  /// Append thumbnail to entries.
+  void appendEntry(const int display_page, const int link_page);
+
+  /// Rectangle of a thumbnail in the coordinates of widget().
+  QRect cellRect(const int position) const;
+
+  /// Position of the thumbnail for a page or -1.
+  int positionOfPage(int page) const;
 
-  /// Create or replace thumbnail button.
-  /// Ask render thread to render page preview.
-  void createButton(const int display_page, const int link_page,
-                    const int position, const int col_width);
+  /// Create thumbnail button at position and mark it as pending.
+  ThumbnailButton *createButton(const int position);
+
+  /// Ask render thread to render thumbnail if button is pending.
+  void requestThumbnail(const int position);
+
+  /// Scroll to thumbnail at position. Create the button if necessary.
+  ThumbnailButton *showPosition(const int position);
+
+  /// Move focus by delta positions.
+  void moveFocus(const int delta);
 
  protected:
   /// Resize: clear if necessary.
-  void resizeEvent(QResizeEvent *) override;
+  void resizeEvent(QResizeEvent *event) override;
 
  public:
   /// Nearly trivial constructor.
@@ -94,14 +162,20 @@ class ThumbnailWidget : public QScrollArea
     columns = n_columns;
   }
 
+  /// Set number of render threads.
+  void setThreads(const int n_threads) noexcept
+  {
+    thread_number = std::max(n_threads, 1);
+  }
+
   /// get function for _flags
   ThumbnailFlags &flags() noexcept { return _flags; }
 
-  /// (re)generate and show the thumbnails. This initializes render_thread
-  /// if it does not exist yet. By default it takes document from
-  /// preferences(). The function returns after (creating,) instructing
-  /// and starting the rendering thread. Rendering is then done in
-  /// background.
+  /// (re)generate the grid and show the visible thumbnails. This
+  /// initializes render_threads if they do not exist yet. By default it
+  /// takes document from preferences(). The function returns after
+  /// (creating,) instructing and starting the rendering thread. Rendering
+  /// is then done in background.
   void generate();
 
   /// Preferred height depends on width.
@@ -110,8 +184,6 @@ class ThumbnailWidget : public QScrollArea
   /// Size hint for layout.
   QSize sizeHint() const noexcept override { return {100, 200}; }
 
-  ThumbnailButton *buttonAtPage(int page);
-
  public slots:
   /// Set focus to given page.
   void focusPage(const int page);
@@ -124,8 +196,11 @@ class ThumbnailWidget : public QScrollArea
   /// Override key press events: Send page up and page down to master.
   void keyPressEvent(QKeyEvent *event) override;
 
-  /// Receive thumbnail from render_thread and show it on button.
-  void receiveThumbnail(const int button_index, const QPixmap pixmap);
+  /// Receive thumbnail from render_threads and show it on button. The
+  /// thumbnail is dropped if it does not match the current entry of the
+  /// button (sent before the entries were regenerated).
+  void receiveThumbnail(const int button_index, const int page,
+                        const qreal resolution, const QImage image);
 
   /// Handle actions: clear if files are reloaded.
   void handleAction(const Action action);
@@ -134,18 +209,27 @@ class ThumbnailWidget : public QScrollArea
   void setFocusButton(ThumbnailButton *button);
 
   /// Move focus to row above/below (updown=-1/+1)
-  void moveFocusUpDown(const qint8 updown);
+  void moveFocusUpDown(const qint8 updown) { moveFocus(updown * columns); }
+
+  /// Move focus to previous/next thumbnail (leftright=-1/+1)
+  void moveFocusLeftRight(const qint8 leftright) { moveFocus(leftright); }
 
   /// Focus in event: make sure a thumbnail button is focussed.
   void focusInEvent(QFocusEvent *event) override;
 
+ private slots:
+  /// Create buttons for the visible rows, delete buttons far outside the
+  /// visible area, and queue rendering of missing thumbnails.
+  void updateVisible();
+
  signals:
-  /// Tell render_thread to render page with resolution and associate it
-  /// with given button index.
-  void sendToRenderThread(int button_index, qreal resolution, int page);
-  /// Tell render_thread to start rendering.
+  /// Tell target to render page with resolution and associate it with
+  /// given button index.
+  void sendToRenderThread(const ThumbnailThread *target, int button_index,
+                          qreal resolution, int page);
+  /// Tell render_threads to start rendering.
   void startRendering();
-  /// Tell thumbnail thread to clear queue.
+  /// Tell thumbnail threads to clear queue.
   void interruptThread();
 };
 
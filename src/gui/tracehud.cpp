@@ -0,0 +1,47 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/gui/tracehud.h"
+
+#include <QFontDatabase>
+
+#include "src/tracer.h"
+
+TraceHud::TraceHud(QWidget *parent) : QLabel(parent)
+{
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+  setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  setStyleSheet("background-color: rgba(0, 0, 0, 160); color: white;");
+  setTextFormat(Qt::PlainText);
+  setMargin(4);
+  move(0, 0);
+  startTimer(update_interval_ms);
+}
+
+void TraceHud::timerEvent(QTimerEvent *)
+{
+  // Times are shown in ms.
+  QString text = QString("%1 %2 %3 %4 %5")
+                     .arg("event", -20)
+                     .arg("last", 8)
+                     .arg("mean", 8)
+                     .arg("max", 8)
+                     .arg("count", 7);
+  for (const auto &entry : Tracer::statistics()) {
+    const Tracer::Statistics &stats = entry.second;
+    text += QString("\n%1 ").arg(QString::fromLatin1(entry.first), -20);
+    if (stats.total_ns > 0)
+      text += QString("%1 %2 %3 ")
+                  .arg(1e-6 * stats.last_ns, 8, 'f', 2)
+                  .arg(1e-6 * stats.total_ns / stats.count, 8, 'f', 2)
+                  .arg(1e-6 * stats.max_ns, 8, 'f', 2);
+    else
+      text += QString(27, ' ');
+    text += QString("%1").arg(stats.count, 7);
+  }
+  const qint64 dropped = Tracer::droppedEvents();
+  if (dropped > 0) text += QString("\n%1 events not recorded").arg(dropped);
+  setText(text);
+  adjustSize();
+  raise();
+}
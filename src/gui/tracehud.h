@@ -0,0 +1,38 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef TRACEHUD_H
+#define TRACEHUD_H
+
+#include <QLabel>
+
+#include "src/config.h"
+
+class QTimerEvent;
+
+/**
+ * @brief On-screen display of timing statistics
+ *
+ * Semi-transparent label in the top left corner of its parent window,
+ * showing the statistics of all Tracer events (latest, mean and maximum
+ * duration and number of events). The label is updated periodically and
+ * ignores mouse input.
+ *
+ * @see Tracer
+ */
+class TraceHud : public QLabel
+{
+  Q_OBJECT
+
+  static constexpr int update_interval_ms = 500;
+
+ protected:
+  /// Timer event: update text.
+  void timerEvent(QTimerEvent *) override;
+
+ public:
+  /// Constructor: start timer.
+  explicit TraceHud(QWidget *parent);
+};
+
+#endif  // TRACEHUD_H
@@ -5,15 +5,19 @@
 #include <QCommandLineParser>
 #include <QFileInfo>
 #include <QSettings>
+#include <QThread>
 #include <QtDebug>
 #include <memory>
 
 #include "src/config.h"
 #include "src/drawing/tool.h"
+#include "src/exporter.h"
 #include "src/master.h"
 #include "src/masterapp.h"
+#include "src/media/mediaproviderpool.h"
 #include "src/preferences.h"
 #include "src/rendering/pngpixmap.h"
+#include "src/tracer.h"
 
 int main(int argc, char *argv[])
 {
@@ -118,7 +122,37 @@ int main(int argc, char *argv[])
   parser.addOption(
       {"test", QCoreApplication::translate(
                    "main", "only test the installation, don't start the app")});
+  parser.addOption(
+      {"export",
+       QCoreApplication::translate(
+           "main",
+           "export all pages including drawings to directory or PDF file "
+           "without starting the GUI"),
+       QCoreApplication::translate("main", "path")});
+  parser.addOption(
+      {"export-format",
+       QCoreApplication::translate(
+           "main",
+           "format for --export: png (default), svg, or pdf (requires MuPDF)"),
+       QCoreApplication::translate("main", "format")});
+  parser.addOption(
+      {"export-dpi",
+       QCoreApplication::translate(
+           "main", "resolution of images for --export (default: 150)"),
+       QCoreApplication::translate("main", "number")});
+  parser.addOption(
+      {"trace",
+       QCoreApplication::translate(
+           "main",
+           "record timing of rendering, navigation and drawing and write it "
+           "to file in Chrome trace format when quitting"),
+       QCoreApplication::translate("main", "file")});
+  parser.addOption(
+      {"hud", QCoreApplication::translate(
+                  "main", "show timing statistics in all windows")});
   parser.process(app);
+  // Tracing must be enabled before any objects are created.
+  if (parser.isSet("trace") || parser.isSet("hud")) Tracer::enable();
 
   // Initialize global preferences object.
   if (parser.isSet("c"))
@@ -135,6 +169,31 @@ int main(int argc, char *argv[])
   WritableGlobalPreferences::writable()->loadSettings();
   WritableGlobalPreferences::writable()->loadFromParser(parser);
 
+  if (parser.isSet("export")) {
+    // Export without creating any widgets.
+    int status = 1;
+    bool dpi_ok = true;
+    const qreal dpi = parser.value("export-dpi").isEmpty()
+                          ? 150.
+                          : parser.value("export-dpi").toDouble(&dpi_ok);
+    if (!dpi_ok || dpi <= 0.)
+      qCritical() << QCoreApplication::translate(
+                         "main", "Invalid resolution for --export-dpi:")
+                  << parser.value("export-dpi");
+    else if (master()->openDocuments() == Master::Success) {
+      const Exporter exporter(master()->getDocuments().first(), dpi,
+                              QThread::idealThreadCount());
+      const QString target = parser.value("export");
+      if (exporter.exportFiles(
+              target,
+              Exporter::parseFormat(parser.value("export-format"), target)))
+        status = 0;
+    }
+    delete master();
+    delete preferences();
+    return status;
+  }
+
   QString gui_config_file = parser.value("g").isEmpty()
                                 ? preferences()->gui_config_file
                                 : parser.value("g");
@@ -178,6 +237,7 @@ int main(int argc, char *argv[])
     qInfo() << "PDF file alias:" << preferences()->file_alias;
   } else {
     master()->showAll();
+    if (parser.isSet("hud")) master()->showTraceHud();
   }
   // Navigate to first page.
   master()->navigateToPage(0);
@@ -188,10 +248,15 @@ int main(int argc, char *argv[])
   // Run the program.
   int status = 0;
   if (!parser.isSet("test")) status = app.exec();
+  if (parser.isSet("trace") && !Tracer::writeJson(parser.value("trace")))
+    qWarning() << QCoreApplication::translate("main",
+                                              "Writing trace file failed:")
+               << parser.value("trace");
   // Clean up. preferences() must be deleted after everything else.
   // Deleting master may take some time since this requires the interruption
   // and deletion of multiple threads.
   delete master();
+  MediaProviderPool::clear();
   delete preferences();
   return status;
 }
@@ -5,6 +5,8 @@
 
 #include <zlib.h>
 
+#include <QDateTime>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QJsonArray>
@@ -25,7 +27,9 @@
 #include <algorithm>
 #include <utility>
 
+#include "src/autosave.h"
 #include "src/config.h"
+#include "src/drawing/binarydrawings.h"
 #include "src/drawing/tool.h"
 #include "src/gui/analogclockwidget.h"
 #include "src/gui/clockwidget.h"
@@ -42,6 +46,7 @@
 #include "src/gui/tocwidget.h"
 #include "src/gui/toolselectorwidget.h"
 #include "src/gui/toolwidget.h"
+#include "src/gui/tracehud.h"
 #include "src/log.h"
 #include "src/names.h"
 #include "src/pdfmaster.h"
@@ -49,20 +54,29 @@
 #include "src/rendering/pixcache.h"
 #include "src/slidescene.h"
 #include "src/slideview.h"
+#include "src/tracer.h"
 
 Master::~Master()
 {
-  emit clearCache();
-  for (const auto cache : std::as_const(caches)) cache->thread()->quit();
-  for (const auto cache : std::as_const(caches)) {
-    cache->thread()->wait(thread_wait_time_ms);
-    delete cache;
+  if (autosave) {
+    // Regular exit: the autosave file is not required anymore.
+    autosave->discard();
+    delete autosave;
+    autosave = nullptr;
   }
+  emit clearCache();
   for (const auto &doc : std::as_const(documents)) {
     QList<SlideScene *> &scenes = doc->getScenes();
     while (!scenes.isEmpty()) delete scenes.takeLast();
   }
+  // Windows are deleted before the caches, because thumbnail threads may
+  // read from the caches.
   while (!windows.isEmpty()) delete windows.takeLast();
+  for (const auto cache : std::as_const(caches)) cache->thread()->quit();
+  for (const auto cache : std::as_const(caches)) {
+    cache->thread()->wait(thread_wait_time_ms);
+    delete cache;
+  }
   documents.clear();
 }
 
@@ -138,7 +152,13 @@ Master::Status Master::readGuiConfig(const QString &filename)
   debug_msg(DebugDrawing,
             "Initialized documents:" << known_files.size()
                                      << preferences()->file_alias);
-  // Load drawings
+  loadAllDrawings();
+  initAutosave();
+  return Success;
+}
+
+void Master::loadAllDrawings()
+{
   // TODO: avoid loading drawings multiple times
   QSet<QString> loaded_paths;
   if (!master_file.isEmpty()) loaded_paths.insert(master_file);
@@ -146,11 +166,63 @@ Master::Status Master::readGuiConfig(const QString &filename)
     if (!doc->drawingsPath().isEmpty())
       loaded_paths.insert(doc->drawingsPath());
   for (const auto &path : loaded_paths) loadBprDrawings(path, true);
-  debug_msg(DebugDrawing, "Loaded drawings:" << known_files.size()
-                                             << preferences()->file_alias);
+  debug_msg(DebugDrawing, "Loaded drawings:" << preferences()->file_alias);
+}
+
+Master::Status Master::openDocuments()
+{
+  const QString file = preferences()->file_alias.value("presentation");
+  // Avoid asking for a file in openFile.
+  if (!QFileInfo(file).isFile()) {
+    qCritical() << tr("No valid file given");
+    return NoPDFLoaded;
+  }
+  QMap<QString, std::shared_ptr<PdfMaster>> known_files;
+  openFile("presentation", known_files);
+  if (documents.isEmpty()) return NoPDFLoaded;
+  initializePageIndex();
+  WritableGlobalPreferences::writable()->document =
+      documents.first()->getDocument();
+  loadAllDrawings();
   return Success;
 }
 
+void Master::initAutosave()
+{
+  if (documents.isEmpty()) return;
+  autosave = new Autosave(
+      Autosave::autosavePath(documents.first()->getFilename()), this);
+  const QFileInfo autosave_info(autosave->file());
+  if (autosave_info.isFile()) {
+    const QFileInfo master_info(master_file);
+    if ((!master_info.isFile() ||
+         autosave_info.lastModified() > master_info.lastModified()) &&
+        QMessageBox::question(
+            nullptr, tr("Restore drawings"),
+            tr("BeamerPresenter was not closed correctly. Restore drawings "
+               "saved automatically at %1?")
+                .arg(autosave_info.lastModified().toString()),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::Yes) == QMessageBox::Yes) {
+      // Drawings should still be saved to the original file.
+      const QString old_master_file = master_file;
+      if (loadBinaryDrawings(autosave->file(), true))
+        for (const auto &doc : std::as_const(documents))
+          doc->flags() |= PdfMaster::UnsavedDrawings;
+      master_file = old_master_file;
+    }
+  }
+  startAutosaveTimer();
+}
+
+void Master::startAutosaveTimer()
+{
+  // If autosave is disabled, check regularly whether it has been enabled.
+  autosaveTimer_id = startTimer(preferences()->autosave_interval > 0
+                                    ? 1000 * preferences()->autosave_interval
+                                    : autosave_disabled_check_ms);
+}
+
 void Master::initializePageIndex()
 {
   int max_pages = 0;
@@ -250,6 +322,8 @@ QWidget *Master::createWidget(
       widget = twidget;
       if (object.contains("columns"))
         twidget->setColumns(object.value("columns").toInt(4));
+      if (object.contains("threads"))
+        twidget->setThreads(object.value("threads").toInt(2));
       if (object.value("overlays").toString() == "skip")
         twidget->flags() |= ThumbnailWidget::SkipOverlays;
       connect(this, &Master::sendAction, twidget,
@@ -604,7 +678,7 @@ std::shared_ptr<PdfMaster> Master::openFile(
     fileinfo = QFileInfo(QFileDialog::getOpenFileName(
         nullptr, tr("Open file") + " \"" + name + "\"", "",
         tr("Documents (*.pdf);;BeamerPresenter/Xournal++ files "
-           "(*.bpr *.xoj *.xopp *.xml);;All files (*)")));
+           "(*.bpr *.bpb *.xoj *.xopp *.xml);;All files (*)")));
   if (!fileinfo.isFile()) {
     // File does not exist, mark given aliases as invalid.
     qCritical() << tr("No valid file given");
@@ -618,7 +692,8 @@ std::shared_ptr<PdfMaster> Master::openFile(
   const QMimeType type = QMimeDatabase().mimeTypeForFile(abs_path);
   if (type.inherits("application/gzip") || type.inherits("text/xml") ||
       type.inherits("application/x-xopp") ||
-      type.inherits("application/x-bpr")) {
+      type.inherits("application/x-bpr") ||
+      BinaryDrawings::isBinaryFile(abs_path)) {
     debug_msg(DebugDrawing, "Loading drawing file:" << name << abs_path
                                                     << known_files.size());
     loadBprInit(abs_path);
@@ -731,6 +806,24 @@ const PixCache *Master::getPixcache(const std::shared_ptr<PdfDocument> &doc,
   // Create a new PixCache object an store it in caches.
   // Create the PixCache object.
   PixCache *pixcache = new PixCache(doc, threads, page_part, cacheMode);
+  // Left and right half of the same document share render jobs.
+  if (page_part == LeftHalf || page_part == RightHalf) {
+    const PagePart other_part = page_part == LeftHalf ? RightHalf : LeftHalf;
+    for (const auto other : std::as_const(caches))
+      if (other->document() == doc.get() && other->pagePart() == other_part &&
+          !other->hasPartner()) {
+        // caches only contains const pointers for the views. The partner
+        // functions are thread safe.
+        PixCache *partner = const_cast<PixCache *>(other);
+        pixcache->setPartner(partner);
+        partner->setPartner(pixcache);
+        connect(pixcache, &PixCache::sendPartnerData, partner,
+                &PixCache::receiveData, Qt::QueuedConnection);
+        connect(partner, &PixCache::sendPartnerData, pixcache,
+                &PixCache::receiveData, Qt::QueuedConnection);
+        break;
+      }
+  }
   // Keep the new pixcache in caches.
   caches[cache_hash] = pixcache;
   // Set maximum number of pages in cache from settings.
@@ -782,6 +875,14 @@ void Master::showAll() const
   for (const auto window : std::as_const(windows)) window->show();
 }
 
+void Master::showTraceHud() const
+{
+  for (const auto window : std::as_const(windows)) {
+    auto hud = new TraceHud(window);
+    hud->show();
+  }
+}
+
 bool Master::eventFilter(QObject *obj, QEvent *event)
 {
   if (event->type() != QEvent::KeyPress)
@@ -820,11 +921,13 @@ bool Master::eventFilter(QObject *obj, QEvent *event)
     }
   }
   // Search actions in preferences for given key sequence.
+  if (Tracer::enabled()) trace_key_ns = Tracer::now();
   for (Action action : static_cast<const QList<Action>>(
            preferences()->key_actions.values(key_code))) {
     debug_msg(DebugKeyInput, "Global key action:" << action);
     handleAction(action);
   }
+  trace_key_ns = -1;
   // Search tools in preferences for given key sequence.
   const auto tools = preferences()->key_tools.values(key_code);
   for (const auto &tool : tools)
@@ -1059,8 +1162,12 @@ void Master::navigateToSlide(const int slide)
     killTimer(slideDurationTimer_id);
     slideDurationTimer_id = -1;
   }
-  leaveSlide(preferences()->slide);
   const int page = pageForSlide(slide);
+  // Navigation latency is measured from the key press if available.
+  if (Tracer::enabled())
+    Tracer::markNavigation(trace_key_ns >= 0 ? trace_key_ns : Tracer::now());
+  const TraceSpan span("navigate", "navigation", page);
+  leaveSlide(preferences()->slide);
   emit prepareNavigationSignal(slide, page);
   for (const auto window : std::as_const(windows)) window->updateGeometry();
   // Get duration of the slide: But only take a nontrivial value if
@@ -1119,15 +1226,16 @@ QString Master::getOpenFileName()
 {
   return QFileDialog::getOpenFileName(
       nullptr, tr("Load drawings"), "",
-      tr("BeamerPresenter/Xournal++ files (*.bpr *.xoj *.xopp *.xml);;All "
-         "files (*)"));
+      tr("BeamerPresenter/Xournal++ files (*.bpr *.bpb *.xoj *.xopp "
+         "*.xml);;All files (*)"));
 }
 
 QString Master::getSaveFileName()
 {
   return QFileDialog::getSaveFileName(
       nullptr, tr("Save drawings"), "",
-      tr("BeamerPresenter/Xournal++ files (*.bpr *.xopp);;All files (*)"));
+      tr("BeamerPresenter/Xournal++ files (*.bpr *.xopp);;BeamerPresenter "
+         "binary files (*.bpb);;All files (*)"));
 }
 
 void Master::timerEvent(QTimerEvent *event)
@@ -1142,11 +1250,17 @@ void Master::timerEvent(QTimerEvent *event)
   } else if (event->timerId() == slideDurationTimer_id) {
     slideDurationTimer_id = -1;
     nextSlide();
+  } else if (event->timerId() == autosaveTimer_id) {
+    if (autosave && preferences()->autosave_interval > 0)
+      autosave->save(documents, xmlHeader());
+    startAutosaveTimer();
   }
 }
 
 bool Master::saveBpr(const QString &filename)
 {
+  if (filename.endsWith(".bpb", Qt::CaseInsensitive))
+    return saveBinary(filename);
   // Save elements and attributes specific to BeamerPresenter
   // only if file name does not end with ".xopp".
   const bool save_bp_specific =
@@ -1226,27 +1340,8 @@ bool Master::writeXml(QBuffer &buffer, const bool save_bp_specific)
     }
   }
 
-  if (save_bp_specific) {
-    // Some attributes specific for beamerpresenter (Xournal++ will ignore that)
-    writer.writeStartElement("beamerpresenter");
-    if (preferences()->msecs_total)
-      writer.writeAttribute("duration", QTime::fromMSecsSinceStartOfDay(
-                                            preferences()->msecs_total)
-                                            .toString("h:mm:ss"));
-    writer.writeStartElement("documents");
-    // for (auto &&[alias, filename] :
-    // preferences()->file_alias.asKeyValueRange())
-    for (auto it = preferences()->file_alias.cbegin();
-         it != preferences()->file_alias.cend(); ++it) {
-      writer.writeStartElement("file");
-      writer.writeAttribute("alias", it.key());
-      writer.writeAttribute("path", it.value());
-      writer.writeEndElement();  // "file" element
-    }
-    writer.writeEndElement();  // "documents" element
-    emit writeNotes(writer);
-    writer.writeEndElement();  // "beamerpresenter" element
-  }
+  // Some attributes specific for beamerpresenter (Xournal++ will ignore that)
+  if (save_bp_specific) writeXmlHeader(writer);
 
   for (const auto &pdf : std::as_const(documents))
     pdf->writePages(writer, save_bp_specific);
@@ -1263,6 +1358,70 @@ bool Master::writeXml(QBuffer &buffer, const bool save_bp_specific)
   return true;
 }
 
+void Master::writeXmlHeader(QXmlStreamWriter &writer)
+{
+  writer.writeStartElement("beamerpresenter");
+  if (preferences()->msecs_total)
+    writer.writeAttribute(
+        "duration", QTime::fromMSecsSinceStartOfDay(preferences()->msecs_total)
+                        .toString("h:mm:ss"));
+  writer.writeStartElement("documents");
+  // for (auto &&[alias, filename] :
+  // preferences()->file_alias.asKeyValueRange())
+  for (auto it = preferences()->file_alias.cbegin();
+       it != preferences()->file_alias.cend(); ++it) {
+    writer.writeStartElement("file");
+    writer.writeAttribute("alias", it.key());
+    writer.writeAttribute("path", it.value());
+    writer.writeEndElement();  // "file" element
+  }
+  writer.writeEndElement();  // "documents" element
+  emit writeNotes(writer);
+  writer.writeEndElement();  // "beamerpresenter" element
+}
+
+QByteArray Master::xmlHeader()
+{
+  QByteArray header;
+  QBuffer buffer(&header);
+  buffer.open(QBuffer::WriteOnly);
+  QXmlStreamWriter writer(&buffer);
+  writeXmlHeader(writer);
+  buffer.close();
+  return header;
+}
+
+bool Master::saveBinary(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QFile::WriteOnly)) {
+    preferences()->showErrorMessage(
+        tr("Error while saving file"),
+        tr("Saving document failed for file path: ") + filename);
+    return false;
+  }
+  BinaryDrawings::Writer writer(&file, BinaryDrawings::defaultCompression());
+  bool success = writer.writeFileHeader();
+  success &= writer.writeChunk("HEAD", xmlHeader());
+  for (const auto &pdf : std::as_const(documents)) {
+    if (!success) break;
+    success &= writer.writeChunk("DOCU", pdf->getFilename().toUtf8());
+    success &= pdf->writePagesBinary(writer);
+  }
+  success &= writer.writeChunk("END ", QByteArray());
+  file.close();
+  if (!success) {
+    preferences()->showErrorMessage(
+        tr("Error while saving file"),
+        tr("Writing document resulted in error! Resulting "
+           "document is probably corrupt."));
+    return false;
+  }
+  qInfo() << "Saved binary drawings to" << filename;
+  master_file = filename;
+  return true;
+}
+
 /**
  * @brief getAbsFile
  * @param file path to a file (not a directory!)
@@ -1294,6 +1453,8 @@ QFileInfo getAbsFile(const QString &file, const QString &refering_file)
 
 bool Master::loadBprDrawings(const QString &filename, const bool clear_drawings)
 {
+  if (BinaryDrawings::isBinaryFile(filename))
+    return loadBinaryDrawings(filename, clear_drawings);
   QBuffer *buffer = loadZipToBuffer(filename);
   if (!buffer) return false;
   const bool status = loadXmlDrawings(buffer, clear_drawings, filename);
@@ -1305,6 +1466,7 @@ bool Master::loadBprDrawings(const QString &filename, const bool clear_drawings)
 
 bool Master::loadBprInit(const QString &filename)
 {
+  if (BinaryDrawings::isBinaryFile(filename)) return loadBinaryInit(filename);
   QBuffer *buffer = loadZipToBuffer(filename);
   if (!buffer) return false;
   const bool status = loadXmlInit(buffer, filename);
@@ -1388,6 +1550,107 @@ bool Master::loadXmlDrawings(QBuffer *buffer, const bool clear_drawings,
   return true;
 }
 
+std::shared_ptr<PdfMaster> Master::findDocument(const QString &filename,
+                                                const QString &drawings_path,
+                                                const bool create)
+{
+  const QString abs_filename =
+      getAbsFile(filename, drawings_path).absoluteFilePath();
+  for (const auto &doc : std::as_const(documents)) {
+    if (doc && (doc->getFilename() == filename ||
+                doc->getFilename() == abs_filename)) {
+      debug_msg(DebugDrawing, "Found existing document" << doc->getFilename());
+      return doc;
+    }
+  }
+  if (!create) return nullptr;
+  std::shared_ptr<PdfMaster> pdf = createPdfMaster(abs_filename);
+  if (!pdf) qWarning() << "Document does not exist:" << abs_filename;
+  return pdf;
+}
+
+bool Master::loadBinaryInit(const QString &filename)
+{
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) return false;
+  BinaryDrawings::Reader reader(&file);
+  QByteArray tag, payload;
+  bool status = reader.readFileHeader();
+  while (status && reader.nextChunk(tag, payload, "PAGE")) {
+    if (tag == "HEAD") {
+      QXmlStreamReader xml_reader(payload);
+      if (xml_reader.readNextStartElement())
+        readXmlHeader(xml_reader, false, filename);
+    } else if (tag == "DOCU") {
+      const auto pdf =
+          findDocument(QString::fromUtf8(payload), filename, true);
+      if (pdf) pdf->setDrawingsPath(filename);
+    } else if (tag == "END ")
+      break;
+  }
+  if (!reader.errorString().isEmpty()) {
+    preferences()->showErrorMessage(
+        tr("Error while loading file"),
+        tr("Failed to read binary drawings file: ") + reader.errorString());
+    return false;
+  }
+  master_file = filename;
+  return true;
+}
+
+bool Master::loadBinaryDrawings(const QString &filename,
+                                const bool clear_drawings)
+{
+  debug_msg(DebugDrawing, "Loading drawings from binary file" << filename);
+  QFile file(filename);
+  if (!file.open(QFile::ReadOnly)) return false;
+  BinaryDrawings::Reader reader(&file);
+  if (!reader.readFileHeader()) {
+    preferences()->showErrorMessage(
+        tr("Error while loading file"),
+        tr("Failed to read binary drawings file: ") + reader.errorString());
+    return false;
+  }
+  std::shared_ptr<PdfMaster> pdf(nullptr);
+  if (!documents.isEmpty()) pdf = documents.first();
+  page_idx.clear();
+  page_to_slide.clear();
+  QByteArray tag, payload;
+  while (reader.nextChunk(tag, payload)) {
+    if (tag == "HEAD") {
+      QXmlStreamReader xml_reader(payload);
+      if (xml_reader.readNextStartElement())
+        readXmlHeader(xml_reader, true, filename);
+    } else if (tag == "DOCU") {
+      pdf = findDocument(QString::fromUtf8(payload), filename, false);
+      if (pdf && clear_drawings) {
+        pdf->clearAllDrawings();
+        pdf->flags() &= ~PdfMaster::UnsavedDrawings;
+      }
+    } else if (tag == "PAGE") {
+      BinaryDrawings::Page page_data;
+      if (!BinaryDrawings::readPage(payload, page_data))
+        qWarning() << "Binary drawings file contains corrupt page:"
+                   << page_data.page;
+      const int page = page_data.page < 0 ? nextEmptyPage() : page_data.page;
+      if (pdf)
+        pdf->readDrawingsFromBinary(page_data, page);
+      else
+        for (const auto &layer : std::as_const(page_data.layers))
+          qDeleteAll(layer.items);
+      page_to_slide[page] = page_idx.size();
+      page_idx.append(page);
+    } else if (tag == "END ")
+      break;
+  }
+  if (!reader.errorString().isEmpty())
+    preferences()->showErrorMessage(
+        tr("Error while loading file"),
+        tr("Failed to read binary drawings file: ") + reader.errorString());
+  master_file = filename;
+  return true;
+}
+
 std::shared_ptr<PdfMaster> Master::readXmlPageBg(QXmlStreamReader &reader,
                                                  std::shared_ptr<PdfMaster> pdf,
                                                  const QString &drawings_path)
@@ -35,6 +35,7 @@ class QMainWindow;
 class QXmlStreamReader;
 class QXmlStreamWriter;
 class ContainerBaseClass;
+class Autosave;
 
 /**
  * @brief Central management of the program.
@@ -55,6 +56,7 @@ class Master : public QObject
   static constexpr int notes_widget_default_zoom = 10;
   static constexpr qreal min_duration_cache_videos = 0.5;
   static constexpr int cache_videos_after_ms = 200;
+  static constexpr int autosave_disabled_check_ms = 10000;
 
   /// List of all PDF documents.
   /// Master file is the first entry in this list.
@@ -85,6 +87,26 @@ class Master : public QObject
   /// Timer for automatic slide changes.
   int slideDurationTimer_id{-1};
 
+  /// Timer for autosave.
+  int autosaveTimer_id{-1};
+
+  /// Time of the key press which is currently handled, -1 otherwise.
+  /// Only used when tracing is enabled.
+  qint64 trace_key_ns{-1};
+
+  /// Background saving of drawings, owned by this.
+  Autosave *autosave{nullptr};
+
+  /// Create autosave object, offer to restore drawings from an existing
+  /// autosave file and start autosave timer.
+  void initAutosave();
+
+  /// Start timer for next autosave.
+  void startAutosaveTimer();
+
+  /// Load drawings from master_file and drawing files of all documents.
+  void loadAllDrawings();
+
   /// Ask for confirmation when closing.
   /// Return true when the program should quit.
   bool askCloseConfirmation() noexcept;
@@ -130,6 +152,12 @@ class Master : public QObject
   /// Show all windows of the application.
   void showAll() const;
 
+  /// Show a TraceHud in all windows.
+  void showTraceHud() const;
+
+  /// All PixCache objects. These exist until this is deleted.
+  QList<const PixCache *> pixcaches() const { return caches.values(); }
+
   enum Status {
     Success = 0,  ///< at least one window was created and at least one document
                   ///< was loaded.
@@ -143,6 +171,16 @@ class Master : public QObject
   /// Read configuration file and build up GUI.
   Status readGuiConfig(const QString &filename);
 
+  /// Open the presentation file and load drawings without creating any
+  /// widgets. Used for exporting without GUI.
+  Status openDocuments();
+
+  /// List of all documents.
+  const QList<std::shared_ptr<PdfMaster>> &getDocuments() const noexcept
+  {
+    return documents;
+  }
+
   /// Calculate total cache size (sum up cache sizes from all PixCache objects).
   qint64 getTotalCache() const;
 
@@ -201,6 +239,13 @@ class Master : public QObject
   /// Write XML to stream.
   /// Return true if saving was successful.
   bool writeXml(QBuffer &buffer, const bool save_bp_specific);
+  /// Write the <beamerpresenter> element (duration, documents, notes).
+  void writeXmlHeader(QXmlStreamWriter &writer);
+  /// @return <beamerpresenter> element as written by writeXmlHeader().
+  QByteArray xmlHeader();
+  /// Save drawings in binary format (.bpb).
+  /// Return true if file was written successfully.
+  bool saveBinary(const QString &filename);
 
   /// Load bpr or xopp file: Only initialize PDF documents, don't load drawings.
   bool loadBprInit(const QString &filename);
@@ -211,6 +256,15 @@ class Master : public QObject
   /// Load drawings and times from buffer.
   bool loadXmlDrawings(QBuffer *buffer, const bool clear_drawings,
                        const QString &abs_path);
+  /// Load binary file: only initialize PDF documents, don't load drawings.
+  bool loadBinaryInit(const QString &filename);
+  /// Load drawings and times from binary file.
+  bool loadBinaryDrawings(const QString &filename, const bool clear_drawings);
+  /// Find or create the PdfMaster for a document referenced in a drawing
+  /// file.
+  std::shared_ptr<PdfMaster> findDocument(const QString &filename,
+                                          const QString &drawings_path,
+                                          const bool create);
   /// Read header (beamerpresenter tag) from XML
   bool readXmlHeader(QXmlStreamReader &reader, const bool read_notes,
                      const QString &abs_path);
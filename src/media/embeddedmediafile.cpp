@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/media/embeddedmediafile.h"
+
+#include <QtDebug>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "src/log.h"
+
+namespace
+{
+/// Reader for data which is already available in memory.
+class BufferReader : public EmbeddedMediaFile::Reader
+{
+  const QByteArray data;
+  qint64 pos = 0;
+
+ public:
+  BufferReader(const QByteArray &data) : data(data) {}
+
+  qint64 read(char *target, const qint64 max_size) override
+  {
+    const qint64 size = std::min(max_size, qint64(data.size()) - pos);
+    if (size <= 0) return 0;
+    std::memcpy(target, data.constData() + pos, size);
+    pos += size;
+    return size;
+  }
+};
+}  // namespace
+
+EmbeddedMediaFile::EmbeddedMediaFile(Reader *reader, const qint64 size,
+                                     const QByteArray &key)
+    : reader(reader), _size(size), _key(key)
+{
+}
+
+EmbeddedMediaFile::EmbeddedMediaFile(const QByteArray &data)
+    : reader(new BufferReader(data)),
+      _size(data.size()),
+      _key(QByteArray::number(data.size()) + ':' + data.left(64))
+{
+}
+
+EmbeddedMediaFile::~EmbeddedMediaFile() { delete reader; }
+
+bool EmbeddedMediaFile::spool(const qint64 end)
+{
+  if (spooled >= end || !reader) return true;
+  if (!file.isOpen() && !file.open()) {
+    qWarning() << "Failed to create temporary file for embedded media";
+    return false;
+  }
+  QByteArray buffer(chunk_size, Qt::Uninitialized);
+  file.seek(spooled);
+  while (spooled < end) {
+    const qint64 size = reader->read(buffer.data(), chunk_size);
+    if (size < 0) {
+      qWarning() << "Failed to decode embedded media";
+      return false;
+    }
+    if (size == 0) {
+      finishReader();
+      break;
+    }
+    if (file.write(buffer.constData(), size) != size) {
+      qWarning() << "Failed to write embedded media to temporary file";
+      return false;
+    }
+    spooled += size;
+  }
+  debug_verbose(DebugMedia, "spooled embedded media:" << spooled << _size);
+  return true;
+}
+
+void EmbeddedMediaFile::finishReader()
+{
+  delete reader;
+  reader = nullptr;
+  _size = spooled;
+}
+
+qint64 EmbeddedMediaFile::size() const
+{
+  mutex.lock();
+  const qint64 size = _size;
+  mutex.unlock();
+  return size;
+}
+
+qint64 EmbeddedMediaFile::read(const qint64 pos, char *data,
+                               const qint64 max_size)
+{
+  if (pos < 0 || max_size < 0) return -1;
+  // Avoid overflow for large max_size.
+  const qint64 end = max_size > std::numeric_limits<qint64>::max() - pos
+                         ? std::numeric_limits<qint64>::max()
+                         : pos + max_size;
+  mutex.lock();
+  qint64 size = -1;
+  if (spool(end)) {
+    size = std::max(qint64(0), std::min(max_size, spooled - pos));
+    if (size > 0) size = file.seek(pos) ? file.read(data, size) : -1;
+  }
+  mutex.unlock();
+  return size;
+}
+
+void EmbeddedMediaFile::detachReader()
+{
+  mutex.lock();
+  delete reader;
+  reader = nullptr;
+  if (_size < 0 || _size > spooled) _size = spooled;
+  mutex.unlock();
+}
+
+qint64 EmbeddedMediaDevice::readData(char *data, qint64 max_size)
+{
+  if (!file) return -1;
+  const qint64 size = file->read(position, data, max_size);
+  if (size > 0) position += size;
+  return size;
+}
+
+bool EmbeddedMediaDevice::atEnd() const
+{
+  if (!isOpen() || !file) return true;
+  const qint64 size = file->size();
+  return size >= 0 && position >= size;
+}
+
+bool EmbeddedMediaDevice::seek(qint64 pos)
+{
+  if (sequential ? pos != 0 : !QIODevice::seek(pos)) return false;
+  position = pos;
+  return true;
+}
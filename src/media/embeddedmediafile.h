@@ -0,0 +1,156 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef EMBEDDEDMEDIAFILE_H
+#define EMBEDDEDMEDIAFILE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QMutex>
+#include <QTemporaryFile>
+#include <memory>
+
+#include "src/config.h"
+
+/**
+ * @brief Data of a media file embedded in a PDF, decoded on demand
+ *
+ * Embedded media files may be large. Instead of loading the full stream
+ * when the annotation is found, a Reader provided by the PDF engine
+ * decodes the stream in chunks only when the data is read. Decoded data
+ * is spooled to a temporary file, such that it is decoded only once and
+ * is not kept in memory. The reader is deleted when the end of the stream
+ * is reached.
+ *
+ * An EmbeddedMediaFile is shared by all EmbeddedMedia annotations showing
+ * the same stream. Media players read it through an EmbeddedMediaDevice.
+ * All functions are thread safe.
+ */
+class EmbeddedMediaFile
+{
+ public:
+  /**
+   * @brief Sequential reader of the decoded stream
+   *
+   * Readers are only accessed while the mutex of the EmbeddedMediaFile is
+   * locked, but they may be used from different threads.
+   */
+  class Reader
+  {
+   public:
+    virtual ~Reader() {}
+
+    /// Read at most max_size bytes to data. Return the number of bytes
+    /// read, 0 at the end of the stream and -1 on error.
+    virtual qint64 read(char *data, const qint64 max_size) = 0;
+  };
+
+ private:
+  /// Number of bytes decoded at once.
+  static constexpr qint64 chunk_size = 1 << 20;
+
+  /// Reader, owned by this. nullptr if the stream has been fully decoded
+  /// or the reader has been detached.
+  Reader *reader{nullptr};
+
+  /// Decoded data.
+  QTemporaryFile file;
+
+  /// Number of bytes written to file.
+  qint64 spooled = 0;
+
+  /// Size of the decoded stream or -1 if it is not known yet.
+  qint64 _size;
+
+  /// Key for comparison of files which are not shared, may be empty.
+  const QByteArray _key;
+
+  /// Mutex for all variables above.
+  mutable QMutex mutex;
+
+  /// Decode until at least end bytes are available or the stream ends.
+  /// Return false on error. mutex must be locked.
+  bool spool(const qint64 end);
+
+  /// Delete reader and set size if the stream ended. mutex must be locked.
+  void finishReader();
+
+ public:
+  /// Constructor: takes ownership of reader.
+  /// @param size size of the decoded stream, -1 if it is unknown
+  /// @param key key for comparison with other files, may be empty
+  EmbeddedMediaFile(Reader *reader, const qint64 size = -1,
+                    const QByteArray &key = {});
+
+  /// Constructor for data which is already available in memory. The data
+  /// is released once it has been written to the temporary file.
+  EmbeddedMediaFile(const QByteArray &data);
+
+  /// Destructor: delete reader.
+  ~EmbeddedMediaFile();
+
+  /// Size of the decoded stream, -1 if it is not known yet. The size of
+  /// filtered streams is only known after they have been fully decoded.
+  qint64 size() const;
+
+  /// Read at most max_size bytes starting at pos into data.
+  /// Return number of bytes read, 0 at the end and -1 on error.
+  qint64 read(const qint64 pos, char *data, const qint64 max_size);
+
+  /// Delete the reader. This must be called before the document providing
+  /// the reader is closed. Data which has not been decoded yet is lost.
+  void detachReader();
+
+  /// Key for comparison of files, may be empty.
+  const QByteArray &key() const noexcept { return _key; }
+};
+
+/**
+ * @brief Seekable read-only QIODevice for an EmbeddedMediaFile
+ *
+ * Every media player uses its own device, such that the read positions
+ * are independent. Decoding a stream only to learn its size would block
+ * the caller, so the device is sequential if the size of the file is not
+ * known when the device is created.
+ */
+class EmbeddedMediaDevice : public QIODevice
+{
+  Q_OBJECT
+
+  std::shared_ptr<EmbeddedMediaFile> file;
+
+  /// Read position in file. QIODevice does not track the position of
+  /// sequential devices.
+  qint64 position = 0;
+
+  /// Fixed when the device is created, because QIODevice caches it.
+  const bool sequential;
+
+ protected:
+  qint64 readData(char *data, qint64 max_size) override;
+
+  /// Writing is not supported.
+  qint64 writeData(const char *data, qint64 max_size) override { return -1; }
+
+ public:
+  /// Constructor: does not open the device.
+  EmbeddedMediaDevice(const std::shared_ptr<EmbeddedMediaFile> &file,
+                      QObject *parent = nullptr)
+      : QIODevice(parent), file(file), sequential(!file || file->size() < 0)
+  {
+  }
+
+  bool isSequential() const override { return sequential; }
+
+  /// Size of the file, -1 if it is not known yet.
+  qint64 size() const override { return file ? file->size() : 0; }
+
+  /// Seek to pos. Sequential devices can only be rewound.
+  bool seek(qint64 pos) override;
+
+  /// Check whether the end of the file is reached. For sequential devices
+  /// QIODevice only checks its buffer.
+  bool atEnd() const override;
+};
+
+#endif  // EMBEDDEDMEDIAFILE_H
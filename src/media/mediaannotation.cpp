@@ -61,13 +61,9 @@ bool EmbeddedMedia::operator==(const MediaAnnotation &other) const noexcept
       rect().toAlignedRect() != other.rect().toAlignedRect())
     return false;
   const auto &other_em = static_cast<const EmbeddedMedia &>(other);
-#if (QT_VERSION_MAJOR >= 6)
-  return _data->size() == other_em._data->size() &&
-         other_em._data->startsWith(
-             _data->first(std::min(_data->size(), qsizetype(64))));
-#else
-  return _data->size() == other_em._data->size();
-#endif
+  return _file == other_em._file ||
+         (_file && other_em._file && !_file->key().isEmpty() &&
+          _file->key() == other_em._file->key());
 }
 
 bool EmbeddedAudio::operator==(const MediaAnnotation &other) const noexcept
@@ -12,6 +12,7 @@
 
 #include "src/config.h"
 #include "src/log.h"
+#include "src/media/embeddedmediafile.h"
 
 /**
  * @brief MediaAnnotation: PDF annotation containing media
@@ -161,18 +162,22 @@ class ExternalMedia : public MediaAnnotation
  * played by QMediaPlayer. For the special case of raw audio data
  * with sampling rate etc. defined in the PDF, the separate class
  * EmbeddedAudio exists.
+ *
+ * The data is not loaded when the annotation is created, see
+ * EmbeddedMediaFile.
  */
 class EmbeddedMedia : public MediaAnnotation
 {
-  std::shared_ptr<QByteArray> _data;
+  std::shared_ptr<EmbeddedMediaFile> _file;
 
  public:
   /// Constructor: initialize given values
-  EmbeddedMedia(std::shared_ptr<QByteArray> &data, const QRectF &rect,
+  EmbeddedMedia(const std::shared_ptr<EmbeddedMediaFile> &file,
+                const QRectF &rect,
                 const Mode mode,
                 const MediaFlags flags = {Interactive | ShowSlider | Autoplay |
                                           HasAudio | HasVideo})
-      : MediaAnnotation(rect, mode, flags), _data(data)
+      : MediaAnnotation(rect, mode, flags), _file(file)
   {
   }
 
@@ -181,8 +186,11 @@ class EmbeddedMedia : public MediaAnnotation
 
   virtual Type type() const noexcept override { return EmbeddedFile; }
 
-  /// Data representing media.
-  std::shared_ptr<QByteArray> &data() noexcept { return _data; }
+  /// File containing the media data.
+  const std::shared_ptr<EmbeddedMediaFile> &file() const noexcept
+  {
+    return _file;
+  }
 
   virtual bool operator==(const MediaAnnotation &other) const noexcept override;
 };
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/media/mediadiscovery.h"
+
+#include <QMetaObject>
+#include <QThread>
+#include <cstdlib>
+
+#include "src/log.h"
+#include "src/media/mediaannotation.h"
+#include "src/preferences.h"
+#include "src/rendering/pdfdocument.h"
+#include "src/tracer.h"
+
+MediaDiscovery::MediaDiscovery(const std::shared_ptr<PdfDocument> &document,
+                               QObject *parent)
+    : QObject(parent),
+      document(document),
+      thread(new QThread()),
+      worker(new QObject())
+{
+  thread->setObjectName("media discovery");
+  worker->moveToThread(thread);
+  thread->start(QThread::LowPriority);
+}
+
+MediaDiscovery::~MediaDiscovery()
+{
+  thread->quit();
+  thread->wait();
+  delete worker;
+  delete thread;
+}
+
+bool MediaDiscovery::get(const int page,
+                         QList<std::shared_ptr<MediaAnnotation>> &list)
+{
+  const auto it = annotations.constFind(page);
+  if (it == annotations.cend()) {
+    request(page);
+    return false;
+  }
+  list = *it;
+  return true;
+}
+
+void MediaDiscovery::request(const int page)
+{
+  if (page < 0 || page >= document->numberOfPages() ||
+      annotations.contains(page) || pending.contains(page))
+    return;
+  debug_verbose(DebugMedia, "requesting media annotations" << page);
+  pending.insert(page);
+  const int request_generation = generation;
+  const std::shared_ptr<PdfDocument> doc = document;
+  // Results are sent to this by a queued call. If this is deleted before,
+  // the call is dropped.
+  QMetaObject::invokeMethod(
+      worker,
+      [this, doc, page, request_generation]() {
+        const TraceSpan span("media discovery", "media", page);
+        const QList<std::shared_ptr<MediaAnnotation>> list =
+            doc->annotations(page);
+        QMetaObject::invokeMethod(
+            this, [this, page, request_generation, list]() {
+              receive(page, request_generation, list);
+            });
+      },
+      Qt::QueuedConnection);
+}
+
+void MediaDiscovery::receive(
+    const int page, const int request_generation,
+    const QList<std::shared_ptr<MediaAnnotation>> &list)
+{
+  if (request_generation != generation) return;
+  pending.remove(page);
+  prune(page);
+  annotations[page] = list;
+  debug_verbose(DebugMedia,
+                "received media annotations" << page << list.size());
+  emit ready(page);
+}
+
+void MediaDiscovery::prune(const int page)
+{
+  const int current = preferences()->page;
+  for (auto it = annotations.begin(); it != annotations.end();) {
+    if (it.key() != page && std::abs(it.key() - current) > keep_distance) {
+      debug_verbose(DebugMedia, "dropping media annotations" << it.key());
+      it = annotations.erase(it);
+    } else
+      ++it;
+  }
+}
+
+void MediaDiscovery::clear()
+{
+  ++generation;
+  annotations.clear();
+  pending.clear();
+}
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef MEDIADISCOVERY_H
+#define MEDIADISCOVERY_H
+
+#include <QList>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <memory>
+
+#include "src/config.h"
+
+class MediaAnnotation;
+class PdfDocument;
+class QThread;
+
+/**
+ * @brief Find media annotations of a document in a separate thread
+ *
+ * Reading the annotations of a page requires parsing PDF objects and may
+ * block the document for a while. MediaDiscovery reads the annotations in
+ * a worker thread, usually before the page is shown, and keeps the results
+ * for later requests. ready() is emitted in the main thread when the
+ * annotations of a page are available. Results are only kept for pages
+ * near the current page, because annotations may hold the data of
+ * embedded media files.
+ *
+ * PdfDocument::annotations() must be thread safe.
+ */
+class MediaDiscovery : public QObject
+{
+  Q_OBJECT
+
+  /// Results are kept for pages with at most this distance to the current
+  /// page.
+  static constexpr int keep_distance = 3;
+
+  /// Document, which is searched for media annotations.
+  const std::shared_ptr<PdfDocument> document;
+
+  /// Thread for reading annotations.
+  QThread *thread{nullptr};
+
+  /// Object living in thread, owned by this.
+  QObject *worker{nullptr};
+
+  /// Media annotations of pages which have been read, see keep_distance.
+  QMap<int, QList<std::shared_ptr<MediaAnnotation>>> annotations;
+
+  /// Pages which have been requested but are not available yet.
+  QSet<int> pending;
+
+  /// Incremented by clear(). Results of older generations are dropped.
+  int generation = 0;
+
+  /// Drop results of pages far from the current page, except for page.
+  void prune(const int page);
+
+  /// Store results in annotations and emit ready().
+  void receive(const int page, const int request_generation,
+               const QList<std::shared_ptr<MediaAnnotation>> &list);
+
+ public:
+  /// Constructor: start worker thread.
+  MediaDiscovery(const std::shared_ptr<PdfDocument> &document,
+                 QObject *parent = nullptr);
+
+  /// Destructor: stop worker thread.
+  ~MediaDiscovery();
+
+  /// Write the media annotations of page to list if they are available and
+  /// return true. Otherwise request them and return false.
+  bool get(const int page, QList<std::shared_ptr<MediaAnnotation>> &list);
+
+  /// Read media annotations of page in the background if they are not
+  /// available yet.
+  void request(const int page);
+
+  /// Drop all results, for example after reloading the document.
+  void clear();
+
+ signals:
+  /// Media annotations of page are available.
+  void ready(int page);
+};
+
+#endif  // MEDIADISCOVERY_H
@@ -17,7 +17,7 @@ void MediaItem::createProvider()
     _provider.reset(new MediaCaptureProvider());
   else
 #endif
-    _provider.reset(new MediaPlayerProvider());
+    _provider = MediaProviderPool::acquire();
 
   switch (_annotation->type()) {
     case MediaAnnotation::ExternalURL:
@@ -26,7 +26,7 @@ void MediaItem::createProvider()
       break;
     case MediaAnnotation::EmbeddedFile:
       _provider->setSourceData(
-          std::static_pointer_cast<EmbeddedMedia>(_annotation)->data());
+          std::static_pointer_cast<EmbeddedMedia>(_annotation)->file());
       break;
     case MediaAnnotation::EmbeddedAudioStream:
       qWarning() << "Embedded audio stream is currently not supported";
@@ -14,6 +14,7 @@
 #include "src/log.h"
 #include "src/media/mediaannotation.h"
 #include "src/media/mediaprovider.h"
+#include "src/media/mediaproviderpool.h"
 
 class MediaPlayer;
 
@@ -57,19 +58,19 @@ class MediaItem
     }
   }
 
-  /// Trivial destructor
-  virtual ~MediaItem() {};
+  /// Destructor: return provider to the pool
+  virtual ~MediaItem() { MediaProviderPool::release(_provider); };
 
   /// Create media provider if necessary
   virtual void initializeProvider() { createProvider(); }
 
-  /// Clear media provider to free memory
+  /// Return media provider to the pool to free resources
   void deleteProvider()
   {
     if (_provider) {
       debug_msg(DebugMedia, "delete provider" << _provider.get());
     }
-    _provider.reset(nullptr);
+    MediaProviderPool::release(_provider);
   };
 
   /// Read information from annotation and create a derived class
@@ -102,6 +103,12 @@ class MediaItem
     if (_provider) _provider->pause();
   }
 
+  /// load media and decode the first frame without playing
+  void preroll() const
+  {
+    if (_provider) _provider->preroll();
+  }
+
   /// toggle play/pause of media item. Return true of the playing state has
   /// actually changed.
   bool toggle() const { return _provider && _provider->toggle(); }
@@ -3,10 +3,10 @@
 
 #include "src/media/mediaprovider.h"
 
-#include <QBuffer>
-#include <QByteArray>
 #include <memory>
 
+#include "src/media/embeddedmediafile.h"
+
 #if (QT_VERSION_MAJOR >= 6)
 #ifdef USE_WEBCAMS
 #include <QCamera>
@@ -32,24 +32,62 @@ void MediaPlayerProvider::handleCommonError(QMediaPlayer::Error error)
 {
   debug_msg(DebugMedia,
             "handling media error" << error << _player->errorString());
-  if (error == QMediaPlayer::ResourceError && _buffer) {
-    _buffer->seek(0);
-    _player->setMedia(QMediaContent(), _buffer);
+  if (error == QMediaPlayer::ResourceError && _device) {
+    _device->seek(0);
+    _player->setMedia(QMediaContent(), _device);
     _player->play();
   }
 }
 #endif  // QT_VERSION_MAJOR
 
-void MediaPlayerProvider::setSourceData(std::shared_ptr<QByteArray> &data)
+void MediaPlayerProvider::setSourceData(
+    const std::shared_ptr<EmbeddedMediaFile> &file)
 {
   debug_verbose(DebugMedia, "setting embedded media data" << this);
-  _buffer = new QBuffer(data.get());
-  _buffer->open(QBuffer::ReadOnly);
+  delete _device;
+  _device = new EmbeddedMediaDevice(file);
+  // The device does not buffer data, such that sequential devices can be
+  // rewound.
+  _device->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+#if (QT_VERSION_MAJOR >= 6)
+  _player->setSourceDevice(_device);
+#else
+  _player->setMedia(QMediaContent(), _device);
+#endif
+}
+
+void MediaPlayerProvider::preroll()
+{
+#if (QT_VERSION_MAJOR >= 6)
+  if (_player->playbackState() == QMediaPlayer::StoppedState) _player->pause();
+#else
+  if (_player->state() == QMediaPlayer::StoppedState) _player->pause();
+#endif
+}
+
+void MediaPlayerProvider::reset()
+{
+  debug_verbose(DebugMedia, "resetting media provider" << this);
+  _player->stop();
 #if (QT_VERSION_MAJOR >= 6)
-  _player->setSourceDevice(_buffer);
+  _player->setSource(QUrl());
+  _player->setLoops(1);
+  QObject::disconnect(_player, &MediaPlayer::mediaStatusChanged, _player,
+                      &MediaPlayer::repeatIfFinished);
+  _player->setVideoSink(nullptr);
+  _player->setVideoOutput(nullptr);
+  _player->setAudioOutput(audio_out);
+  audio_out->setMuted(false);
+  audio_out->setVolume(1.);
 #else
-  _player->setMedia(QMediaContent(), _buffer);
+  _player->setMedia(QMediaContent());
+  if (_player->playlist()) _player->playlist()->clear();
+  _player->setVideoOutput(static_cast<QGraphicsVideoItem *>(nullptr));
+  _player->setMuted(false);
+  _player->setVolume(100);
 #endif
+  delete _device;
+  _device = nullptr;
 }
 
 void MediaPlayerProvider::setMode(const MediaAnnotation::Mode mode)
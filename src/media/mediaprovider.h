@@ -4,7 +4,6 @@
 #ifndef MEDIAPROVIDER_H
 #define MEDIAPROVIDER_H
 
-#include <QBuffer>
 #include <QGraphicsVideoItem>
 #include <memory>
 
@@ -71,8 +70,10 @@ class MediaProvider
   /// set media source from a URL
   virtual void setSource(const QUrl &url) = 0;
 
-  /// set media source from (embedded) raw data
-  virtual void setSourceData(std::shared_ptr<QByteArray> &data) {};
+  /// set media source from an embedded file
+  virtual void setSourceData(const std::shared_ptr<EmbeddedMediaFile> &file)
+  {
+  }
 
   /// set video output, see also setVideoSink
   virtual void setVideoOutput(QGraphicsVideoItem *out) = 0;
@@ -110,6 +111,9 @@ class MediaProvider
   /// change playing mode
   virtual void setMode(const MediaAnnotation::Mode mode) {};
 
+  /// load media and show the first frame without playing
+  virtual void preroll() {}
+
   /// mute or unmute
   virtual void setMuted(const bool mute) const
 #if (QT_VERSION_MAJOR >= 6)
@@ -162,16 +166,16 @@ class MediaPlayerProvider :
   /// Media player, owned by this. _player should never be nullptr.
   MediaPlayer *_player = nullptr;
 
-  /// Buffer providing media data, owned by this. A buffer is only
+  /// Device providing media data, owned by this. A device is only
   /// created when playing an embedded file. Thus this will often
   /// be nullptr.
-  QBuffer *_buffer = nullptr;
+  EmbeddedMediaDevice *_device = nullptr;
 
  private slots:
 #if (QT_VERSION_MAJOR < 6)
   /**
-   * Handle resource errors for media played from buffer by reconnecting
-   * to the buffer. This aims at handling an error that occurs when using
+   * Handle resource errors for media played from device by reconnecting
+   * to the device. This aims at handling an error that occurs when using
    * Qt 5 and playing an embedded video file.
    */
   void handleCommonError(QMediaPlayer::Error error);
@@ -229,11 +233,11 @@ class MediaPlayerProvider :
   }
 #endif  // QT_VERSION_MAJOR
 
-  /// Destructor: delete _player and _buffer
+  /// Destructor: delete _player and _device
   ~MediaPlayerProvider()
   {
     delete _player;
-    delete _buffer;
+    delete _device;
   }
 
   Type type() const noexcept override { return PlayerType; }
@@ -244,7 +248,7 @@ class MediaPlayerProvider :
   void setSource(const QUrl &url) override;
 #endif
 
-  void setSourceData(std::shared_ptr<QByteArray> &data) override;
+  void setSourceData(const std::shared_ptr<EmbeddedMediaFile> &file) override;
 
   void setVideoOutput(QGraphicsVideoItem *out) override
   {
@@ -279,6 +283,14 @@ class MediaPlayerProvider :
 
   void setMode(const MediaAnnotation::Mode mode) override;
 
+  /// Pause stopped player, which loads the media and decodes the first
+  /// frame.
+  void preroll() override;
+
+  /// Stop playing, remove source and outputs and reset the mode, such that
+  /// this can be reused for other media. See MediaProviderPool.
+  void reset();
+
   /// get media player
   MediaPlayer *player() const noexcept { return _player; }
 
@@ -0,0 +1,68 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/media/mediaproviderpool.h"
+
+#include <QList>
+#include <algorithm>
+
+#include "src/log.h"
+#include "src/media/mediaprovider.h"
+#include "src/preferences.h"
+
+namespace
+{
+/// Maximum number of parked providers.
+constexpr int max_parked = 2;
+
+/// Parked providers, owned by the pool.
+QList<MediaPlayerProvider *> parked;
+
+/// Number of providers in use.
+int in_use = 0;
+}  // namespace
+
+std::unique_ptr<MediaPlayerProvider> MediaProviderPool::acquire()
+{
+  ++in_use;
+  if (parked.isEmpty()) return std::make_unique<MediaPlayerProvider>();
+  debug_verbose(DebugMedia, "reusing media provider" << parked.last());
+  return std::unique_ptr<MediaPlayerProvider>(parked.takeLast());
+}
+
+void MediaProviderPool::release(std::unique_ptr<MediaProvider> &provider)
+{
+  if (!provider) return;
+  if (provider->type() != MediaProvider::PlayerType) {
+    provider.reset();
+    return;
+  }
+  --in_use;
+  if (parked.size() >= max_parked) {
+    provider.reset();
+    return;
+  }
+  auto player = static_cast<MediaPlayerProvider *>(provider.release());
+  player->reset();
+  parked.append(player);
+}
+
+void MediaProviderPool::reserve(const int number)
+{
+  while (parked.size() < std::min(number, max_parked))
+    parked.append(new MediaPlayerProvider());
+}
+
+int MediaProviderPool::active() noexcept { return in_use; }
+
+bool MediaProviderPool::overBudget() noexcept
+{
+  const int max = preferences()->max_media_players;
+  return max >= 0 && in_use > max;
+}
+
+void MediaProviderPool::clear()
+{
+  qDeleteAll(parked);
+  parked.clear();
+}
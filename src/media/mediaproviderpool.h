@@ -0,0 +1,54 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef MEDIAPROVIDERPOOL_H
+#define MEDIAPROVIDERPOOL_H
+
+#include <memory>
+
+#include "src/config.h"
+
+class MediaProvider;
+class MediaPlayerProvider;
+
+/**
+ * @brief Pool of media player providers shared by all slides
+ *
+ * Creating a media player (including its audio output) takes a noticeable
+ * amount of time. Providers which are no longer needed are therefore
+ * reset and parked here instead of being deleted, and a spare provider
+ * can be created ahead of time.
+ *
+ * The pool also counts the providers in use. SlideScene releases
+ * providers of media items which are not visible as long as more
+ * providers are in use than allowed by the preferences.
+ *
+ * The pool must only be used from the main thread.
+ */
+class MediaProviderPool
+{
+ public:
+  MediaProviderPool() = delete;
+
+  /// Take a provider from the pool or create a new one. The caller takes
+  /// ownership.
+  static std::unique_ptr<MediaPlayerProvider> acquire();
+
+  /// Reset provider and return it to the pool. Providers which are not
+  /// media player providers are deleted.
+  static void release(std::unique_ptr<MediaProvider> &provider);
+
+  /// Create providers until at least number providers are parked.
+  static void reserve(const int number);
+
+  /// Number of providers in use.
+  static int active() noexcept;
+
+  /// Check whether more providers are in use than allowed.
+  static bool overBudget() noexcept;
+
+  /// Delete all parked providers.
+  static void clear();
+};
+
+#endif  // MEDIAPROVIDERPOOL_H
@@ -8,6 +8,7 @@
 #include <QBuffer>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QImage>
 #include <QMimeDatabase>
 #include <QMimeType>
 #include <QPainter>
@@ -24,6 +25,7 @@
 #include "src/drawing/pathcontainer.h"
 #include "src/log.h"
 #include "src/master.h"
+#include "src/media/mediadiscovery.h"
 #include "src/names.h"
 #include "src/preferences.h"
 #include "src/rendering/abstractrenderer.h"
@@ -41,6 +43,7 @@
 
 PdfMaster::~PdfMaster()
 {
+  delete media_discovery;
   qDeleteAll(paths);
   paths.clear();
 }
@@ -55,6 +58,7 @@ bool PdfMaster::loadDocument(const QString &filename)
                                          "different file is already loaded!"));
     else if (document->loadDocument()) {
       document->loadLabels();
+      if (media_discovery) media_discovery->clear();
       return true;
     }
     return false;
@@ -85,6 +89,9 @@ bool PdfMaster::loadDocument(const QString &filename)
     return false;
   } else {
     document->loadLabels();
+    media_discovery = new MediaDiscovery(document, this);
+    connect(media_discovery, &MediaDiscovery::ready, this,
+            &PdfMaster::mediaAnnotationsReady);
     return true;
   }
 }
@@ -93,11 +100,23 @@ bool PdfMaster::loadDocument()
 {
   if (document && document->loadDocument()) {
     document->loadLabels();
+    if (media_discovery) media_discovery->clear();
     return true;
   }
   return false;
 }
 
+bool PdfMaster::mediaAnnotations(
+    const int page, QList<std::shared_ptr<MediaAnnotation>> &list) const
+{
+  return media_discovery && media_discovery->get(page, list);
+}
+
+void PdfMaster::prefetchMediaAnnotations(const int page) const
+{
+  if (media_discovery) media_discovery->request(page);
+}
+
 SlideScene *PdfMaster::getActiveScene(const PPage ppage) const
 {
   for (auto scene : scenes) {
@@ -316,6 +335,51 @@ void PdfMaster::writePages(QXmlStreamWriter &writer,
   if (save_bp_specific) _flags &= ~UnsavedTimes;
 }
 
+void PdfMaster::writePageBinary(QByteArray &data, const int page) const
+{
+  QMap<PagePart, const PathContainer *> container_lst;
+  for (const PagePart page_part : {FullPage, LeftHalf, RightHalf}) {
+    PPage ppage = {page, page_part};
+    shiftToDrawings(ppage);
+    const PathContainer *container = paths.value(ppage, nullptr);
+    if (container) container_lst[page_part] = container;
+  }
+  const auto time = target_times.constFind(page);
+  BinaryDrawings::writePageHeader(
+      data, page, time == target_times.cend() ? -1 : qint64(*time),
+      container_lst.size());
+  for (auto it = container_lst.cbegin(); it != container_lst.cend(); ++it)
+    (*it)->writeBinary(data, it.key());
+}
+
+quint64 PdfMaster::pageRevision(const int page) const
+{
+  // FNV-1a style combination of all parts. A missing container contributes
+  // 0, which is never used as revision. Thus deleting or replacing a
+  // container changes the result.
+  quint64 revision = 0xcbf29ce484222325;
+  for (const PagePart page_part : {FullPage, LeftHalf, RightHalf}) {
+    PPage ppage = {page, page_part};
+    shiftToDrawings(ppage);
+    const PathContainer *container = paths.value(ppage, nullptr);
+    revision ^= container ? container->revision() : 0;
+    revision *= 0x100000001b3;
+  }
+  return revision;
+}
+
+bool PdfMaster::writePagesBinary(BinaryDrawings::Writer &writer)
+{
+  QByteArray data;
+  for (auto page : master()->pageIdx()) {
+    data.clear();
+    writePageBinary(data, page);
+    if (!writer.writeChunk("PAGE", data)) return false;
+  }
+  _flags &= ~(UnsavedDrawings | UnsavedTimes);
+  return true;
+}
+
 QBuffer *loadZipToBuffer(const QString &filename)
 {
   // This is probably not how it should be done.
@@ -375,6 +439,48 @@ void PdfMaster::readDrawingsFromStream(QXmlStreamReader &reader, const int page)
   PathContainer::loadDrawings(reader, center, left, right, page_half);
 }
 
+void PdfMaster::readDrawingsFromBinary(const BinaryDrawings::Page &page_data,
+                                       const int page)
+{
+  if (page >= document->numberOfPages()) {
+    for (const auto &layer : page_data.layers) qDeleteAll(layer.items);
+    return;
+  }
+  if (page >= 0 && page_data.endtime >= 0)
+    target_times[page] = page_data.endtime;
+  if ((_flags & HalfPageUsed) == 0) {
+    PathContainer *container = paths.value({page, FullPage}, nullptr);
+    if (!container) {
+      container = new PathContainer(this);
+      paths[{page, FullPage}] = container;
+    }
+    QList<QGraphicsItem *> items;
+    for (const auto &layer : page_data.layers) items.append(layer.items);
+    container->addItemsForeground(items);
+    return;
+  }
+  PathContainer *left = paths.value({page, LeftHalf}, nullptr),
+                *right = paths.value({page, RightHalf}, nullptr),
+                *center = paths.value({page, FullPage}, nullptr);
+  const qreal page_half = document->pageSize(std::max(page, 0)).width() / 2;
+  if (_flags & LeftHalfUsed && !left) {
+    left = new PathContainer(this);
+    paths[{page, LeftHalf}] = left;
+  }
+  if (_flags & RightHalfUsed && !right) {
+    right = new PathContainer(this);
+    paths[{page, RightHalf}] = right;
+  }
+  if (_flags & FullPageUsed && !center) {
+    center = new PathContainer(this);
+    paths[{page, FullPage}] = center;
+  }
+  for (const auto &layer : page_data.layers)
+    for (const auto item : layer.items)
+      PathContainer::distributeItem(item, layer.part, center, left, right,
+                                    page_half);
+}
+
 PathContainer *PdfMaster::pathContainerCreate(PPage ppage)
 {
   switch (preferences()->overlay_mode) {
@@ -395,6 +501,9 @@ PathContainer *PdfMaster::pathContainerCreate(PPage ppage)
       while (source_page-- > start_overlay) {
         copy_container = paths.value({source_page, ppage.part}, nullptr);
         if (copy_container) {
+          // Keep the existing copy if the source has not changed.
+          if (container && container->isPlainCopyOf(copy_container))
+            return container;
           delete container;
           container = copy_container->copy();
           paths[ppage] = container;
@@ -460,26 +569,50 @@ QPixmap PdfMaster::exportImage(const PPage ppage,
   QPixmap pixmap;
   if (ppage.page >= 0) {
     const auto *renderer = createRenderer(document, ppage.part);
-    if (!renderer || !renderer->isValid()) return pixmap;
+    if (!renderer || !renderer->isValid()) {
+      delete renderer;
+      return pixmap;
+    }
     pixmap = renderer->renderPixmap(ppage.page, resolution);
+    delete renderer;
   } else {
     pixmap = QPixmap(document->pageSize(0).toSize());
   }
+  QPainter painter;
+  painter.begin(&pixmap);
+  paintDrawings(painter, ppage, resolution);
+  painter.end();
+  return pixmap;
+}
+
+void PdfMaster::paintDrawings(QPainter &painter, PPage ppage,
+                              const qreal resolution) const
+{
+  shiftToDrawings(ppage);
   const auto *container = paths.value(ppage, nullptr);
-  if (container) {
-    debug_msg(DebugDrawing, "Exporting items");
-    QStyleOptionGraphicsItem style;
-    QPainter painter;
-    painter.begin(&pixmap);
-    for (auto item : *container) {
-      painter.resetTransform();
-      painter.scale(resolution, resolution);
-      painter.setTransform(item->sceneTransform(), true);
-      item->paint(&painter, &style);
-    }
-    painter.end();
+  if (!container) return;
+  debug_msg(DebugDrawing, "Exporting items");
+  QStyleOptionGraphicsItem style;
+  for (auto item : *container) {
+    painter.resetTransform();
+    painter.scale(resolution, resolution);
+    painter.setTransform(item->sceneTransform(), true);
+    item->paint(&painter, &style);
   }
-  return pixmap;
+}
+
+QPicture PdfMaster::recordDrawings(const PPage ppage) const
+{
+  QPicture picture;
+  PPage shifted = ppage;
+  shiftToDrawings(shifted);
+  const auto *container = paths.value(shifted, nullptr);
+  if (!container || container->empty()) return picture;
+  QPainter painter;
+  painter.begin(&picture);
+  paintDrawings(painter, ppage, 1.);
+  painter.end();
+  return picture;
 }
 
 int PdfMaster::overlaysShiftedSlide(int slide,
@@ -508,15 +641,23 @@ int PdfMaster::overlaysShiftedPage(int page,
   return page;
 }
 
-void PdfMaster::exportSvg(PPage ppage, const QString filename) const
+void PdfMaster::exportSvg(const PPage ppage, const QString filename) const
+{
+  QSvgGenerator generator;
+  generator.setFileName(filename);
+  writeSvg(generator, ppage, false);
+}
+
+void PdfMaster::writeSvg(QSvgGenerator &generator, PPage ppage,
+                         const bool clip_to_page, const QImage &background,
+                         const QPicture *drawings) const
 {
   shiftToDrawings(ppage);
   QSizeF size = document->pageSize(std::max(ppage.page, 0));
   if (ppage.part == PagePart::LeftHalf || ppage.part == PagePart::RightHalf)
     size.rwidth() /= 2;
-  const PathContainer *container = paths.value(ppage, nullptr);
-  QSvgGenerator generator;
-  generator.setFileName(filename);
+  const PathContainer *container =
+      drawings ? nullptr : paths.value(ppage, nullptr);
   if (ppage.part != PagePart::FullPage &&
       ppage.part != PagePart::UnknownPagePart) {
     const QString ppname = get_page_part_names().value(ppage.part, "");
@@ -526,17 +667,25 @@ void PdfMaster::exportSvg(PPage ppage, const QString filename) const
     generator.setTitle("annotations on page " + QString::number(ppage.page));
   {  // scope only for memory handling
     QRectF viewbox({0, 0}, size);
-    if (container) viewbox = viewbox.united(container->boundingBox());
+    if (container && !clip_to_page)
+      viewbox = viewbox.united(container->boundingBox());
     QRect aviewbox = viewbox.toAlignedRect();
     generator.setSize(aviewbox.size());
     generator.setViewBox(aviewbox);
   }
-  if (container) {
+  if (container || (drawings && !drawings->isNull()) ||
+      !background.isNull()) {
     QPainter painter;
     painter.begin(&generator);
+    if (!background.isNull())
+      painter.drawImage(QRectF({0, 0}, size), background);
+    if (clip_to_page) painter.setClipRect(QRectF({0, 0}, size));
     const QStyleOptionGraphicsItem opt;
-    for (auto it = container->begin(); it != container->end(); ++it)
-      (*it)->paint(&painter, &opt);
+    if (drawings)
+      painter.drawPicture(0, 0, *drawings);
+    else if (container)
+      for (auto it = container->begin(); it != container->end(); ++it)
+        (*it)->paint(&painter, &opt);
     painter.end();
   }
 }
@@ -4,9 +4,11 @@
 #ifndef PDFMASTER_H
 #define PDFMASTER_H
 
+#include <QImage>
 #include <QList>
 #include <QMap>
 #include <QObject>
+#include <QPicture>
 #include <QRectF>
 #include <QString>
 #include <algorithm>
@@ -15,15 +17,20 @@
 #include <utility>
 
 #include "src/config.h"
+#include "src/drawing/binarydrawings.h"
 #include "src/drawing/pathcontainer.h"
 #include "src/enumerates.h"
 #include "src/rendering/pdfdocument.h"
 
 class SlideScene;
+class MediaAnnotation;
+class MediaDiscovery;
 class QGraphicsItem;
 class QBuffer;
 class QXmlStreamReader;
 class QXmlStreamWriter;
+class QPainter;
+class QSvgGenerator;
 class AbstractGraphicsPath;
 class TextGraphicsItem;
 struct SlideTransition;
@@ -84,6 +91,9 @@ class PdfMaster : public QObject
   /// Search results (currently only one results)
   std::pair<int, QList<QRectF>> search_results;
 
+  /// Reads media annotations in a separate thread, owned by this.
+  MediaDiscovery *media_discovery{nullptr};
+
   /// make sure paths[page] is a PathContainer*
   void assertPageExists(const PPage ppage) noexcept
   {
@@ -106,7 +116,7 @@ class PdfMaster : public QObject
   /// Create empty, uninitialized PdfMaster.
   explicit PdfMaster() {}
 
-  /// Destructor. Deletes paths and document.
+  /// Destructor. Deletes media discovery, paths and document.
   ~PdfMaster();
 
   /// get function for search_results
@@ -162,6 +172,15 @@ class PdfMaster : public QObject
   /// Number of pages in the document.
   int numberOfPages() const { return document->numberOfPages(); }
 
+  /// Write media annotations of page to list and return true if they are
+  /// available. Otherwise read them in the background, emit
+  /// mediaAnnotationsReady when they are available and return false.
+  bool mediaAnnotations(const int page,
+                        QList<std::shared_ptr<MediaAnnotation>> &list) const;
+
+  /// Read media annotations of page in the background.
+  void prefetchMediaAnnotations(const int page) const;
+
   /// Get page number of page shifted by shift_overlay.
   /// Here in shift_overlay the bits of ShiftOverlay::FirstOverlay and
   /// ShiftOverlay::LastOverlay control the interpretation of the shift.
@@ -189,15 +208,43 @@ class PdfMaster : public QObject
   /// Write page (part) to image, including drawings.
   QPixmap exportImage(const PPage ppage, const qreal resolution) const noexcept;
 
+  /// Paint drawings of page (part) with painter. The painter should paint
+  /// on an image of the page rendered with resolution (in pixels per point).
+  /// This paints the graphics items and must be called in the main thread.
+  void paintDrawings(QPainter &painter, PPage ppage,
+                     const qreal resolution) const;
+
+  /// Record drawings of page (part) in page coordinates (points). The
+  /// picture is null if there are no drawings. In contrast to the graphics
+  /// items, the picture can be painted in other threads. Must be called in
+  /// the main thread.
+  QPicture recordDrawings(const PPage ppage) const;
+
   /// Export annotations to a page as SVG image.
   void exportSvg(const PPage page, const QString filename) const;
 
+  /// Write annotations on page (part) to generator. If clip_to_page is
+  /// false, the view box is extended to include all annotations. If
+  /// background is not null, it is drawn below the annotations, scaled to
+  /// the page size. If drawings is not nullptr, it is painted instead of the
+  /// graphics items (see recordDrawings()), and this may be called from
+  /// other threads if clip_to_page is true.
+  void writeSvg(QSvgGenerator &generator, PPage ppage,
+                const bool clip_to_page,
+                const QImage &background = QImage(),
+                const QPicture *drawings = nullptr) const;
+
   /// Export all annotations on all pages as SVG images.
   void exportAllSvg(QString dirname = "") const;
 
   /// Load drawings from XML reader, must be in element <layer>
   void readDrawingsFromStream(QXmlStreamReader &reader, const int page);
 
+  /// Add drawings read from a binary file to given page. Takes ownership of
+  /// all items in page_data.
+  void readDrawingsFromBinary(const BinaryDrawings::Page &page_data,
+                              const int page);
+
   /// Get path container at given page. If overlay_mode==Cumulative, this may
   /// create and return a copy of a previous path container.
   /// page (part) number is given as (page | page_part).
@@ -233,6 +280,18 @@ class PdfMaster : public QObject
   /// Write pages objects to XML
   void writePages(QXmlStreamWriter &writer, const bool save_bp_specific);
 
+  /// Write pages as "PAGE" chunks in binary format.
+  bool writePagesBinary(BinaryDrawings::Writer &writer);
+
+  /// Write payload of a "PAGE" chunk for given page in binary format.
+  void writePageBinary(QByteArray &data, const int page) const;
+
+  /// Hash of the revisions of the path containers of a page (all page
+  /// parts). This changes whenever the drawings on this page change,
+  /// including when a container is created, replaced or deleted.
+  /// @see PathContainer::revision()
+  quint64 pageRevision(const int page) const;
+
  public slots:
   /// Handle the given action.
   void receiveAction(const Action action);
@@ -326,6 +385,8 @@ class PdfMaster : public QObject
   void setTotalTime(const QTime time);
   /// Send navigation signal to master.
   void sendPage(const int page);
+  /// Media annotations of page are available, see mediaAnnotations().
+  void mediaAnnotationsReady(int page);
   /// Tell slides to update search results.
   void updateSearch();
 };
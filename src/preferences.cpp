@@ -337,8 +337,18 @@ void Preferences::loadSettings()
   if (ok) history_length_visible_slides = value;
   value = settings.value("history length hidden").toUInt(&ok);
   if (ok) history_length_hidden_slides = value;
+  value = settings.value("autosave interval").toUInt(&ok);
+  if (ok) autosave_interval = value;
   overlay_mode = get_string_to_overlay_mode().value(
       settings.value("mode").toString(), OverlayDrawingMode::Cumulative);
+  value = settings.value("input coalesce interval").toUInt(&ok);
+  if (ok && value < 1000) input_coalesce_interval = value;
+  num = settings.value("input min distance").toDouble(&ok);
+  if (ok && 0 <= num && num < 10) input_min_distance = num;
+  num = settings.value("input smoothing").toDouble(&ok);
+  if (ok && 0 <= num && num < 1) input_smoothing = num;
+  value = settings.value("input prediction").toUInt(&ok);
+  if (ok && value < 100) input_prediction = value;
   num = settings.value("line sensitifity").toDouble(&ok);
   if (ok && 0 < num && num < 0.1) line_sensitivity = num;
   num = settings.value("snap angle").toDouble(&ok);
@@ -391,6 +401,7 @@ void Preferences::loadSettings()
 #ifdef USE_EXTERNAL_RENDERER
     rendering_command = settings.value("rendering command").toString();
     rendering_arguments = settings.value("rendering arguments").toStringList();
+    rendering_worker = settings.value("rendering worker", false).toBool();
 #endif
     const QString renderer_str =
         settings.value("renderer").toString().toLower();
@@ -441,6 +452,11 @@ void Preferences::loadSettings()
   if (ok) max_memory = memory;
   const int npages = settings.value("cache pages").toInt(&ok);
   if (ok) max_cache_pages = npages;
+  const int nplayers = settings.value("media players").toInt(&ok);
+  if (ok) max_media_players = nplayers;
+  const qreal shared_memory =
+      settings.value("shared cache memory").toFloat(&ok);
+  if (ok) shared_cache_memory = shared_memory;
 
   // INTERACTION
   // Default tools associated to devices
@@ -878,6 +894,14 @@ void Preferences::setHistoryHiddenSlide(const int length)
   settings.endGroup();
 }
 
+void Preferences::setAutosaveInterval(const int seconds)
+{
+  if (seconds >= 0) autosave_interval = seconds;
+  settings.beginGroup("drawing");
+  settings.setValue("autosave interval", autosave_interval);
+  settings.endGroup();
+}
+
 void Preferences::setLogSlideChanges(const bool log)
 {
   if (log) {
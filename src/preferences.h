@@ -92,8 +92,22 @@ class Preferences : public QObject
   int history_length_visible_slides = 50;
   /// Maximum number of steps in drawing history of hidden slide.
   int history_length_hidden_slides = 20;
+  /// Interval for automatic saving of drawings in seconds. Autosave is
+  /// disabled if this is 0.
+  int autosave_interval = 120;
   /// Define how should drawings be assigned to overlays.
   OverlayDrawingMode overlay_mode = OverlayDrawingMode::Cumulative;
+  /// Interval in ms in which input samples of freehand strokes are added to
+  /// the path. 0 adds every sample directly.
+  int input_coalesce_interval = 8;
+  /// Minimal distance in points between nodes of freehand strokes.
+  qreal input_min_distance = 0.25;
+  /// Smoothing of freehand strokes: weight of the previous position in an
+  /// exponential moving average. 0 disables smoothing.
+  qreal input_smoothing = 0.;
+  /// Time in ms by which strokes are extrapolated while drawing.
+  /// 0 disables the prediction.
+  int input_prediction = 0;
 
   // SHAPE RECOGNITION
   /// Parameter for sensitivity of line detectoin.
@@ -158,6 +172,8 @@ class Preferences : public QObject
   QString rendering_command;
   /// Arguments to rendering_command.
   QStringList rendering_arguments;
+  /// Start rendering_command once per renderer as persistent worker.
+  bool rendering_worker = false;
 #endif
 
   /// Maximally allowed memory size in bytes.
@@ -166,6 +182,13 @@ class Preferences : public QObject
   /// Maximally allowed number of pages in cache.
   /// Negative numbers are interpreted as infinity.
   int max_cache_pages = -1;
+  /// Maximum number of media players in use before players of media,
+  /// which are not visible, are released.
+  /// Negative numbers are interpreted as infinity.
+  int max_media_players = 8;
+  /// Size in bytes of the render cache shared with other processes showing
+  /// the same document. 0 disables the shared cache.
+  float shared_cache_memory = 0.;
 
   // INTERACTION
   /// Touch screen gestures
@@ -338,6 +361,8 @@ class Preferences : public QObject
   void setHistoryVisibleSlide(const int length);
   /// Set number of drawing history steps for hidden slides.
   void setHistoryHiddenSlide(const int length);
+  /// Set autosave interval in seconds, 0 disables autosave.
+  void setAutosaveInterval(const int seconds);
   /// Enable/disable logging of slide changes.
   void setLogSlideChanges(const bool log);
 #ifdef USE_EXTERNAL_RENDERER
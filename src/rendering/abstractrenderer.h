@@ -4,6 +4,14 @@
 #ifndef ABSTRACTRENDERER_H
 #define ABSTRACTRENDERER_H
 
+#include <QImage>
+#include <QPair>
+#include <QPoint>
+#include <QRect>
+#include <QRectF>
+#include <QSize>
+#include <QSizeF>
+
 #include "src/config.h"
 #include "src/enumerates.h"
 
@@ -28,6 +36,30 @@ class AbstractRenderer
   /// get page_part;
   PagePart pagePart() const { return page_part; }
 
+  /// Rectangle in points showing the given part of a page of given size.
+  static QRectF partRect(const QSizeF &size, const PagePart part)
+  {
+    switch (part) {
+      case LeftHalf:
+        return {0., 0., size.width() / 2, size.height()};
+      case RightHalf:
+        return {size.width() / 2, 0., size.width() / 2, size.height()};
+      default:
+        return {QPointF(), size};
+    }
+  }
+
+  /// Rectangle in pixels of an image rendered with the given resolution
+  /// corresponding to rect in points. Adjacent rectangles are mapped to
+  /// adjacent pixel rectangles.
+  static QRect pixelRect(const QRectF &rect, const qreal resolution)
+  {
+    const QPoint top_left(qRound(resolution * rect.left()),
+                          qRound(resolution * rect.top()));
+    return {top_left, QSize(qRound(resolution * rect.right()) - top_left.x(),
+                            qRound(resolution * rect.bottom()) - top_left.y())};
+  }
+
   /// Render page to a QPixmap. Resolution is given in pixels per point
   /// (dpi/72).
   virtual const QPixmap renderPixmap(const int page,
@@ -38,6 +70,22 @@ class AbstractRenderer
   virtual const PngPixmap *renderPng(const int page,
                                      const qreal resolution) const = 0;
 
+  /// Render only the part rect of a page to a QImage. rect is given in
+  /// points relative to the top left corner of the page and is independent
+  /// of page_part. The image has the size pixelRect(rect, resolution), but
+  /// is clipped to the page. Resolution is given in pixels per point
+  /// (dpi/72). In contrast to renderPixmap, this is safe in all threads.
+  virtual const QImage renderImage(const int page, const qreal resolution,
+                                   const QRectF &rect) const = 0;
+
+  /// Render left and right half of a page to PNG images using a single
+  /// rasterisation. This is independent of page_part and used if both halves
+  /// are shown in different views (beamer notes on the second screen).
+  /// Resolution is given in pixels per point (dpi/72).
+  /// The caller takes ownership of both images, which may be nullptr.
+  virtual QPair<const PngPixmap *, const PngPixmap *> renderHalvesPng(
+      const int page, const qreal resolution) const = 0;
+
   /// Check if renderer is valid and can in principle render pages.
   virtual bool isValid() const = 0;
 };
@@ -3,27 +3,82 @@
 
 #include "src/rendering/externalrenderer.h"
 
+#include <QFileInfo>
+#include <QImage>
 #include <QPixmap>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QThread>
 
 #include "src/config.h"
 #include "src/enumerates.h"
 #include "src/log.h"
+#include "src/rendering/externalworker.h"
 #include "src/rendering/pdfdocument.h"
 #include "src/rendering/pngpixmap.h"
 
 ExternalRenderer::ExternalRenderer(
     const QString &command, const QStringList &arguments,
-    const std::shared_ptr<const PdfDocument> &doc, const PagePart part)
+    const std::shared_ptr<const PdfDocument> &doc, const PagePart part,
+    const bool use_worker)
     : AbstractRenderer(part),
       renderingCommand(command),
       renderingArguments(arguments),
-      doc(doc)
+      doc(doc),
+      use_worker(use_worker)
 {
   renderingArguments.replaceInStrings("%file", doc->getPath());
 }
 
+ExternalRenderer::~ExternalRenderer()
+{
+  if (worker_thread) {
+    // worker is deleted when the thread finishes.
+    worker_thread->quit();
+    if (worker_thread->wait(worker_wait_time_ms))
+      delete worker_thread;
+    else {
+      // Deleting a running thread would crash. Delete it when it finishes.
+      qWarning() << "External rendering worker did not finish in time";
+      QObject::connect(worker_thread, &QThread::finished, worker_thread,
+                       &QObject::deleteLater);
+    }
+  }
+}
+
+const QByteArray ExternalRenderer::workerRequest(const int page,
+                                                 const qreal resolution,
+                                                 const QString &format) const
+{
+  const QSize size = (resolution * doc->pageSize(page)).toSize();
+  const QByteArray line =
+      QByteArray::number(page) + ' ' + QByteArray::number(72 * resolution) +
+      ' ' + format.toLatin1() + ' ' + QByteArray::number(size.width()) + ' ' +
+      QByteArray::number(size.height());
+  const QDateTime modified = QFileInfo(doc->getPath()).lastModified();
+  if (!worker) {
+    worker_thread = new QThread();
+    worker = new ExternalWorker(renderingCommand, renderingArguments);
+    worker->moveToThread(worker_thread);
+    QObject::connect(worker_thread, &QThread::finished, worker,
+                     &QObject::deleteLater);
+    worker_thread->start();
+    worker_modified = modified;
+  } else if (modified != worker_modified) {
+    debug_msg(DebugRendering, "restarting external worker" << modified);
+    QMetaObject::invokeMethod(
+        worker, [&]() { worker->stop(); }, Qt::BlockingQueuedConnection);
+    worker_modified = modified;
+  }
+  QByteArray data;
+  // The process belongs to the worker thread. Several renderers (one per
+  // cache thread) have independent workers which run in parallel.
+  QMetaObject::invokeMethod(
+      worker, [&]() { data = worker->request(line); },
+      Qt::BlockingQueuedConnection);
+  return data;
+}
+
 const QStringList ExternalRenderer::getArguments(const int page,
                                                  const qreal resolution,
                                                  const QString &format) const
@@ -54,6 +109,11 @@ const PngPixmap *ExternalRenderer::renderPng(const int page,
     qWarning() << "Invalid page or resolution" << page << resolution;
     return nullptr;
   }
+  if (page_part == FullPage && use_worker) {
+    const QByteArray data = workerRequest(page, resolution, "png");
+    if (data.isEmpty()) return nullptr;
+    return new PngPixmap(new QByteArray(data), page, resolution);
+  }
   if (page_part == FullPage) {
     QProcess *process = new QProcess();
     process->start(renderingCommand, getArguments(page, resolution, "png"),
@@ -76,12 +136,14 @@ const PngPixmap *ExternalRenderer::renderPng(const int page,
   return new PngPixmap(pixmap, page, resolution);
 }
 
-const QPixmap ExternalRenderer::renderPixmap(const int page,
-                                             const qreal resolution) const
+const QImage ExternalRenderer::renderFullImage(const int page,
+                                               const qreal resolution) const
 {
-  if (!doc || !doc->checkResolution(page, resolution)) {
-    qWarning() << "Invalid page or resolution" << page << resolution;
-    return QPixmap();
+  if (use_worker) {
+    QImage image;
+    if (!image.loadFromData(workerRequest(page, resolution, "pnm")))
+      qWarning() << "Failed to load data from external renderer";
+    return image;
   }
   QProcess *process = new QProcess();
   process->start(renderingCommand, getArguments(page, resolution, "pnm"),
@@ -90,13 +152,26 @@ const QPixmap ExternalRenderer::renderPixmap(const int page,
     // TODO: clean up correctly
     process->kill();
     delete process;
-    return QPixmap();
+    return QImage();
   }
   const QByteArray data = process->readAllStandardOutput();
   process->deleteLater();
-  QPixmap pixmap;
-  if (!pixmap.loadFromData(data))
+  QImage image;
+  if (!image.loadFromData(data))
     qWarning() << "Failed to load data from external renderer";
+  return image;
+}
+
+const QPixmap ExternalRenderer::renderPixmap(const int page,
+                                             const qreal resolution) const
+{
+  if (!doc || !doc->checkResolution(page, resolution)) {
+    qWarning() << "Invalid page or resolution" << page << resolution;
+    return QPixmap();
+  }
+  const QImage image = renderFullImage(page, resolution);
+  if (image.isNull()) return QPixmap();
+  const QPixmap pixmap = QPixmap::fromImage(image);
   switch (page_part) {
     case LeftHalf:
       return pixmap.copy(0, 0, pixmap.width() / 2, pixmap.height());
@@ -108,12 +183,42 @@ const QPixmap ExternalRenderer::renderPixmap(const int page,
   }
 }
 
+const QImage ExternalRenderer::renderImage(const int page,
+                                           const qreal resolution,
+                                           const QRectF &rect) const
+{
+  if (!doc || !doc->checkResolution(page, resolution)) {
+    qWarning() << "Invalid page or resolution" << page << resolution;
+    return QImage();
+  }
+  // The external program always renders the full page.
+  return renderFullImage(page, resolution).copy(pixelRect(rect, resolution));
+}
+
+QPair<const PngPixmap *, const PngPixmap *> ExternalRenderer::renderHalvesPng(
+    const int page, const qreal resolution) const
+{
+  if (!doc || !doc->checkResolution(page, resolution)) {
+    qWarning() << "Invalid page or resolution" << page << resolution;
+    return {nullptr, nullptr};
+  }
+  const QImage image = renderFullImage(page, resolution);
+  if (image.isNull()) return {nullptr, nullptr};
+  const int width = image.width() / 2;
+  return {new PngPixmap(image.copy(0, 0, width, image.height()), page,
+                        resolution),
+          new PngPixmap(image.copy((image.width() + 1) / 2, 0, width,
+                                   image.height()),
+                        page, resolution)};
+}
+
 bool ExternalRenderer::isValid() const
 {
   // Very basic check:
   // Is a command defined?
   // Does it take arguments? Do these arguments contain %page?
   debug_msg(DebugRendering, renderingCommand << renderingArguments);
+  if (use_worker) return !renderingCommand.isEmpty();
   static const QRegularExpression regex(".*%0?page.*");
   return !renderingCommand.isEmpty() && !renderingArguments.isEmpty() &&
          renderingArguments.indexOf(regex) != -1;
@@ -4,6 +4,10 @@
 #ifndef EXTERNALRENDERER_H
 #define EXTERNALRENDERER_H
 
+#include <QDateTime>
+#include <QImage>
+#include <QPair>
+#include <QRectF>
 #include <QStringList>
 #include <memory>
 
@@ -11,14 +15,19 @@
 #include "src/rendering/abstractrenderer.h"
 
 class QPixmap;
+class QThread;
 class PngPixmap;
 class PdfDocument;
+class ExternalWorker;
 
 /// Render PDF pages by calling an external program.
 class ExternalRenderer : public AbstractRenderer
 {
   static constexpr int max_process_time_ms = 60000;
 
+  /// Maximum time for stopping the worker thread.
+  static constexpr int worker_wait_time_ms = 5000;
+
   /// Program used to render pages.
   QString const renderingCommand;
 
@@ -34,23 +43,52 @@ class ExternalRenderer : public AbstractRenderer
   /// Document which should be rendered.
   const std::shared_ptr<const PdfDocument> doc;
 
+  /// Use a persistent rendering process instead of starting a new process
+  /// for each page.
+  const bool use_worker;
+
+  /// Persistent rendering process living in worker_thread, created on the
+  /// first request if use_worker is true.
+  mutable ExternalWorker* worker{nullptr};
+
+  /// Thread of worker.
+  mutable QThread* worker_thread{nullptr};
+
+  /// Modification time of the document when the process of worker was
+  /// started. The process is restarted when the file changes, since it
+  /// would otherwise keep showing the old file.
+  mutable QDateTime worker_modified;
+
+  /// Request page from worker and wait for the answer. This starts the
+  /// worker if necessary. Return empty QByteArray on failure.
+  /// A renderer must only be used by one thread at a time.
+  const QByteArray workerRequest(const int page, const qreal resolution,
+                                 const QString& format) const;
+
   /// Arguments to renderingCommand for rendering given page.
   /// Here all macros in renderingArguments are expanded using the arguments
   /// of this function.
   const QStringList getArguments(const int page, const qreal resolution,
                                  const QString& format = "png") const;
 
+  /// Render full page to QImage using format pnm.
+  const QImage renderFullImage(const int page, const qreal resolution) const;
+
  public:
   /// Constructor, initializes command and arguments. No checks are
   /// performed. Command should contain the fields %file and %page.
   /// Additionally at least one of the fields %resolution or %width and
   /// %height is required.
+  /// If use_worker is true, the command is instead started once as
+  /// persistent worker, see ExternalWorker. Arguments then only need %file.
+  /// The worker is started when the first page is rendered.
   ExternalRenderer(const QString& command, const QStringList& arguments,
                    const std::shared_ptr<const PdfDocument>& doc,
-                   const PagePart page = FullPage);
+                   const PagePart page = FullPage,
+                   const bool use_worker = false);
 
-  /// Trivial destructor.
-  ~ExternalRenderer() override {};
+  /// Destructor: stop worker.
+  ~ExternalRenderer() override;
 
   /// Render page to a QPixmap.
   /// Try to set %format to pnm. Resolution is given in pixels per point
@@ -63,10 +101,20 @@ class ExternalRenderer : public AbstractRenderer
   const PngPixmap* renderPng(const int page,
                              const qreal resolution) const override;
 
+  /// Render page in pnm format and return the part rect (in points).
+  /// Resolution is given in pixels per point (dpi/72).
+  const QImage renderImage(const int page, const qreal resolution,
+                           const QRectF& rect) const override;
+
+  /// Render page once in pnm format and compress both halves to PNG.
+  /// Resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap*, const PngPixmap*> renderHalvesPng(
+      const int page, const qreal resolution) const override;
+
   /// Check if renderer is valid and can in principle render pages.
   /// Requires that renderingCommand and renderingArguments are not empty
-  /// and that renderingArguments contains %page. This does not check
-  /// whether renderinCommand is a valid command.
+  /// and that renderingArguments contains %page (except for a worker).
+  /// This does not check whether renderinCommand is a valid command.
   bool isValid() const override;
 };
 
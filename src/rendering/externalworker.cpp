@@ -0,0 +1,84 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/rendering/externalworker.h"
+
+#include <QProcess>
+
+#include "src/log.h"
+
+void ExternalWorker::stop()
+{
+  if (process) {
+    process->closeWriteChannel();
+    if (!process->waitForFinished(1000)) process->kill();
+    delete process;
+    process = nullptr;
+  }
+}
+
+bool ExternalWorker::startProcess()
+{
+  if (process && process->state() == QProcess::Running) return true;
+  if (process) {
+    qWarning() << "External rendering process has stopped, restarting"
+               << process->readAllStandardError();
+    delete process;
+  }
+  process = new QProcess(this);
+  // Error messages of the process are shown in the terminal.
+  process->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+  process->start(command, arguments, QProcess::ReadWrite);
+  if (process->waitForStarted(max_process_time_ms)) return true;
+  qWarning() << "Failed to start external rendering process" << command;
+  return false;
+}
+
+void ExternalWorker::stopProcess()
+{
+  // The process may be in an undefined state and is restarted for the next
+  // request.
+  process->kill();
+  process->waitForFinished(1000);
+}
+
+bool ExternalWorker::readBytes(QByteArray &target, const qint64 size)
+{
+  target.reserve(size);
+  while (target.size() < size) {
+    if (process->bytesAvailable() <= 0 &&
+        !process->waitForReadyRead(max_process_time_ms))
+      return false;
+    target += process->read(size - target.size());
+  }
+  return true;
+}
+
+QByteArray ExternalWorker::request(const QByteArray &line)
+{
+  QByteArray data;
+  if (!startProcess()) return data;
+  debug_msg(DebugRendering, "external worker request" << line);
+  process->write(line + '\n');
+
+  // Read the header line containing the length of the image.
+  while (!process->canReadLine())
+    if (!process->waitForReadyRead(max_process_time_ms)) {
+      qWarning() << "External rendering process did not answer";
+      stopProcess();
+      return data;
+    }
+  bool ok;
+  const qint64 size = process->readLine().trimmed().toLongLong(&ok);
+  if (!ok || size < 0) {
+    qWarning() << "Invalid answer of external rendering process";
+    stopProcess();
+    return data;
+  }
+  if (size > 0 && !readBytes(data, size)) {
+    qWarning() << "External rendering process did not send full image";
+    stopProcess();
+    data.clear();
+  }
+  return data;
+}
@@ -0,0 +1,82 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef EXTERNALWORKER_H
+#define EXTERNALWORKER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include "src/config.h"
+
+class QProcess;
+
+/**
+ * @brief Long-lived external rendering process
+ *
+ * The process is started once with the rendering command and the arguments
+ * (in which only %file is replaced). It reads one request per line from
+ * standard input:
+ *
+ *     <page> <resolution> <format> <width> <height>
+ *
+ * Here page is the page index (starting from 0), resolution is given in dpi,
+ * format is "png" or "pnm", and width and height are the expected image
+ * size in pixels. For each request the process writes the length of the
+ * image in bytes as decimal number in one line to standard output, followed
+ * by the image data. Length 0 indicates that rendering failed. The process
+ * should exit when standard input is closed.
+ *
+ * This object lives in an own thread. The process is started when the first
+ * request is sent and restarted if it has crashed.
+ */
+class ExternalWorker : public QObject
+{
+  Q_OBJECT
+
+  /// Maximum time for starting the process or rendering a page.
+  static constexpr int max_process_time_ms = 60000;
+
+  /// Rendering process, created in this object's thread.
+  QProcess *process{nullptr};
+
+  /// Command starting the process.
+  const QString command;
+
+  /// Arguments of the process.
+  const QStringList arguments;
+
+  /// Start process if it is not running. Return true if it is running.
+  bool startProcess();
+
+  /// Kill the process after an error.
+  void stopProcess();
+
+  /// Read exactly size bytes from process. Return false on timeout.
+  bool readBytes(QByteArray &target, const qint64 size);
+
+ public:
+  /// Constructor: only initializes command and arguments.
+  ExternalWorker(const QString &command, const QStringList &arguments,
+                 QObject *parent = nullptr)
+      : QObject(parent), command(command), arguments(arguments)
+  {
+  }
+
+  /// Destructor: stop the process.
+  ~ExternalWorker() { stop(); }
+
+  /// Close stdin of the process and wait for it to finish. The process is
+  /// started again for the next request. Must be called in this object's
+  /// thread.
+  void stop();
+
+  /// Send request line to the process and return the image data.
+  /// Return an empty QByteArray on failure.
+  /// Must be called in this object's thread.
+  QByteArray request(const QByteArray &line);
+};
+
+#endif  // EXTERNALWORKER_H
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: AGPL-3.0-or-later
 
 #include <QByteArray>
+#include <QCryptographicHash>
 #include <QFileInfo>
 #include <QInputDialog>
 #include <QLineEdit>
@@ -20,6 +21,7 @@
 #include <unistd.h>
 #endif
 #include "src/log.h"
+#include "src/media/embeddedmediafile.h"
 #include "src/preferences.h"
 #include "src/rendering/mupdfdocument.h"
 
@@ -102,26 +104,69 @@ MuPdfDocument::MuPdfDocument(const QString &filename)
   if (!loadDocument() && !doc) qFatal("Loading document failed");
 }
 
+/**
+ * Reads an embedded media stream in chunks. The stream is opened on the
+ * first read. Every access to the stream locks the mutex of the document.
+ */
+class MuPdfDocument::MediaStreamReader : public EmbeddedMediaFile::Reader
+{
+  const MuPdfDocument *document;
+  const int obj_id;
+  fz_stream *stream{nullptr};
+
+ public:
+  MediaStreamReader(const MuPdfDocument *document, const int obj_id)
+      : document(document), obj_id(obj_id)
+  {
+  }
+
+  ~MediaStreamReader()
+  {
+    if (!stream) return;
+    document->mutex->lock();
+    fz_drop_stream(document->ctx, stream);
+    document->mutex->unlock();
+  }
+
+  qint64 read(char *data, const qint64 max_size) override
+  {
+    fz_context *ctx = document->ctx;
+    qint64 size = -1;
+    fz_var(size);
+    document->mutex->lock();
+    fz_try(ctx)
+    {
+      if (!stream) stream = pdf_open_stream_number(ctx, document->doc, obj_id);
+      size = fz_read(ctx, stream, reinterpret_cast<unsigned char *>(data),
+                     max_size);
+    }
+    fz_catch(ctx) qWarning() << "Error while reading embedded media"
+                             << fz_caught_message(ctx);
+    document->mutex->unlock();
+    return size;
+  }
+};
+
 MuPdfDocument::~MuPdfDocument()
 {
+  clearEmbeddedMedia();
   mutex->lock();
   for (auto page : std::as_const(pages)) fz_drop_page(ctx, (fz_page *)page);
   pdf_drop_document(ctx, doc);
   fz_drop_context(ctx);
   while (!mutex_list.isEmpty()) delete mutex_list.takeLast();
+  mutex->unlock();
+  delete mutex;
+}
 
-  // Delete embedded media data. TODO: better memory management?
-  char *ptr;
-  for (auto it = embedded_media.begin(); it != embedded_media.end();) {
-    ptr = const_cast<char *>(it.value()->constData());
-    it = embedded_media.erase(it);
-    // memory was allocated by MuPDF using malloc
-    std::free(ptr);
-    // fz_free(ctx, ptr); // leads to a very weird error
-  }
+void MuPdfDocument::clearEmbeddedMedia()
+{
+  // Readers lock the mutex when they are deleted.
+  mutex->lock();
+  const auto files = std::move(embedded_media);
   embedded_media.clear();
   mutex->unlock();
-  delete mutex;
+  for (const auto &file : files) file->detachReader();
 }
 
 bool MuPdfDocument::loadDocument()
@@ -137,6 +182,8 @@ bool MuPdfDocument::loadDocument()
 
   // Check if the file has changed since last (re)load
   if (doc && fileinfo.lastModified() == lastModified) return false;
+  // Object numbers of embedded media may change.
+  clearEmbeddedMedia();
   mutex->lock();
   if (doc) {
     for (auto page : std::as_const(pages)) fz_drop_page(ctx, (fz_page *)page);
@@ -660,16 +707,20 @@ QList<std::shared_ptr<MediaAnnotation>> MuPdfDocument::annotations(
               ctx, pdf_dict_get(ctx, data_obj, PDF_NAME(EF)), PDF_NAME(F));
           if (!stream || !pdf_is_stream(ctx, stream)) break;
 
+          // The stream is only decoded when the media is played.
           const int obj_id = pdf_obj_parent_num(ctx, stream);
           if (!embedded_media.contains(obj_id)) {
-            fz_buffer *buffer = pdf_load_stream(ctx, stream);
-            if (!buffer) break;
-            unsigned char *data;
-            const auto size = fz_buffer_extract(ctx, buffer, &data);
-            // TODO: with this definition, embedded_media[obj_id] does not own
-            // the data!
-            embedded_media[obj_id] = std::make_shared<QByteArray>(
-                QByteArray::fromRawData((const char *)data, size));
+            // Size of the decoded stream: /Length if the stream is not
+            // filtered, otherwise /Params /Size of the embedded file.
+            pdf_obj *size_obj =
+                pdf_dict_get(ctx, stream, PDF_NAME(Filter))
+                    ? pdf_dict_get(ctx,
+                                   pdf_dict_get(ctx, stream, PDF_NAME(Params)),
+                                   PDF_NAME(Size))
+                    : pdf_dict_get(ctx, stream, PDF_NAME(Length));
+            const qint64 size = pdf_to_int(ctx, size_obj);
+            embedded_media[obj_id] = std::make_shared<EmbeddedMediaFile>(
+                new MediaStreamReader(this, obj_id), size > 0 ? size : -1);
           }
 
           MediaAnnotation::Mode mode = MediaAnnotation::Once;
@@ -993,3 +1044,157 @@ qreal MuPdfDocument::duration(const int page) const noexcept
   fz_catch(ctx) duration = -1.;
   return duration;
 }
+
+QByteArray MuPdfDocument::pageContentHash(const int page) const
+{
+#if (FZ_VERSION_MAJOR > 1) || \
+    ((FZ_VERSION_MAJOR == 1) && (FZ_VERSION_MINOR >= 14))
+  if (!pages.value(page) || !ctx) return QByteArray();
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  bool success = true;
+  fz_buffer *buffer = nullptr;
+  fz_buffer *stream = nullptr;
+  fz_output *out = nullptr;
+  fz_var(buffer);
+  fz_var(stream);
+  fz_var(out);
+  mutex->lock();
+  fz_try(ctx)
+  {
+    pdf_obj *const page_obj = pages[page]->obj;
+    buffer = fz_new_buffer(ctx, 1024);
+    out = fz_new_output_with_buffer(ctx, buffer);
+    // Geometry and resources. Shared objects like fonts and images are
+    // printed as references and thus identified by their object number.
+    for (pdf_obj *key : {PDF_NAME(MediaBox), PDF_NAME(CropBox),
+                         PDF_NAME(Rotate), PDF_NAME(Resources)}) {
+      pdf_print_obj(ctx, out, pdf_dict_get_inheritable(ctx, page_obj, key),
+                    1, 1);
+      fz_write_byte(ctx, out, '\n');
+    }
+    pdf_print_obj(ctx, out, pdf_dict_get(ctx, page_obj, PDF_NAME(Group)), 1,
+                  1);
+    fz_write_byte(ctx, out, '\n');
+    // Annotations other than links are drawn and make a page unique.
+    pdf_obj *const annots = pdf_dict_get(ctx, page_obj, PDF_NAME(Annots));
+    for (int i = 0; i < pdf_array_len(ctx, annots); ++i) {
+      pdf_obj *const annot = pdf_array_get(ctx, annots, i);
+      if (!pdf_name_eq(ctx, pdf_dict_get(ctx, annot, PDF_NAME(Subtype)),
+                       PDF_NAME(Link)))
+        pdf_print_obj(ctx, out, annot, 1, 1);
+    }
+    // Flush the output before reading the buffer.
+    fz_close_output(ctx, out);
+    unsigned char *data;
+    size_t size = fz_buffer_storage(ctx, buffer, &data);
+    hash.addData(reinterpret_cast<const char *>(data), size);
+    // Decoded content streams.
+    pdf_obj *const contents = pdf_dict_get(ctx, page_obj, PDF_NAME(Contents));
+    const int number = pdf_is_array(ctx, contents)
+                           ? pdf_array_len(ctx, contents)
+                           : (contents ? 1 : 0);
+    for (int i = 0; i < number; ++i) {
+      stream = pdf_load_stream(ctx, pdf_is_array(ctx, contents)
+                                        ? pdf_array_get(ctx, contents, i)
+                                        : contents);
+      size = fz_buffer_storage(ctx, stream, &data);
+      hash.addData(reinterpret_cast<const char *>(data), size);
+      fz_drop_buffer(ctx, stream);
+      stream = nullptr;
+    }
+  }
+  fz_always(ctx)
+  {
+    fz_drop_output(ctx, out);
+    fz_drop_buffer(ctx, buffer);
+    fz_drop_buffer(ctx, stream);
+    mutex->unlock();
+  }
+  fz_catch(ctx)
+  {
+    debug_msg(DebugRendering,
+              "Failed to hash page content:" << fz_caught_message(ctx));
+    success = false;
+  }
+  return success ? hash.result() : QByteArray();
+#else
+  return QByteArray();
+#endif
+}
+
+bool MuPdfDocument::exportPdf(const QString &filename, const PagePart part,
+                              const QVector<QByteArray> &overlays) const
+{
+#if (FZ_VERSION_MAJOR > 1) || \
+    ((FZ_VERSION_MAJOR == 1) && (FZ_VERSION_MINOR >= 14))
+  if (!ctx || !doc) return false;
+  const QByteArray path = filename.toUtf8();
+  bool success = true;
+  fz_document_writer *writer = nullptr;
+  fz_stream *stream = nullptr;
+  fz_document *overlay_doc = nullptr;
+  fz_page *overlay_page = nullptr;
+  fz_var(writer);
+  fz_var(stream);
+  fz_var(overlay_doc);
+  fz_var(overlay_page);
+  mutex->lock();
+  fz_try(ctx)
+  {
+    writer = fz_new_document_writer(ctx, path.constData(), "pdf", "");
+    for (int page = 0; page < number_of_pages; ++page) {
+      if (!pages[page]) continue;
+      const fz_rect bbox = fz_bound_page(ctx, (fz_page *)pages[page]);
+      float width = bbox.x1 - bbox.x0, shift = 0;
+      if (part == LeftHalf || part == RightHalf) width /= 2;
+      if (part == RightHalf) shift = width;
+      const fz_rect mediabox = {0, 0, width, bbox.y1 - bbox.y0};
+      fz_device *dev = fz_begin_page(ctx, writer, mediabox);
+      fz_run_page(ctx, (fz_page *)pages[page], dev,
+                  fz_translate(-bbox.x0 - shift, -bbox.y0), nullptr);
+      if (page < overlays.size() && !overlays[page].isEmpty()) {
+        // Drawings are given as SVG image of the size of the page (part).
+        const QByteArray &svg = overlays[page];
+        stream = fz_open_memory(
+            ctx, reinterpret_cast<const unsigned char *>(svg.constData()),
+            svg.size());
+        overlay_doc = fz_open_document_with_stream(ctx, "svg", stream);
+        overlay_page = fz_load_page(ctx, overlay_doc, 0);
+        const fz_rect svg_box = fz_bound_page(ctx, overlay_page);
+        if (svg_box.x1 > svg_box.x0 && svg_box.y1 > svg_box.y0)
+          fz_run_page(
+              ctx, overlay_page, dev,
+              fz_concat(fz_translate(-svg_box.x0, -svg_box.y0),
+                        fz_scale(mediabox.x1 / (svg_box.x1 - svg_box.x0),
+                                 mediabox.y1 / (svg_box.y1 - svg_box.y0))),
+              nullptr);
+        fz_drop_page(ctx, overlay_page);
+        overlay_page = nullptr;
+        fz_drop_document(ctx, overlay_doc);
+        overlay_doc = nullptr;
+        fz_drop_stream(ctx, stream);
+        stream = nullptr;
+      }
+      fz_end_page(ctx, writer);
+    }
+    fz_close_document_writer(ctx, writer);
+  }
+  fz_always(ctx)
+  {
+    fz_drop_page(ctx, overlay_page);
+    fz_drop_document(ctx, overlay_doc);
+    fz_drop_stream(ctx, stream);
+    fz_drop_document_writer(ctx, writer);
+    mutex->unlock();
+  }
+  fz_catch(ctx)
+  {
+    qWarning() << "MuPDF failed to write PDF:" << fz_caught_message(ctx);
+    success = false;
+  }
+  return success;
+#else
+  qWarning() << "Writing PDF files requires MuPDF 1.14 or newer";
+  return false;
+#endif
+}
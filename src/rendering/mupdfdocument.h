@@ -4,6 +4,7 @@
 #ifndef MUPDFDOCUMENT_H
 #define MUPDFDOCUMENT_H
 
+#include <QByteArray>
 #include <QCoreApplication>
 #include <QList>
 #include <QMap>
@@ -22,6 +23,7 @@ extern "C" {
 #include "src/enumerates.h"
 #include "src/rendering/pdfdocument.h"
 
+class EmbeddedMediaFile;
 class QMutex;
 class QSizeF;
 class QPointF;
@@ -75,8 +77,15 @@ class MuPdfDocument : public PdfDocument
   /// Total number of pages in document.
   int number_of_pages;
 
-  /// Map of PDF object numbers to embedded media data streams
-  QMap<int, std::shared_ptr<QByteArray>> embedded_media;
+  /// Reader for embedded media streams, see EmbeddedMediaFile.
+  class MediaStreamReader;
+
+  /// Map of PDF object numbers to embedded media files
+  QMap<int, std::shared_ptr<EmbeddedMediaFile>> embedded_media;
+
+  /// Detach readers of embedded media files and clear embedded_media.
+  /// mutex must not be locked.
+  void clearEmbeddedMedia();
 
   /// populate pageLabels. Must be called after loadOutline.
   void loadPageLabels();
@@ -143,7 +152,7 @@ class MuPdfDocument : public PdfDocument
   virtual const PdfLink *linkAt(const int page,
                                 const QPointF &position) const override;
 
-  /// List all video annotations on given page.
+  /// List all video annotations on given page. This is thread safe.
   virtual QList<std::shared_ptr<MediaAnnotation>> annotations(
       const int page) override;
 
@@ -158,6 +167,21 @@ class MuPdfDocument : public PdfDocument
 
   /// Return true if not all pages in the PDF have the same size.
   virtual bool flexiblePageSizes() noexcept override;
+
+  /// Hash of the content streams, resources, geometry and visible
+  /// annotations of page. This is thread safe.
+  QByteArray pageContentHash(const int page) const override;
+
+  /**
+   * Write all pages to a new PDF file, keeping the PDF content.
+   * @param filename output file
+   * @param part page part which is written, half pages are cropped
+   * @param overlays SVG images (one per page, may be empty) which are drawn
+   *   on top of the pages, scaled to the size of the page (part)
+   * @return true on success
+   */
+  bool exportPdf(const QString &filename, const PagePart part,
+                 const QVector<QByteArray> &overlays) const;
 };
 
 /// Lock mutex <lock> in vector <user> of mutexes.
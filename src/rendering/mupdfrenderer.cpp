@@ -4,12 +4,16 @@
 #include "src/rendering/mupdfrenderer.h"
 
 #include <QByteArray>
+#include <QImage>
 #include <QPixmap>
+#include <QRect>
+#include <algorithm>
 
 #include "src/config.h"
 #include "src/log.h"
 #include "src/rendering/mupdfdocument.h"
 #include "src/rendering/pngpixmap.h"
+#include "src/tracer.h"
 
 #ifndef FZ_VERSION_MAJOR
 #define FZ_VERSION_MAJOR 0
@@ -18,23 +22,14 @@
 #define FZ_VERSION_MINOR 0
 #endif
 
-fz_pixmap *MuPdfRenderer::renderFzPixmap(const int page, const qreal resolution,
-                                         fz_context *&ctx) const
+namespace
 {
-  if (resolution < 1e-9 || resolution > 1e9 || page < 0) return nullptr;
-
-  // Let the main thread prepare everything.
-  fz_rect bbox;
-  fz_display_list *list = nullptr;
-  doc->prepareRendering(&ctx, &bbox, &list, page, resolution);
-
-  // If page is not valid (too large), the nullptr will be unchanged.
-  if (ctx == nullptr || list == nullptr) return nullptr;
-
-  // Adapt bbox to page part.
-  switch (page_part) {
+/// Restrict bbox to the given page part.
+fz_rect partRect(fz_rect bbox, const PagePart part)
+{
+  switch (part) {
     case LeftHalf:
-      bbox.x1 /= 2;
+      bbox.x1 = (bbox.x0 + bbox.x1) / 2;
       break;
     case RightHalf:
       bbox.x0 = (bbox.x0 + bbox.x1) / 2;
@@ -42,10 +37,13 @@ fz_pixmap *MuPdfRenderer::renderFzPixmap(const int page, const qreal resolution,
     default:
       break;
   }
+  return bbox;
+}
+}  // namespace
 
-  // Create a local clone of the main thread's context.
-  ctx = fz_clone_context(ctx);
-
+fz_pixmap *MuPdfRenderer::rasterize(fz_context *ctx, fz_display_list *list,
+                                    const fz_rect &bbox) const
+{
   // Create pixmap and render page to it.
   fz_device *dev = nullptr;
   fz_pixmap *pixmap = nullptr;
@@ -69,16 +67,35 @@ fz_pixmap *MuPdfRenderer::renderFzPixmap(const int page, const qreal resolution,
     fz_run_display_list(ctx, list, dev, fz_identity, bbox, nullptr);
     fz_close_device(ctx, dev);
   }
-  fz_always(ctx)
-  {
-    fz_drop_device(ctx, dev);
-    fz_drop_display_list(ctx, list);
-  }
+  fz_always(ctx) fz_drop_device(ctx, dev);
   fz_catch(ctx)
   {
     qWarning() << "Fitz failed to create or render pixmap:"
                << fz_caught_message(ctx);
     fz_drop_pixmap(ctx, pixmap);
+    return nullptr;
+  }
+  return pixmap;
+}
+
+fz_pixmap *MuPdfRenderer::renderFzPixmap(const int page, const qreal resolution,
+                                         fz_context *&ctx) const
+{
+  if (resolution < 1e-9 || resolution > 1e9 || page < 0) return nullptr;
+
+  // Let the main thread prepare everything.
+  fz_rect bbox;
+  fz_display_list *list = nullptr;
+  doc->prepareRendering(&ctx, &bbox, &list, page, resolution);
+
+  // If page is not valid (too large), the nullptr will be unchanged.
+  if (ctx == nullptr || list == nullptr) return nullptr;
+
+  // Create a local clone of the main thread's context.
+  ctx = fz_clone_context(ctx);
+  fz_pixmap *pixmap = rasterize(ctx, list, partRect(bbox, page_part));
+  fz_drop_display_list(ctx, list);
+  if (!pixmap) {
     fz_drop_context(ctx);
     return nullptr;
   }
@@ -140,16 +157,13 @@ const QPixmap MuPdfRenderer::renderPixmap(const int page,
   return qpixmap;
 }
 
-const PngPixmap *MuPdfRenderer::renderPng(const int page,
+const PngPixmap *MuPdfRenderer::encodePng(fz_context *ctx, fz_pixmap *pixmap,
+                                          const int page,
                                           const qreal resolution) const
 {
-  if (!doc || !doc->checkResolution(page, resolution)) return nullptr;
-  fz_context *ctx = nullptr;
-  fz_pixmap *pixmap = renderFzPixmap(page, resolution, ctx);
-  if (!pixmap || !ctx) return nullptr;
-
   // Save the pixmap to buffer in PNG format.
   fz_buffer *buffer = nullptr;
+  fz_var(buffer);
   fz_try(ctx)
       // Here valgrind complained about "Use of uninitialised value of size 8"
       buffer = fz_new_buffer_from_pixmap_as_png(ctx, pixmap,
@@ -159,7 +173,6 @@ const PngPixmap *MuPdfRenderer::renderPng(const int page,
   {
     qWarning() << "Fitz failed to allocate buffer:" << fz_caught_message(ctx);
     fz_drop_buffer(ctx, buffer);
-    fz_drop_context(ctx);
     return nullptr;
   }
 
@@ -180,6 +193,95 @@ const PngPixmap *MuPdfRenderer::renderPng(const int page,
   }
 #endif
   fz_drop_buffer(ctx, buffer);
-  fz_drop_context(ctx);
   return new PngPixmap(data, page, resolution);
 }
+
+const PngPixmap *MuPdfRenderer::renderPng(const int page,
+                                          const qreal resolution) const
+{
+  if (!doc || !doc->checkResolution(page, resolution)) return nullptr;
+  fz_context *ctx = nullptr;
+  qint64 trace_ns = Tracer::enabled() ? Tracer::now() : -1;
+  fz_pixmap *pixmap = renderFzPixmap(page, resolution, ctx);
+  Tracer::complete("render", "render", trace_ns, page);
+  if (!pixmap || !ctx) return nullptr;
+
+  // TraceSpan is not used here because fz_try uses setjmp.
+  trace_ns = Tracer::enabled() ? Tracer::now() : -1;
+  const PngPixmap *png = encodePng(ctx, pixmap, page, resolution);
+  fz_drop_context(ctx);
+  Tracer::complete("encode", "render", trace_ns, page);
+  return png;
+}
+
+const QImage MuPdfRenderer::renderImage(const int page, const qreal resolution,
+                                        const QRectF &rect) const
+{
+  QImage image;
+  if (!doc || !doc->checkResolution(page, resolution) || resolution < 1e-9 ||
+      resolution > 1e9 || page < 0)
+    return image;
+
+  // TraceSpan is not used here because fz_try uses setjmp.
+  const qint64 trace_ns = Tracer::enabled() ? Tracer::now() : -1;
+  fz_context *ctx = nullptr;
+  fz_rect bbox;
+  fz_display_list *list = nullptr;
+  doc->prepareRendering(&ctx, &bbox, &list, page, resolution);
+  if (ctx == nullptr || list == nullptr) return image;
+
+  // Only the clip rectangle (in pixels), restricted to the page, is
+  // rasterised. fz_intersect_rect is not used because its signature
+  // changed in MuPDF 1.13.
+  const QRect pixels = pixelRect(rect, resolution);
+  fz_rect clip;
+  clip.x0 = std::max<float>(bbox.x0, bbox.x0 + pixels.left());
+  clip.y0 = std::max<float>(bbox.y0, bbox.y0 + pixels.top());
+  clip.x1 = std::min<float>(bbox.x1, bbox.x0 + pixels.left() + pixels.width());
+  clip.y1 = std::min<float>(bbox.y1, bbox.y0 + pixels.top() + pixels.height());
+  ctx = fz_clone_context(ctx);
+  fz_pixmap *pixmap = clip.x0 < clip.x1 && clip.y0 < clip.y1
+                          ? rasterize(ctx, list, clip)
+                          : nullptr;
+  fz_drop_display_list(ctx, list);
+  if (pixmap) {
+    // The pixmap is in RGB colorspace without alpha channel.
+    image = QImage(pixmap->samples, pixmap->w, pixmap->h, pixmap->stride,
+                   QImage::Format_RGB888)
+                .copy();
+    fz_drop_pixmap(ctx, pixmap);
+  }
+  fz_drop_context(ctx);
+  Tracer::complete("render", "render", trace_ns, page);
+  return image;
+}
+
+QPair<const PngPixmap *, const PngPixmap *> MuPdfRenderer::renderHalvesPng(
+    const int page, const qreal resolution) const
+{
+  QPair<const PngPixmap *, const PngPixmap *> halves{nullptr, nullptr};
+  if (!doc || !doc->checkResolution(page, resolution) || resolution < 1e-9 ||
+      resolution > 1e9 || page < 0)
+    return halves;
+
+  // The display list is prepared only once and then rendered separately
+  // for the bbox of each half.
+  qint64 trace_ns = Tracer::enabled() ? Tracer::now() : -1;
+  fz_context *ctx = nullptr;
+  fz_rect bbox;
+  fz_display_list *list = nullptr;
+  doc->prepareRendering(&ctx, &bbox, &list, page, resolution);
+  if (ctx == nullptr || list == nullptr) return halves;
+  ctx = fz_clone_context(ctx);
+  fz_pixmap *left = rasterize(ctx, list, partRect(bbox, LeftHalf));
+  fz_pixmap *right = rasterize(ctx, list, partRect(bbox, RightHalf));
+  fz_drop_display_list(ctx, list);
+  Tracer::complete("render", "render", trace_ns, page);
+
+  trace_ns = Tracer::enabled() ? Tracer::now() : -1;
+  if (left) halves.first = encodePng(ctx, left, page, resolution);
+  if (right) halves.second = encodePng(ctx, right, page, resolution);
+  fz_drop_context(ctx);
+  Tracer::complete("encode", "render", trace_ns, page);
+  return halves;
+}
@@ -4,6 +4,9 @@
 #ifndef MUPDFRENDERER_H
 #define MUPDFRENDERER_H
 
+#include <QImage>
+#include <QPair>
+#include <QRectF>
 #include <memory>
 
 #include "src/config.h"
@@ -35,6 +38,16 @@ class MuPdfRenderer : public AbstractRenderer
   fz_pixmap *renderFzPixmap(const int page, const qreal resolution,
                             fz_context *&ctx) const;
 
+  /// Render the part of list inside bbox (in pixels) to a new pixmap.
+  /// ctx must be a local clone of the document's context.
+  /// Return nullptr on failure.
+  fz_pixmap *rasterize(fz_context *ctx, fz_display_list *list,
+                       const fz_rect &bbox) const;
+
+  /// Compress pixmap to PNG and drop pixmap.
+  const PngPixmap *encodePng(fz_context *ctx, fz_pixmap *pixmap,
+                             const int page, const qreal resolution) const;
+
  public:
   /// Constructor: only initializes doc and page_part.
   MuPdfRenderer(const std::shared_ptr<const PdfDocument> &document,
@@ -59,6 +72,17 @@ class MuPdfRenderer : public AbstractRenderer
   const PngPixmap *renderPng(const int page,
                              const qreal resolution) const override;
 
+  /// Render only the part rect (in points) of a page to a QImage using the
+  /// rect as bbox of the display list.
+  /// Resolution is given in pixels per point (dpi/72).
+  const QImage renderImage(const int page, const qreal resolution,
+                           const QRectF &rect) const override;
+
+  /// Render both halves of a page from a single display list, each only
+  /// inside its own bbox. Resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap *, const PngPixmap *> renderHalvesPng(
+      const int page, const qreal resolution) const override;
+
   /// In the current implementation this is always valid.
   bool isValid() const override { return doc && doc->isValid(); }
 };
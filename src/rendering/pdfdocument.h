@@ -4,6 +4,7 @@
 #ifndef PDFDOCUMENT_H
 #define PDFDOCUMENT_H
 
+#include <QByteArray>
 #include <QDateTime>
 #include <QRectF>
 #include <QString>
@@ -320,7 +321,8 @@ class PdfDocument
     return nullptr;
   }
 
-  /// List all video annotations on given page.
+  /// List all video annotations on given page. This is called from a
+  /// separate thread (see MediaDiscovery) and must be thread safe.
   virtual QList<std::shared_ptr<MediaAnnotation>> annotations(const int page)
   {
     return {};
@@ -338,6 +340,12 @@ class PdfDocument
   /// Return true if not all pages in the PDF have the same size.
   virtual bool flexiblePageSizes() noexcept = 0;
 
+  /// Hash of everything that determines how the given page looks when
+  /// rendered. Pages with equal non-empty hashes look identical. The
+  /// default implementation returns an empty QByteArray (unknown).
+  /// This must be thread safe.
+  virtual QByteArray pageContentHash(const int page) const { return {}; }
+
   /// Duration of given page in secons. Default value is -1 is interpreted as
   /// infinity.
   virtual qreal duration(const int page) const noexcept { return -1.; }
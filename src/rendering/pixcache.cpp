@@ -3,6 +3,8 @@
 
 #include "src/rendering/pixcache.h"
 
+#include <QCryptographicHash>
+#include <QImage>
 #include <QPixmap>
 #include <QThread>
 #include <QTimerEvent>
@@ -18,11 +20,15 @@
 #include "src/preferences.h"
 #include "src/rendering/pixcachethread.h"
 #include "src/rendering/pngpixmap.h"
+#include "src/rendering/sharedrendercache.h"
+#include "src/tracer.h"
+
+QMutex PixCache::partner_mutex;
 
 PixCache::PixCache(const std::shared_ptr<PdfDocument> &doc,
                    const int thread_number, const PagePart page_part,
                    const CacheMode mode, QObject *parent) noexcept
-    : QObject(parent), priority({page_part}), pdfDoc(doc), cacheMode(mode)
+    : QObject(parent), cacheMode(mode), page_part(page_part), pdfDoc(doc)
 {
   debug_verbose(DebugFunctionCalls, "CREATING PixCache" << this);
   threads =
@@ -38,27 +44,27 @@ void PixCache::init()
     return;
   }
   mutex.lock();
-  const PagePart page_part =
-      static_cast<PagePart>(priority.isEmpty() ? 0 : priority.first());
-  priority.clear();
   // Create the renderer without any checks.
 #ifdef USE_EXTERNAL_RENDERER
   if (preferences()->renderer == Renderer::ExternalRenderer)
     renderer = new ExternalRenderer(preferences()->rendering_command,
                                     preferences()->rendering_arguments, pdfDoc,
-                                    page_part);
+                                    page_part, preferences()->rendering_worker);
   else
 #endif
     renderer = createRenderer(pdfDoc, page_part);
 
   // Check if the renderer is valid
   if (!renderer->isValid()) qCritical() << tr("Creating renderer failed");
+  updateSharedCache();
 
   // Create threads.
   for (auto &thread : threads) {
-    thread = new PixCacheThread(pdfDoc, renderer->pagePart(), this);
+    thread = new PixCacheThread(pdfDoc, page_part, this);
     connect(thread, &PixCacheThread::sendData, this, &PixCache::receiveData,
             Qt::QueuedConnection);
+    connect(thread, &PixCacheThread::sendPartnerData, this,
+            &PixCache::sendPartnerData, Qt::QueuedConnection);
     connect(this, &PixCache::setPixCacheThreadPage, thread,
             &PixCacheThread::setNextPage, Qt::QueuedConnection);
   }
@@ -68,6 +74,12 @@ void PixCache::init()
 PixCache::~PixCache()
 {
   debug_verbose(DebugFunctionCalls, "DELETING PixCache" << this);
+  // The partner must not reserve pages in this cache anymore. This waits
+  // until the partner has finished a call to reservePage.
+  partner_mutex.lock();
+  if (partner) partner->partner = nullptr;
+  partner = nullptr;
+  partner_mutex.unlock();
   delete renderer;
   // TODO: correctly clean up threads!
   for (const auto &thread : std::as_const(threads)) thread->quit();
@@ -75,6 +87,8 @@ PixCache::~PixCache()
     thread->wait(10000);
     delete thread;
   }
+  delete shared_cache;
+  shared_cache = nullptr;
   mutex.lock();
   clear();
   mutex.unlock();
@@ -84,6 +98,11 @@ void PixCache::clear()
 {
   debug_verbose(DebugFunctionCalls, this);
   cache.clear();
+  digests.clear();
+  shared_pages.clear();
+  content_hashes.clear();
+  // The document may have been reloaded.
+  if (shared_cache) updateSharedCache();
   usedMemory = 0;
   region.first = preferences()->page;
   region.second = region.first;
@@ -103,16 +122,25 @@ const QPixmap PixCache::pixmap(const int page, qreal resolution)
     if (it != cache.cend() && it->second &&
         abs(it->second->getResolution() - resolution) <
             max_resolution_deviation) {
-      QPixmap pix = it->second->pixmap();
-      if (pix.isNull()) {
-        usedMemory -= it->second->size();
-        cache.erase(it);
+      const QPixmap pix = decode(*it->second);
+      if (!pix.isNull()) {
+        mutex.unlock();
+        Tracer::instant("cache hit", "cache", page);
+        return pix;
       }
-      mutex.unlock();
-      return pix;
+      // Decoding failed, render the page instead.
+      release(*it->second);
+      cache.erase(it);
     }
     mutex.unlock();
   }
+  Tracer::instant("cache miss", "cache", page);
+
+  // Another process may have rendered the page.
+  {
+    QPixmap pix;
+    if (sharedPage(page, resolution, &pix)) return pix;
+  }
 
   // Check if the renderer is valid
   if (renderer == nullptr || !renderer->isValid()) {
@@ -121,6 +149,7 @@ const QPixmap PixCache::pixmap(const int page, qreal resolution)
   }
 
   debug_msg(DebugCache, "Rendering in main thread");
+  const TraceSpan span("render sync", "cache", page);
   const QPixmap pix = renderer->renderPixmap(page, resolution);
 
   if (pix.isNull()) {
@@ -135,11 +164,9 @@ const QPixmap PixCache::pixmap(const int page, qreal resolution)
   if (png == nullptr) {
     qWarning() << "Converting pixmap to PNG failed";
   } else {
+    publish(*png);
     mutex.lock();
-    usedMemory += png->size();
-    const auto [it, inserted] = cache.try_emplace(page, nullptr);
-    if (it->second) usedMemory -= it->second->size();
-    it->second.swap(png);
+    store(png);
     mutex.unlock();
   }
   return pix;
@@ -291,9 +318,18 @@ int PixCache::limitCacheSize() noexcept
       remove.swap(it->second);
       last = std::prev(cache.erase(it))->first;
     } else {
-      const auto it = cache.begin();
+      // A keyframe and its difference images are removed together. Skip
+      // keyframes which are still needed for pages at or after the current
+      // page, but never remove these pages from the front.
+      auto it = cache.begin();
+      while (it->first < pref_page && isNeededKeyframe(it->first, pref_page))
+        ++it;
+      if (it->first >= pref_page && it != cache.begin())
+        it = std::prev(cache.end());
       remove.swap(it->second);
-      first = cache.erase(it)->first;
+      cache.erase(it);
+      first = cache.cbegin()->first;
+      last = cache.crbegin()->first;
     }
     // Check if remove is nullptr (which means that a thread is just rendering
     // it).
@@ -302,8 +338,18 @@ int PixCache::limitCacheSize() noexcept
                               << usedMemory << allowed_slides << cached_slides
                               << remove->getPage());
     // Delete removed cache page and update memory size.
-    usedMemory -= remove->size();
+    release(*remove);
     --cached_slides;
+    // Difference images cannot be shown without their keyframe.
+    if (!remove->isDiff()) {
+      cached_slides -= releaseDiffs(remove->getPage());
+      if (cache.empty()) {
+        allowed_slides = INT_MAX >> 1;
+        break;
+      }
+      first = cache.cbegin()->first;
+      last = cache.crbegin()->first;
+    }
 
     // Update allowed_slides
     if (usedMemory > 0 && cached_slides > 0) {
@@ -377,9 +423,23 @@ void PixCache::startRendering()
   if (allowed_pages <= 0) return;
   for (auto thread = threads.cbegin(); thread != threads.cend(); ++thread) {
     if (allowed_pages > 0 && *thread && !(*thread)->isRunning()) {
-      const int page = renderNext();
-      if (page < 0 || page >= pdfDoc->numberOfPages()) return;
-      emit setPixCacheThreadPage(*thread, page, getResolution(page));
+      int page;
+      qreal resolution;
+      // Pages identical to a cached page are copied instead of rendered.
+      while (true) {
+        page = renderNext();
+        if (page < 0 || page >= pdfDoc->numberOfPages()) return;
+        resolution = getResolution(page);
+        if (!reusePage(page, resolution)) break;
+        if (--allowed_pages <= 0) return;
+      }
+      partner_mutex.lock();
+      const bool shared = partner && partner->reservePage(page, resolution);
+      partner_mutex.unlock();
+      QByteArray key_png;
+      const int key_page = shared ? -1 : keyframe(page, resolution, key_png);
+      emit setPixCacheThreadPage(*thread, page, resolution, shared, key_page,
+                                 key_png);
       --allowed_pages;
     }
   }
@@ -395,7 +455,13 @@ void PixCache::receiveData(const PngPixmap *data)
   }
 
   // If a renderer failed, it should already have sent an error message.
-  if (data == nullptr || data->isNull()) {
+  if (data == nullptr) return;
+  if (data->isNull()) {
+    // Release the page if it was reserved for the partner.
+    mutex.lock();
+    const auto it = cache.find(data->getPage());
+    if (it != cache.end() && it->second == nullptr) cache.erase(it);
+    mutex.unlock();
     delete data;
     return;
   }
@@ -412,16 +478,20 @@ void PixCache::receiveData(const PngPixmap *data)
         cache.erase(it);
       } else if (abs(it->second->getResolution() - good_resolution) >
                  max_resolution_deviation) {
-        usedMemory -= it->second->size();
+        release(*it->second);
         cache.erase(it);
       }
     }
     delete data;
+  } else if (!hasKeyframe(*data)) {
+    // The keyframe was removed from cache while the page was rendered.
+    const auto it = cache.find(data->getPage());
+    if (it != cache.end() && it->second == nullptr) cache.erase(it);
+    delete data;
   } else {
-    usedMemory += data->size();
-    const auto [it, inserted] = cache.try_emplace(data->getPage(), nullptr);
-    if (it->second) usedMemory -= it->second->size();
-    it->second.reset(data);
+    publish(*data);
+    std::unique_ptr<const PngPixmap> png(data);
+    store(png);
   }
   mutex.unlock();
 
@@ -429,25 +499,26 @@ void PixCache::receiveData(const PngPixmap *data)
   startTimer(0);
 }
 
-qreal PixCache::getResolution(const int page) const
+qreal PixCache::getResolution(const int page, const QSizeF &size,
+                              const CacheMode mode) const
 {
-  debug_verbose(DebugFunctionCalls, page << this);
+  debug_verbose(DebugFunctionCalls, page << size << mode << this);
   // Get page size in points
   QSizeF pageSize = pdfDoc->pageSize(page);
   if (pageSize.isEmpty()) return -1.;
-  if (renderer->pagePart() != FullPage) pageSize.rwidth() /= 2;
-  switch (cacheMode) {
+  if (page_part != FullPage) pageSize.rwidth() /= 2;
+  switch (mode) {
     case FitPage:
-      if (pageSize.width() * frame.height() > pageSize.height() * frame.width())
+      if (pageSize.width() * size.height() > pageSize.height() * size.width())
         // page is too wide, determine resolution by x direction
-        return frame.width() / pageSize.width();
+        return size.width() / pageSize.width();
       else
         // page is too high, determine resolution by y direction
-        return frame.height() / pageSize.height();
+        return size.height() / pageSize.height();
     case FitWidth:
-      return frame.width() / pageSize.width();
+      return size.width() / pageSize.width();
     case FitHeight:
-      return frame.height() / pageSize.height();
+      return size.height() / pageSize.height();
     default:
       return -1.;
   }
@@ -490,20 +561,32 @@ void PixCache::requestPage(const int page, const qreal resolution,
     if (it != cache.cend() && it->second &&
         abs(it->second->getResolution() - resolution) <
             max_resolution_deviation) {
-      QPixmap pix = it->second->pixmap();
-      if (pix.isNull()) {
-        usedMemory -= it->second->size();
-        cache.erase(it);
+      const QPixmap pix = decode(*it->second);
+      if (!pix.isNull()) {
+        mutex.unlock();
+        Tracer::instant("cache hit", "cache", page);
+        emit pageReady(pix, page);
+        return;
       }
-      mutex.unlock();
-      emit pageReady(pix, page);
-      return;
+      // Decoding failed, render the page instead.
+      release(*it->second);
+      cache.erase(it);
     }
     mutex.unlock();
   }
+  Tracer::instant("cache miss", "cache", page);
   // Check if page number is valid.
   if (page < 0 || page >= pdfDoc->numberOfPages()) return;
 
+  // Another process may have rendered the page.
+  {
+    QPixmap pix;
+    if (sharedPage(page, resolution, &pix)) {
+      emit pageReady(pix, page);
+      return;
+    }
+  }
+
   // Render new page.
   // Check if the renderer is valid
   if (renderer == nullptr || !renderer->isValid()) {
@@ -512,7 +595,11 @@ void PixCache::requestPage(const int page, const qreal resolution,
   }
 
   debug_msg(DebugCache, "Rendering page in PixCache thread" << this);
-  const QPixmap pix = renderer->renderPixmap(page, resolution);
+  QPixmap pix;
+  {
+    const TraceSpan span("render sync", "cache", page);
+    pix = renderer->renderPixmap(page, resolution);
+  }
 
   if (pix.isNull()) {
     qCritical() << tr("Rendering page failed for (page, resolution) =") << page
@@ -531,11 +618,9 @@ void PixCache::requestPage(const int page, const qreal resolution,
     if (png == nullptr)
       qWarning() << "Converting pixmap to PNG failed";
     else {
+      publish(*png);
       mutex.lock();
-      usedMemory += png->size();
-      const auto [it, inserted] = cache.try_emplace(page, nullptr);
-      if (it->second) usedMemory -= it->second->size();
-      it->second.swap(png);
+      store(png);
       debug_verbose(DebugCache, "writing page to cache" << page << usedMemory);
       mutex.unlock();
     }
@@ -545,8 +630,260 @@ void PixCache::requestPage(const int page, const qreal resolution,
   if (thread() == QThread::currentThread()) startTimer(0);
 }
 
+bool PixCache::hasPartner() const
+{
+  partner_mutex.lock();
+  const bool has_partner = partner != nullptr;
+  partner_mutex.unlock();
+  return has_partner;
+}
+
+void PixCache::setPartner(PixCache *other)
+{
+  partner_mutex.lock();
+  partner = other;
+  partner_mutex.unlock();
+}
+
+bool PixCache::reservePage(const int page, const qreal resolution)
+{
+  // This is called from the thread of the partner. frame and cacheMode are
+  // only changed while mutex is locked.
+  mutex.lock();
+  const QSizeF size = frame;
+  const CacheMode mode = cacheMode;
+  const bool reserve =
+      cache.find(page) == cache.end() &&
+      abs(getResolution(page, size, mode) - resolution) <
+          max_resolution_deviation;
+  // nullptr marks a page which is being rendered.
+  if (reserve) cache.emplace(page, nullptr);
+  mutex.unlock();
+  return reserve;
+}
+
+int PixCache::cachedPages() const
+{
+  int number = 0;
+  mutex.lock();
+  for (const auto &[page, png] : cache)
+    if (png) ++number;
+  mutex.unlock();
+  return number;
+}
+
+QByteArray PixCache::cachedPage(const PdfDocument *document,
+                                const PagePart part, const int page,
+                                const qreal min_resolution,
+                                qreal &resolution) const
+{
+  QByteArray data;
+  if (document != pdfDoc.get()) return data;
+  mutex.lock();
+  if (page_part == part) {
+    const auto it = cache.find(page);
+    if (it != cache.cend() && it->second && !it->second->isNull() &&
+        !it->second->isDiff() &&
+        it->second->getResolution() >= min_resolution) {
+      data = it->second->bytes();
+      resolution = it->second->getResolution();
+    }
+  }
+  mutex.unlock();
+  return data;
+}
+
+QPixmap PixCache::decode(const PngPixmap &png) const
+{
+  if (!png.isDiff()) return png.pixmap();
+  if (!hasKeyframe(png)) return QPixmap();
+  QImage image = cache.at(png.getKeyframe())->image();
+  if (!png.applyPatches(image)) return QPixmap();
+  return QPixmap::fromImage(image);
+}
+
+bool PixCache::hasKeyframe(const PngPixmap &png) const
+{
+  if (!png.isDiff()) return true;
+  const auto it = cache.find(png.getKeyframe());
+  return it != cache.cend() && it->second && !it->second->isDiff() &&
+         abs(it->second->getResolution() - png.getResolution()) <
+             max_resolution_deviation;
+}
+
+bool PixCache::isNeededKeyframe(const int page, const int current) const
+{
+  const auto it = cache.find(page);
+  if (it == cache.cend() || !it->second || it->second->isDiff()) return false;
+  for (auto diff = cache.lower_bound(std::max(page + 1, current));
+       diff != cache.cend(); ++diff)
+    if (diff->second && diff->second->isDiff() &&
+        diff->second->getKeyframe() == page)
+      return true;
+  return false;
+}
+
+int PixCache::releaseDiffs(const int page)
+{
+  int removed = 0;
+  // Difference images always follow their keyframe.
+  for (auto it = cache.upper_bound(page); it != cache.end();) {
+    if (it->second && it->second->isDiff() &&
+        it->second->getKeyframe() == page) {
+      debug_verbose(DebugCache, "removing difference image" << it->first);
+      release(*it->second);
+      it = cache.erase(it);
+      ++removed;
+    } else
+      ++it;
+  }
+  return removed;
+}
+
+int PixCache::keyframe(const int page, const qreal resolution,
+                       QByteArray &png) const
+{
+  const int first = pdfDoc->overlaysShifted(page, ShiftOverlays::FirstOverlay);
+  if (first < 0 || first >= page) return -1;
+  mutex.lock();
+  const auto it = cache.find(first);
+  if (it != cache.cend() && it->second && !it->second->isNull() &&
+      !it->second->isDiff() &&
+      abs(it->second->getResolution() - resolution) <
+          max_resolution_deviation)
+    png = it->second->bytes();
+  mutex.unlock();
+  return png.isEmpty() ? -1 : first;
+}
+
 void PixCache::getPixmap(const int page, QPixmap &target, qreal resolution)
 {
   debug_verbose(DebugFunctionCalls, page << resolution << this);
   target = pixmap(page, resolution);
 }
+
+void PixCache::store(std::unique_ptr<const PngPixmap> &png)
+{
+  const int page = png->getPage();
+  const auto [it, inserted] = cache.try_emplace(page, nullptr);
+  if (it->second) release(*it->second);
+  QByteArray digest;
+  if (!png->isNull() && !png->isDiff())
+    digest = QCryptographicHash::hash(png->bytes(), QCryptographicHash::Sha1);
+  const auto other =
+      digest.isEmpty() ? shared_pages.cend() : shared_pages.constFind(digest);
+  if (other == shared_pages.cend()) {
+    usedMemory += png->size();
+  } else {
+    const auto same = cache.find(other.value());
+    if (same != cache.end() && same->second &&
+        same->second->bytes() == png->bytes()) {
+      debug_verbose(DebugCache, "sharing PNG data" << page << other.value());
+      png.reset(new PngPixmap(new QByteArray(same->second->bytes()), page,
+                              png->getResolution()));
+    } else {
+      // Hash collision: keep the data separately.
+      digest.clear();
+      usedMemory += png->size();
+    }
+  }
+  if (!digest.isEmpty()) {
+    digests[page] = digest;
+    shared_pages.insert(digest, page);
+  }
+  it->second.swap(png);
+}
+
+void PixCache::release(const PngPixmap &png)
+{
+  const auto it = digests.find(png.getPage());
+  if (it == digests.end()) {
+    usedMemory -= png.size();
+    return;
+  }
+  shared_pages.remove(it->second, it->first);
+  // The data is only freed when the last page sharing it is removed.
+  if (!shared_pages.contains(it->second)) usedMemory -= png.size();
+  digests.erase(it);
+}
+
+bool PixCache::reusePage(const int page, const qreal resolution)
+{
+  if (page < 0 || page >= pdfDoc->numberOfPages()) return false;
+  mutex.lock();
+  const auto current = cache.find(page);
+  if (current != cache.cend() && current->second &&
+      abs(current->second->getResolution() - resolution) <
+          max_resolution_deviation) {
+    mutex.unlock();
+    return false;
+  }
+  mutex.unlock();
+
+  // Looking up the shared cache is cheaper than the content hash.
+  if (sharedPage(page, resolution)) return true;
+
+  auto hash_it = content_hashes.constFind(page);
+  if (hash_it == content_hashes.cend())
+    hash_it = content_hashes.insert(page, pdfDoc->pageContentHash(page));
+  if (hash_it->isEmpty()) return false;
+  mutex.lock();
+  for (auto it = content_hashes.cbegin(); it != content_hashes.cend(); ++it) {
+    if (it.key() == page || it.value() != *hash_it) continue;
+    const auto other = cache.find(it.key());
+    if (other == cache.cend() || !other->second || other->second->isNull() ||
+        other->second->isDiff() ||
+        abs(other->second->getResolution() - resolution) >
+            max_resolution_deviation)
+      continue;
+    std::unique_ptr<const PngPixmap> png(
+        new PngPixmap(new QByteArray(other->second->bytes()), page,
+                      other->second->getResolution()));
+    store(png);
+    mutex.unlock();
+    debug_msg(DebugCache, "copied identical page" << it.key() << page);
+    Tracer::instant("cache copy", "cache", page);
+    return true;
+  }
+  mutex.unlock();
+  return false;
+}
+
+bool PixCache::sharedPage(const int page, const qreal resolution,
+                          QPixmap *pixmap)
+{
+  if (!shared_cache) return false;
+  qreal found_resolution;
+  const QByteArray data = shared_cache->find(
+      page, page_part, resolution, max_resolution_deviation, found_resolution);
+  if (data.isEmpty()) return false;
+  std::unique_ptr<const PngPixmap> png(
+      new PngPixmap(new QByteArray(data), page, found_resolution));
+  if (pixmap) {
+    *pixmap = png->pixmap();
+    if (pixmap->isNull()) return false;
+  }
+  mutex.lock();
+  store(png);
+  mutex.unlock();
+  debug_msg(DebugCache, "took page from shared cache" << page);
+  Tracer::instant("shared cache hit", "cache", page);
+  return true;
+}
+
+void PixCache::publish(const PngPixmap &png) const
+{
+  if (shared_cache && !png.isNull() && !png.isDiff())
+    shared_cache->insert(png.getPage(), page_part, png.getResolution(),
+                         png.bytes());
+}
+
+void PixCache::updateSharedCache()
+{
+  if (preferences()->shared_cache_memory <= 0) return;
+  const QString path = SharedRenderCache::segmentPath(pdfDoc.get());
+  if (shared_cache && shared_cache->path() == path) return;
+  delete shared_cache;
+  shared_cache =
+      new SharedRenderCache(path, preferences()->shared_cache_memory);
+}
@@ -4,6 +4,8 @@
 #ifndef PIXCACHE_H
 #define PIXCACHE_H
 
+#include <QByteArray>
+#include <QHash>
 #include <QList>
 #include <QMap>
 #include <QMutex>
@@ -23,6 +25,7 @@ class QPixmap;
 class QTimerEvent;
 class PdfDocument;
 class PixCacheThread;
+class SharedRenderCache;
 class AbstractRenderer;
 
 /**
@@ -33,6 +36,19 @@ class AbstractRenderer;
  *
  * Objects of this class are moved to separate threads. These objects
  * should only be accessed via queued connections.
+ *
+ * Overlays of a slide (consecutive pages with the same label) are stored as
+ * difference images relative to the first overlay of the slide if this is
+ * already cached, see PngPixmap::difference.
+ *
+ * Identical pages (e.g. repeated title or section pages) share their PNG
+ * data. Render results are identified by a hash of their PNG data, and
+ * pages are not rendered at all if the document reports the same content
+ * hash as for a cached page, see PdfDocument::pageContentHash.
+ *
+ * If enabled in the preferences, rendered pages are also written to a
+ * SharedRenderCache and pages are taken from there instead of rendering
+ * them if another process has rendered them.
  */
 class PixCache : public QObject
 {
@@ -53,8 +69,24 @@ class PixCache : public QObject
   /// std::map seems better than QMap for handling std::unique_ptr
   std::map<int, std::unique_ptr<const PngPixmap>> cache;
 
+  /// SHA-1 digests of the PNG data of cached full images by page number.
+  std::map<int, QByteArray> digests;
+
+  /// Pages by digest of their PNG data. Pages with the same digest share
+  /// their PNG data, which is counted only once in usedMemory.
+  QMultiHash<QByteArray, int> shared_pages;
+
+  /// Content hashes of pages (see PdfDocument::pageContentHash) which have
+  /// been requested. Only accessed in this object's thread.
+  QHash<int, QByteArray> content_hashes;
+
   /// Mutex to lock this thread.
-  QMutex mutex;
+  mutable QMutex mutex;
+
+  /// Mutex for the partner pointers of all caches. It is held while a cache
+  /// calls its partner, so that the partner cannot be deleted in the
+  /// meantime. It must be locked before mutex if both are locked.
+  static QMutex partner_mutex;
 
   /// List of pages which should be rendered next.
   QList<int> priority;
@@ -85,6 +117,19 @@ class PixCache : public QObject
   /// Own renderer for rendering in PixCache thread.
   AbstractRenderer *renderer{nullptr};
 
+  /// Page part rendered by this cache.
+  const PagePart page_part;
+
+  /// Render cache shared with other processes, owned by this. nullptr if
+  /// disabled. Only accessed in this object's thread.
+  SharedRenderCache *shared_cache{nullptr};
+
+  /// Cache of the other half of the same document, if both halves are shown
+  /// (beamer notes on the second screen). Render jobs of the threads are then
+  /// shared: each job renders both halves and sends the other half to the
+  /// partner. Protected by partner_mutex.
+  PixCache *partner{nullptr};
+
   /// Pdf document.
   std::shared_ptr<const PdfDocument> pdfDoc;
 
@@ -100,11 +145,70 @@ class PixCache : public QObject
 
   /// Calculate resolution for given page number based on this->frame.
   /// Return resolution in pixels per point (72*dpi)
-  qreal getResolution(const int page) const;
+  qreal getResolution(const int page) const
+  {
+    return getResolution(page, frame, cacheMode);
+  }
+
+  /// Calculate resolution for given page number, frame size and cache mode.
+  qreal getResolution(const int page, const QSizeF &size,
+                      const CacheMode mode) const;
 
   /// Get pixmap showing page and write it to cache.
   const QPixmap pixmap(const int page, qreal resolution = -1.);
 
+  /// Insert png in cache, replacing the previous entry of the same page.
+  /// If another cached page has identical PNG data, the data is shared.
+  /// Takes ownership of png. mutex must be locked.
+  void store(std::unique_ptr<const PngPixmap> &png);
+
+  /// Update usedMemory and the digests before png is removed from cache.
+  /// mutex must be locked.
+  void release(const PngPixmap &png);
+
+  /// Fill the cache entry of page without rendering it: copy a cached page
+  /// with the same content hash or take the page from shared_cache.
+  /// Return true on success. Computing the content hash can be slow, so
+  /// this is only called when rendering pages in the background. Visible
+  /// pages are only looked up in shared_cache, see sharedPage().
+  bool reusePage(const int page, const qreal resolution);
+
+  /// Take page from shared_cache and store it in cache. If pixmap is not
+  /// nullptr, the image is also decompressed to pixmap. This does not
+  /// compute content hashes and is fast enough for visible pages.
+  /// Return true on success.
+  bool sharedPage(const int page, const qreal resolution,
+                  QPixmap *pixmap = nullptr);
+
+  /// Write a rendered full image to shared_cache.
+  void publish(const PngPixmap &png) const;
+
+  /// Open shared_cache if it is enabled, or reopen it if the document has
+  /// changed.
+  void updateSharedCache();
+
+  /// Decompress cached image. Difference images are applied to their
+  /// keyframe, which must be cached with the same resolution.
+  /// Return null pixmap on failure. mutex must be locked.
+  QPixmap decode(const PngPixmap &png) const;
+
+  /// Check whether png is a full image or its keyframe is cached with the
+  /// same resolution. mutex must be locked.
+  bool hasKeyframe(const PngPixmap &png) const;
+
+  /// Check whether page is a cached keyframe of a difference image of a
+  /// page at or after current. mutex must be locked.
+  bool isNeededKeyframe(const int page, const int current) const;
+
+  /// Remove all difference images which are based on the keyframe page
+  /// from cache. Return the number of removed images. mutex must be locked.
+  int releaseDiffs(const int page);
+
+  /// Find the keyframe for storing page as difference image: the first
+  /// overlay of the slide if it is cached as full image with resolution.
+  /// Write its PNG data to png and return its page or -1.
+  int keyframe(const int page, const qreal resolution, QByteArray &png) const;
+
  protected:
   /// Timer event: stop the timer and start rendering next pixmap.
   void timerEvent(QTimerEvent *event) override;
@@ -155,9 +259,50 @@ class PixCache : public QObject
   /// Total size of all cached pages in bytes
   qint64 getUsedMemory() const noexcept { return usedMemory; }
 
+  /// Number of cached pages, excluding pages which are being rendered.
+  /// This is thread safe.
+  int cachedPages() const;
+
+  /// Page part rendered by this cache.
+  PagePart pagePart() const noexcept { return page_part; }
+
+  /// Document rendered by this cache.
+  const PdfDocument *document() const noexcept { return pdfDoc.get(); }
+
+  /// Check whether a partner cache is set. This is thread safe.
+  bool hasPartner() const;
+
+  /// Set partner cache for sharing render jobs of split pages.
+  /// This is thread safe.
+  void setPartner(PixCache *other);
+
+  /**
+   * Reserve a page which will be rendered by a thread of the partner cache.
+   * This succeeds if the page is neither cached nor reserved and if the
+   * resolution matches the resolution required by this cache. The page
+   * must then be sent to receiveData, also if rendering fails.
+   * This is thread safe.
+   * @return true if the page was reserved
+   */
+  bool reservePage(const int page, const qreal resolution);
+
   /// Number of pixels per page (maximum)
   float getPixels() const noexcept { return frame.width() * frame.height(); }
 
+  /**
+   * Get a cached page as PNG data if it was rendered with at least the given
+   * resolution. This is thread safe.
+   * @param document only pages of this document are returned
+   * @param part only pages rendered with this page part are returned
+   * @param page page number
+   * @param min_resolution minimal resolution in pixels per point
+   * @param resolution is set to the resolution of the cached page
+   * @return PNG data or empty QByteArray if the page is not available
+   */
+  QByteArray cachedPage(const PdfDocument *document, const PagePart part,
+                        const int page, const qreal min_resolution,
+                        qreal &resolution) const;
+
  public slots:
   /// Set memory based on scale factor (bytes per pixel).
   void setScaledMemory(const float scale)
@@ -194,7 +339,8 @@ class PixCache : public QObject
   /// Start rendering the next page(s).
   void startRendering();
 
-  /// Receive a PngPixmap from one of the threads.
+  /// Receive a PngPixmap from one of the threads or from the partner.
+  /// A PngPixmap without data releases a reserved page.
   /// May only be called in this object's thread.
   void receiveData(const PngPixmap *data);
 
@@ -210,8 +356,17 @@ class PixCache : public QObject
   void pageReady(const QPixmap pixmap, const int page);
 
   /// Notify target thread that it should work on given page.
+  /// If shared is true, the thread renders both halves of the page.
+  /// If key_page >= 0, the page is stored as difference image relative to
+  /// key_png showing key_page.
   void setPixCacheThreadPage(const PixCacheThread *target,
-                             const int page_number, const qreal res);
+                             const int page_number, const qreal res,
+                             const bool shared, const int key_page,
+                             const QByteArray &key_png);
+
+  /// Send the other half of a page rendered in a shared render job to the
+  /// partner.
+  void sendPartnerData(const PngPixmap *data);
 };
 
 #endif  // PIXCACHE_H
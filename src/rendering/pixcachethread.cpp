@@ -1,6 +1,8 @@
 // SPDX-FileCopyrightText: 2022 Valentin Bruch <software@vbruch.eu>
 // SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
 
+#include <QImage>
+
 #include "src/config.h"
 #include "src/rendering/pdfdocument.h"
 #ifdef USE_EXTERNAL_RENDERER
@@ -10,15 +12,24 @@
 #include "src/preferences.h"
 #include "src/rendering/pixcachethread.h"
 #include "src/rendering/pngpixmap.h"
+#include "src/tracer.h"
 
 void PixCacheThread::setNextPage(const PixCacheThread *target,
-                                 const int page_number, const qreal res)
+                                 const int page_number, const qreal res,
+                                 const bool shared_job, const int key_page,
+                                 const QByteArray &key_png)
 {
-  if (target == this && !isRunning()) {
+  if (target != this) return;
+  if (!isRunning()) {
     page = page_number;
     resolution = res;
+    shared = shared_job;
+    keyframe = key_page;
+    keyframe_png = key_png;
     start(QThread::LowPriority);
-  }
+  } else if (shared_job)
+    // Release the page reserved by the partner.
+    emit sendPartnerData(new PngPixmap(page_number, res));
 }
 
 void PixCacheThread::run()
@@ -29,17 +40,51 @@ void PixCacheThread::run()
   }
 
   // Check if a renderer is available.
-  if (renderer == nullptr || resolution <= 0. || page < 0) return;
+  if (renderer == nullptr || resolution <= 0. || page < 0) {
+    if (shared) emit sendPartnerData(new PngPixmap(page, resolution));
+    return;
+  }
 
   // Render the image. This is takes some time.
   debug_msg(DebugCache,
             "Rendering in cache thread:" << page << resolution << this);
-  auto image = renderer->renderPng(page, resolution);
+  const PngPixmap *image;
+  if (shared) {
+    QPair<const PngPixmap *, const PngPixmap *> halves;
+    {
+      const TraceSpan span("shared cache job", "cache", page);
+      halves = renderer->renderHalvesPng(page, resolution);
+    }
+    const bool left = renderer->pagePart() == LeftHalf;
+    const PngPixmap *other = left ? halves.second : halves.first;
+    // The partner has reserved this page and must always get an answer.
+    emit sendPartnerData(other ? other : new PngPixmap(page, resolution));
+    image = left ? halves.first : halves.second;
+  } else if (keyframe >= 0 && !keyframe_png.isEmpty()) {
+    const TraceSpan span("overlay cache job", "cache", page);
+    image = renderDiff();
+  } else {
+    const TraceSpan span("cache job", "cache", page);
+    image = renderer->renderPng(page, resolution);
+  }
 
   // Send the image to pixcache master.
   if (image) emit sendData(image);
 }
 
+const PngPixmap *PixCacheThread::renderDiff() const
+{
+  const QImage image = renderer->renderImage(
+      page, resolution,
+      AbstractRenderer::partRect(doc->pageSize(page), renderer->pagePart()));
+  if (image.isNull()) return nullptr;
+  const PngPixmap *diff = PngPixmap::difference(
+      image, QImage::fromData(keyframe_png, "PNG"), keyframe, page, resolution);
+  debug_verbose(DebugCache, "overlay difference image" << page << keyframe
+                                                       << (diff != nullptr));
+  return diff ? diff : new PngPixmap(image, page, resolution);
+}
+
 bool PixCacheThread::initializeRenderer(
     const std::shared_ptr<const PdfDocument> &doc, const PagePart page_part)
 {
@@ -48,7 +93,7 @@ bool PixCacheThread::initializeRenderer(
   if (preferences()->renderer == Renderer::ExternalRenderer)
     renderer = new ExternalRenderer(preferences()->rendering_command,
                                     preferences()->rendering_arguments, doc,
-                                    page_part);
+                                    page_part, preferences()->rendering_worker);
   else
 #endif
     renderer = createRenderer(doc, page_part);
@@ -4,6 +4,7 @@
 #ifndef PIXCACHETHREAD_H
 #define PIXCACHETHREAD_H
 
+#include <QByteArray>
 #include <QThread>
 #include <memory>
 
@@ -31,11 +32,29 @@ class PixCacheThread : public QThread
   /// page number (index)
   int page = -1;
 
+  /// Render both halves of the page and send the other half to the partner
+  /// of the PixCache.
+  bool shared = false;
+
+  /// First overlay of the slide, if page should be stored as difference
+  /// image relative to this keyframe. Otherwise -1.
+  int keyframe = -1;
+
+  /// PNG image of keyframe rendered with resolution.
+  QByteArray keyframe_png;
+
+  /// Document, required for page sizes.
+  std::shared_ptr<const PdfDocument> doc;
+
+  /// Render page and create difference image relative to keyframe. If the
+  /// difference is large, a full image is returned.
+  const PngPixmap *renderDiff() const;
+
  public:
   /// Constructor: initialize thread and renderer.
   PixCacheThread(const std::shared_ptr<const PdfDocument> &doc,
                  const PagePart page_part = FullPage, QObject *parent = nullptr)
-      : QThread(parent)
+      : QThread(parent), doc(doc)
   {
     initializeRenderer(doc, page_part);
   }
@@ -54,12 +73,18 @@ class PixCacheThread : public QThread
  public slots:
   /// Set page number and resolution, then start the thread.
   /// Only has an effect if target==this and if this is not running.
+  /// If key_page >= 0, the page is stored as difference to the image
+  /// key_png of page key_page.
   void setNextPage(const PixCacheThread *target, const int page_number,
-                   const qreal res);
+                   const qreal res, const bool shared_job, const int key_page,
+                   const QByteArray &key_png);
 
  signals:
   /// Send out the data.
   void sendData(const PngPixmap *data);
+
+  /// Send out the other half of a shared render job.
+  void sendPartnerData(const PngPixmap *data);
 };
 
 #endif  // PIXCACHETHREAD_H
@@ -5,8 +5,31 @@
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QImage>
+#include <QPainter>
 #include <QPixmap>
 #include <QtDebug>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+/// Edge length in pixels of the tiles in which images are compared.
+constexpr int diff_tile = 32;
+/// Maximum fraction of the image area covered by patches of a difference
+/// image.
+constexpr qreal max_diff_area = 0.5;
+
+/// Compress image to PNG. Return empty QByteArray on failure.
+QByteArray encode(const QImage &image)
+{
+  QByteArray bytes;
+  QBuffer buffer(&bytes);
+  if (!buffer.open(QIODevice::WriteOnly) || !image.save(&buffer, "PNG"))
+    return QByteArray();
+  return bytes;
+}
+}  // namespace
 
 PngPixmap::PngPixmap(const QPixmap pixmap, const int page,
                      const float resolution)
@@ -33,6 +56,128 @@ PngPixmap::PngPixmap(const QPixmap pixmap, const int page,
   }
 }
 
+PngPixmap::PngPixmap(const QImage &image, const int page,
+                     const float resolution)
+    : data(nullptr), resolution(resolution), page(page)
+{
+  if (image.isNull() || image.size().isEmpty()) return;
+  const QByteArray bytes = encode(image);
+  if (bytes.isEmpty())
+    qWarning() << "Compressing image to PNG failed";
+  else
+    data = new QByteArray(bytes);
+}
+
+PngPixmap::PngPixmap(const int keyframe, const QVector<Patch> &patches,
+                     const int page, const float resolution)
+    : data(new QByteArray()),
+      keyframe(keyframe),
+      patches(patches),
+      resolution(resolution),
+      page(page)
+{
+}
+
+int PngPixmap::size() const noexcept
+{
+  int size = data->size();
+  for (const auto &patch : patches) size += patch.png.size();
+  return size;
+}
+
+const QImage PngPixmap::image() const
+{
+  QImage image;
+  if (data == nullptr || data->isEmpty() || !image.loadFromData(*data, "PNG"))
+    qWarning() << "Loading image from PNG failed";
+  return image;
+}
+
+PngPixmap *PngPixmap::difference(const QImage &image,
+                                 const QImage &keyframe_image,
+                                 const int keyframe, const int page,
+                                 const float resolution)
+{
+  if (image.isNull() || image.size() != keyframe_image.size()) return nullptr;
+  const QImage current = image.convertToFormat(QImage::Format_ARGB32);
+  const QImage reference =
+      keyframe_image.convertToFormat(QImage::Format_ARGB32);
+  const int width = current.width(), height = current.height();
+  const int columns = (width + diff_tile - 1) / diff_tile;
+
+  // Find changed tiles row by row. Runs of changed tiles form rectangles,
+  // which are extended downwards while the next tile row contains a run
+  // with the same columns.
+  QVector<QRect> rects, open, next_open;
+  QVector<bool> changed(columns);
+  for (int y = 0; y < height; y += diff_tile) {
+    const int rows = std::min(diff_tile, height - y);
+    changed.fill(false);
+    for (int line = y; line < y + rows; ++line) {
+      const QRgb *a =
+          reinterpret_cast<const QRgb *>(current.constScanLine(line));
+      const QRgb *b =
+          reinterpret_cast<const QRgb *>(reference.constScanLine(line));
+      for (int column = 0; column < columns; ++column) {
+        const int x = column * diff_tile;
+        if (!changed[column] &&
+            std::memcmp(a + x, b + x,
+                        std::min(diff_tile, width - x) * sizeof(QRgb)))
+          changed[column] = true;
+      }
+    }
+    next_open.clear();
+    for (int column = 0; column < columns; ++column) {
+      if (!changed[column]) continue;
+      const int start = column;
+      while (column + 1 < columns && changed[column + 1]) ++column;
+      const int x = start * diff_tile;
+      QRect rect(x, y, std::min((column + 1) * diff_tile, width) - x, rows);
+      for (auto it = open.begin(); it != open.end(); ++it)
+        if (it->left() == rect.left() && it->width() == rect.width()) {
+          rect.setTop(it->top());
+          open.erase(it);
+          break;
+        }
+      next_open.append(rect);
+    }
+    // Rectangles which were not extended are complete.
+    rects += open;
+    open.swap(next_open);
+  }
+  rects += open;
+
+  qint64 area = 0;
+  for (const auto &rect : std::as_const(rects))
+    area += qint64(rect.width()) * rect.height();
+  if (area > max_diff_area * width * height) return nullptr;
+
+  QVector<Patch> patches;
+  patches.reserve(rects.size());
+  for (const auto &rect : std::as_const(rects)) {
+    const QByteArray png = encode(image.copy(rect));
+    if (png.isEmpty()) return nullptr;
+    patches.append({rect, png});
+  }
+  return new PngPixmap(keyframe, patches, page, resolution);
+}
+
+bool PngPixmap::applyPatches(QImage &keyframe_image) const
+{
+  if (!isDiff() || keyframe_image.isNull()) return false;
+  // QPainter cannot paint on all image formats, e.g. indexed images.
+  keyframe_image =
+      keyframe_image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+  QPainter painter(&keyframe_image);
+  painter.setCompositionMode(QPainter::CompositionMode_Source);
+  for (const auto &patch : patches) {
+    const QImage patch_image = QImage::fromData(patch.png, "PNG");
+    if (patch_image.size() != patch.rect.size()) return false;
+    painter.drawImage(patch.rect.topLeft(), patch_image);
+  }
+  return true;
+}
+
 const QPixmap PngPixmap::pixmap() const
 {
   QPixmap pixmap;
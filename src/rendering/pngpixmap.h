@@ -5,19 +5,44 @@
 #define PNGPIXMAP_H
 
 #include <QByteArray>
+#include <QRect>
+#include <QVector>
 
 #include "src/config.h"
 
+class QImage;
 class QPixmap;
 
 /**
  * @brief PNG-compressed QPixmap image.
+ *
+ * A PngPixmap can also represent a difference image: only the rectangles,
+ * in which the page differs from another page (the keyframe), are stored
+ * as PNG images. This is used for overlays of the same slide, which often
+ * differ only in small regions. The full image is obtained by applying the
+ * patches to the image of the keyframe.
  */
 class PngPixmap
 {
-  /// PNG-compressed image.
+ public:
+  /// Changed region of a difference image.
+  struct Patch {
+    /// Rectangle in pixels.
+    QRect rect;
+    /// PNG-compressed image of the rectangle.
+    QByteArray png;
+  };
+
+ private:
+  /// PNG-compressed image. Empty for difference images.
   const QByteArray* data;
 
+  /// Page of the keyframe for difference images, -1 for full images.
+  const int keyframe = -1;
+
+  /// Patches which are applied to the keyframe for difference images.
+  const QVector<Patch> patches;
+
   /// Resolution with which the image was or should be rendered
   /// (in pixels per point, dpi/72).
   const float resolution;
@@ -36,6 +61,10 @@ class PngPixmap
   /// fails.
   PngPixmap(const QPixmap pixmap, const int page, const float resolution);
 
+  /// Constructor: compresses image to PNG. data is null if compression
+  /// fails. In contrast to QPixmap, this is safe outside the main thread.
+  PngPixmap(const QImage &image, const int page, const float resolution);
+
   /// Constructor: takes ownership of data.
   PngPixmap(const QByteArray* data, const int page = 0,
             const float resolution = -1.) noexcept
@@ -43,15 +72,46 @@ class PngPixmap
   {
   }
 
+  /// Constructor for a difference image: patches replace rectangles in the
+  /// image of page keyframe.
+  PngPixmap(const int keyframe, const QVector<Patch>& patches, const int page,
+            const float resolution);
+
   /// Destructor: deletes data.
   ~PngPixmap() noexcept { delete data; }
 
+  /**
+   * Create a difference image of image relative to keyframe_image. Both
+   * images must have the same size. This is safe outside the main thread.
+   * @return difference image or nullptr if the images differ in a large
+   *     region, such that a full image should be stored instead
+   */
+  static PngPixmap* difference(const QImage& image,
+                               const QImage& keyframe_image,
+                               const int keyframe, const int page,
+                               const float resolution);
+
   /// Decompress the image and return the QPixmap.
   /// The caller takes ownership of the returned QPixmap.
+  /// This fails for difference images.
   const QPixmap pixmap() const;
 
-  /// Size of data in bytes.
-  int size() const noexcept { return data->size(); }
+  /// Decompress the image. In contrast to pixmap(), this is safe outside
+  /// the main thread. This fails for difference images.
+  const QImage image() const;
+
+  /// Apply the patches of a difference image to the image of the keyframe.
+  /// Return false if this fails.
+  bool applyPatches(QImage& keyframe_image) const;
+
+  /// Size of data in bytes, including patches.
+  int size() const noexcept;
+
+  /// Check whether this is a difference image.
+  bool isDiff() const noexcept { return keyframe >= 0; }
+
+  /// Page of the keyframe for difference images, -1 otherwise.
+  int getKeyframe() const noexcept { return keyframe; }
 
   /// Resolution of the image in pixels per point (dpi/72).
   qreal getResolution() const noexcept { return resolution; }
@@ -59,6 +119,10 @@ class PngPixmap
   /// Page number.
   int getPage() const noexcept { return page; }
 
+  /// Shallow copy of the PNG data (empty if data == nullptr or if this is
+  /// a difference image).
+  QByteArray bytes() const { return data ? *data : QByteArray(); }
+
   /// Check whether data == nullptr
   bool isNull() const noexcept { return data == nullptr; }
 
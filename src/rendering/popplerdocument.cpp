@@ -3,12 +3,14 @@
 
 #include <QBuffer>
 #include <QByteArray>
+#include <QFile>
 #include <QFileInfo>
 #include <QImage>
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QPixmap>
 #include <QPointF>
+#include <QRect>
 #include <QRectF>
 #include <QSizeF>
 #include <QUrl>
@@ -27,6 +29,7 @@
 #include "src/rendering/pngpixmap.h"
 #include "src/rendering/popplerdocument.h"
 #include "src/rendering/popplerrenderer.h"
+#include "src/tracer.h"
 
 EmbeddedAudio *embeddedSound(const Poppler::SoundObject *sound,
                              const QRectF &rect)
@@ -89,14 +92,24 @@ bool PopplerDocument::loadDocument()
   // Check if the file has changed since last (re)load
   if (doc != nullptr && fileinfo.lastModified() == lastModified) return false;
 
-  // Load the document.
-  std::unique_ptr<Poppler::Document> newdoc(Poppler::Document::load(path));
+  // Load the document from memory. Renderers load own documents from the
+  // same data.
+  QFile file(path);
+  if (!file.open(QFile::ReadOnly)) {
+    qCritical() << tr("Failed to load document.");
+    return false;
+  }
+  const QByteArray data = file.readAll();
+  file.close();
+  std::unique_ptr<Poppler::Document> newdoc(
+      Poppler::Document::loadFromData(data));
   if (newdoc == nullptr) {
     qCritical() << tr("Failed to load document.");
     return false;
   }
 
   // Try to unlock a locked document.
+  QByteArray user_password;
   if (newdoc->isLocked()) {
     qWarning() << "Document is locked.";
     // Use a QInputDialog to ask for the password.
@@ -115,70 +128,104 @@ bool PopplerDocument::loadDocument()
       newdoc = nullptr;
       return false;
     }
+    user_password = password.toUtf8();
   }
   // Save the modification time.
   lastModified = fileinfo.lastModified();
 
-  // Set rendering hints.
-  newdoc->setRenderHint(Poppler::Document::TextAntialiasing);
-  newdoc->setRenderHint(Poppler::Document::TextHinting);
-  newdoc->setRenderHint(Poppler::Document::TextSlightHinting);
-  newdoc->setRenderHint(Poppler::Document::Antialiasing);
-  newdoc->setRenderHint(Poppler::Document::ThinLineShape);
+  setRenderHints(newdoc.get());
 
   // Update document and delete old document.
   if (newdoc != nullptr) doc.swap(newdoc);
   flexible_page_sizes = -1;
 
+  data_mutex.lock();
+  file_data = data;
+  password = user_password;
+  ++revision;
+  data_mutex.unlock();
+
   return true;
 }
 
-const QPixmap PopplerDocument::getPixmap(const int page, const qreal resolution,
-                                         const PagePart page_part) const
+void PopplerDocument::setRenderHints(Poppler::Document *document)
 {
-  const std::unique_ptr<Poppler::Page> docpage(doc->page(page));
-  if (!docpage || !checkResolution(page, resolution)) {
-    qWarning() << "Tried to render invalid page or invalid resolution" << page;
-    return QPixmap();
-  }
-  const QImage image =
-      docpage->renderToImage(72. * resolution, 72. * resolution);
-  switch (page_part) {
-    case LeftHalf:
-      return QPixmap::fromImage(
-          image.copy(0, 0, image.width() / 2, image.height()));
-    case RightHalf:
-      return QPixmap::fromImage(image.copy((image.width() + 1) / 2, 0,
-                                           image.width() / 2, image.height()));
-    default:
-      return QPixmap::fromImage(image);
+  document->setRenderHint(Poppler::Document::TextAntialiasing);
+  document->setRenderHint(Poppler::Document::TextHinting);
+  document->setRenderHint(Poppler::Document::TextSlightHinting);
+  document->setRenderHint(Poppler::Document::Antialiasing);
+  document->setRenderHint(Poppler::Document::ThinLineShape);
+}
+
+std::unique_ptr<Poppler::Document> PopplerDocument::loadRenderDocument(
+    int &document_revision) const
+{
+  data_mutex.lock();
+  // Implicitly shared: the file is kept in memory only once.
+  const QByteArray data = file_data;
+  const QByteArray user_password = password;
+  document_revision = revision;
+  data_mutex.unlock();
+  if (data.isEmpty()) return nullptr;
+  std::unique_ptr<Poppler::Document> newdoc(
+      Poppler::Document::loadFromData(data, QByteArray(), user_password));
+  if (newdoc == nullptr || newdoc->isLocked()) {
+    qWarning() << "Failed to load document for rendering";
+    return nullptr;
   }
+  setRenderHints(newdoc.get());
+  return newdoc;
 }
 
-const PngPixmap *PopplerDocument::getPng(const int page, const qreal resolution,
-                                         const PagePart page_part) const
+int PopplerDocument::currentRevision() const
 {
-  const std::unique_ptr<Poppler::Page> docpage(doc->page(page));
+  data_mutex.lock();
+  const int current = revision;
+  data_mutex.unlock();
+  return current;
+}
+
+const QImage PopplerDocument::getImage(const int page, const qreal resolution,
+                                       const QRectF &rect,
+                                       const Poppler::Document *document) const
+{
+  const std::unique_ptr<Poppler::Page> docpage(
+      (document ? document : doc.get())->page(page));
   if (!docpage || !checkResolution(page, resolution)) {
     qWarning() << "Tried to render invalid page or invalid resolution" << page;
-    return nullptr;
+    return QImage();
   }
-  QImage image = docpage->renderToImage(72. * resolution, 72. * resolution);
+  const QSize size = (resolution * docpage->pageSizeF()).toSize();
+  const QRect pixels =
+      AbstractRenderer::pixelRect(rect, resolution) & QRect(QPoint(), size);
+  if (pixels.isEmpty()) return QImage();
+  const TraceSpan span("render", "render", page);
+  // Poppler only rasterises the given rectangle.
+  return docpage->renderToImage(72. * resolution, 72. * resolution, pixels.x(),
+                                pixels.y(), pixels.width(), pixels.height());
+}
+
+const QPixmap PopplerDocument::getPixmap(
+    const int page, const qreal resolution, const PagePart page_part,
+    const Poppler::Document *document) const
+{
+  return QPixmap::fromImage(getImage(
+      page, resolution, AbstractRenderer::partRect(pageSize(page), page_part),
+      document));
+}
+
+const PngPixmap *PopplerDocument::getPng(
+    const int page, const qreal resolution, const PagePart page_part,
+    const Poppler::Document *document) const
+{
+  const QImage image = getImage(
+      page, resolution, AbstractRenderer::partRect(pageSize(page), page_part),
+      document);
   if (image.isNull()) {
     qWarning() << "Rendering page to image failed";
     return nullptr;
   }
-  switch (page_part) {
-    case LeftHalf:
-      image = image.copy(0, 0, image.width() / 2, image.height());
-      break;
-    case RightHalf:
-      image = image.copy((image.width() + 1) / 2, 0, image.width() / 2,
-                         image.height());
-      break;
-    default:
-      break;
-  }
+  const TraceSpan span("encode", "render", page);
   QByteArray *const bytes = new QByteArray();
   QBuffer buffer(bytes);
   if (!buffer.open(QIODevice::WriteOnly) || !image.save(&buffer, "PNG")) {
@@ -189,6 +236,34 @@ const PngPixmap *PopplerDocument::getPng(const int page, const qreal resolution,
   return new PngPixmap(bytes, page, resolution);
 }
 
+QPair<const PngPixmap *, const PngPixmap *> PopplerDocument::getHalvesPng(
+    const int page, const qreal resolution,
+    const Poppler::Document *document) const
+{
+  const std::unique_ptr<Poppler::Page> docpage(
+      (document ? document : doc.get())->page(page));
+  if (!docpage || !checkResolution(page, resolution)) {
+    qWarning() << "Tried to render invalid page or invalid resolution" << page;
+    return {nullptr, nullptr};
+  }
+  QImage image;
+  {
+    const TraceSpan span("render", "render", page);
+    image = docpage->renderToImage(72. * resolution, 72. * resolution);
+  }
+  if (image.isNull()) {
+    qWarning() << "Rendering page to image failed";
+    return {nullptr, nullptr};
+  }
+  const TraceSpan span("encode", "render", page);
+  const int width = image.width() / 2;
+  return {new PngPixmap(image.copy(0, 0, width, image.height()), page,
+                        resolution),
+          new PngPixmap(image.copy((image.width() + 1) / 2, 0, width,
+                                   image.height()),
+                        page, resolution)};
+}
+
 void PopplerDocument::loadPageLabels()
 {
   // Poppler functions for converting between labels and numbers seem to be
@@ -394,7 +469,19 @@ const PdfLink *PopplerDocument::linkAt(const int page,
 QList<std::shared_ptr<MediaAnnotation>> PopplerDocument::annotations(
     const int page)
 {
-  const std::unique_ptr<Poppler::Page> docpage(doc->page(page));
+  media_mutex.lock();
+  if (!media_doc || media_revision != currentRevision())
+    media_doc = loadRenderDocument(media_revision);
+  QList<std::shared_ptr<MediaAnnotation>> list;
+  if (media_doc) list = readAnnotations(*media_doc, page);
+  media_mutex.unlock();
+  return list;
+}
+
+QList<std::shared_ptr<MediaAnnotation>> PopplerDocument::readAnnotations(
+    const Poppler::Document &document, const int page) const
+{
+  const std::unique_ptr<Poppler::Page> docpage(document.page(page));
   if (!docpage) return {};
   debug_verbose(DebugMedia, "Found" << docpage->annotations().size()
                                     << "annotations on page" << page);
@@ -474,10 +561,10 @@ QList<std::shared_ptr<MediaAnnotation>> PopplerDocument::annotations(
             debug_verbose(
                 DebugMedia,
                 "Found embedded video (screen) annotation: on page" << page);
-            std::shared_ptr<QByteArray> data =
-                std::make_shared<QByteArray>(rendition->data());
+            const auto file =
+                std::make_shared<EmbeddedMediaFile>(rendition->data());
             list.append(std::shared_ptr<MediaAnnotation>(
-                new EmbeddedMedia(data, rect, mode, flags)));
+                new EmbeddedMedia(file, rect, mode, flags)));
           } else {
             debug_verbose(
                 DebugMedia,
@@ -4,9 +4,14 @@
 #ifndef POPPLERDOCUMENT_H
 #define POPPLERDOCUMENT_H
 
+#include <QByteArray>
 #include <QCoreApplication>
+#include <QImage>
 #include <QList>
 #include <QMap>
+#include <QMutex>
+#include <QPair>
+#include <QRectF>
 #include <QString>
 #include <QtConfig>
 #include <memory>
@@ -40,6 +45,36 @@ class PopplerDocument : public PdfDocument
   /// Poppler document representing the PDF.
   std::unique_ptr<Poppler::Document> doc = nullptr;
 
+  /// Content of the PDF file. Renderers load own Poppler documents from
+  /// this data, such that rendering in several threads runs in parallel.
+  QByteArray file_data;
+
+  /// User password of a locked document.
+  QByteArray password;
+
+  /// Incremented whenever the file is (re)loaded.
+  int revision = 0;
+
+  /// Mutex for file_data, password and revision.
+  mutable QMutex data_mutex;
+
+  /// Own document for reading media annotations, such that annotations()
+  /// can be called from other threads. Loaded lazily from file_data.
+  std::unique_ptr<Poppler::Document> media_doc;
+
+  /// Revision from which media_doc was loaded.
+  int media_revision = -1;
+
+  /// Mutex for media_doc and media_revision.
+  QMutex media_mutex;
+
+  /// Read media annotations on page from document.
+  QList<std::shared_ptr<MediaAnnotation>> readAnnotations(
+      const Poppler::Document &document, const int page) const;
+
+  /// Set rendering hints used for all documents.
+  static void setRenderHints(Poppler::Document *document);
+
   /// populate pageLabels. Must be called after loadOutline.
   void loadPageLabels();
 
@@ -59,15 +94,43 @@ class PopplerDocument : public PdfDocument
 
   PdfEngine type() const noexcept override { return PdfEngine::Poppler; }
 
+  /**
+   * Load a new Poppler document from the data of the current file.
+   * Each renderer owns such a document, because a Poppler document cannot
+   * be used in several threads in parallel. This is thread safe.
+   * @param document_revision is set to the revision of the loaded data
+   * @return document or nullptr if loading failed
+   */
+  std::unique_ptr<Poppler::Document> loadRenderDocument(
+      int &document_revision) const;
+
+  /// Revision of the currently loaded file. This is thread safe.
+  int currentRevision() const;
+
+  /// Render only the part rect (in points) of page to QImage. page is given
+  /// as page index. resolution is given in pixels per point (dpi/72).
+  /// document is used for rendering if it is not nullptr.
+  const QImage getImage(const int page, const qreal resolution,
+                        const QRectF &rect,
+                        const Poppler::Document *document = nullptr) const;
+
   /// Render page to QPixmap. page is given as page index.
   /// resolution is given in pixels per point (dpi/72).
   const QPixmap getPixmap(const int page, const qreal resolution,
-                          const PagePart page_part) const;
+                          const PagePart page_part,
+                          const Poppler::Document *document = nullptr) const;
 
   /// Render page to PngPixmap. page is given as page index.
   /// resolution is given in pixels per point (dpi/72).
   const PngPixmap *getPng(const int page, const qreal resolution,
-                          const PagePart page_part) const;
+                          const PagePart page_part,
+                          const Poppler::Document *document = nullptr) const;
+
+  /// Render page once and compress left and right half separately to
+  /// PngPixmaps. resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap *, const PngPixmap *> getHalvesPng(
+      const int page, const qreal resolution,
+      const Poppler::Document *document = nullptr) const;
 
   /// Load or reload the file. Return true if the file was updated and false
   /// otherwise.
@@ -112,7 +175,7 @@ class PopplerDocument : public PdfDocument
   /// Link at given position (in point = inch/72).
   const PdfLink *linkAt(const int page, const QPointF &position) const override;
 
-  /// List all video annotations on given page.
+  /// List all video annotations on given page. This is thread safe.
   virtual QList<std::shared_ptr<MediaAnnotation>> annotations(
       const int page) override;
 
@@ -4,7 +4,9 @@
 #ifndef POPPLERRENDERER_H
 #define POPPLERRENDERER_H
 
+#include <QImage>
 #include <QPixmap>
+#include <QRectF>
 #include <memory>
 
 #include "src/config.h"
@@ -25,10 +27,28 @@ class PopplerRenderer : public AbstractRenderer
   /// Poppler PDF document.
   const std::shared_ptr<const PopplerDocument> doc;
 
+  /// Own Poppler document used for rendering, loaded lazily from the data
+  /// of doc. A Poppler document serializes all rendering, so each renderer
+  /// (one per render thread) uses its own document.
+  mutable std::unique_ptr<Poppler::Document> render_doc;
+
+  /// Revision of doc from which render_doc was loaded.
+  mutable int render_revision = -1;
+
+  /// Own document for rendering, reloaded if the file has changed.
+  /// Return nullptr if loading failed, the document of doc is then used.
+  /// A renderer must only be used by one thread at a time.
+  const Poppler::Document *renderDocument() const
+  {
+    if (!render_doc || render_revision != doc->currentRevision())
+      render_doc = doc->loadRenderDocument(render_revision);
+    return render_doc.get();
+  }
+
  public:
   /// Constructor: Only initializes doc and page_part.
   /// This does not perform any checks on the given document.
-  /// Also rendering hints are not set here and have to be set before.
+  /// The own document for rendering is loaded on first use.
   PopplerRenderer(const std::shared_ptr<const PdfDocument> &document,
                   const PagePart part = FullPage)
       : AbstractRenderer(part),
@@ -44,7 +64,8 @@ class PopplerRenderer : public AbstractRenderer
   const QPixmap renderPixmap(const int page,
                              const qreal resolution) const override
   {
-    return doc ? doc->getPixmap(page, resolution, page_part) : QPixmap();
+    return doc ? doc->getPixmap(page, resolution, page_part, renderDocument())
+               : QPixmap();
   }
 
   /// Render page to PNG image in a QByteArray.
@@ -52,7 +73,26 @@ class PopplerRenderer : public AbstractRenderer
   const PngPixmap *renderPng(const int page,
                              const qreal resolution) const override
   {
-    return doc ? doc->getPng(page, resolution, page_part) : nullptr;
+    return doc ? doc->getPng(page, resolution, page_part, renderDocument())
+               : nullptr;
+  }
+
+  /// Render only the part rect (in points) of a page to a QImage.
+  /// Resolution is given in pixels per point (dpi/72).
+  const QImage renderImage(const int page, const qreal resolution,
+                           const QRectF &rect) const override
+  {
+    return doc ? doc->getImage(page, resolution, rect, renderDocument())
+               : QImage();
+  }
+
+  /// Render both halves of a page from a single rasterisation.
+  /// Resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap *, const PngPixmap *> renderHalvesPng(
+      const int page, const qreal resolution) const override
+  {
+    if (doc) return doc->getHalvesPng(page, resolution, renderDocument());
+    return {nullptr, nullptr};
   }
 
   /// Check whether doc is valid.
@@ -11,6 +11,7 @@
 #include <QLineEdit>
 #include <QPdfDocument>
 #include <QPixmap>
+#include <QRect>
 #include <QSizeF>
 #include <QVector>
 
@@ -18,6 +19,7 @@
 #include "src/preferences.h"
 #include "src/rendering/pngpixmap.h"
 #include "src/rendering/qtrenderer.h"
+#include "src/tracer.h"
 
 QtDocument::QtDocument(const QString &filename)
     : PdfDocument(filename), doc(new QPdfDocument())
@@ -134,55 +136,48 @@ bool QtDocument::loadDocument()
   return true;
 }
 
-const QPixmap QtDocument::getPixmap(const int page, const qreal resolution,
-                                    const PagePart page_part) const
+const QImage QtDocument::getImage(const int page, const qreal resolution,
+                                  const QRectF &rect) const
 {
   if (page >= doc->pageCount() || page < 0 ||
       !checkResolution(page, resolution)) {
     qWarning() << "Tried to render invalid page or invalid resolution" << page;
-    return QPixmap();
-  }
-  const QImage image =
-      doc->render(page, (resolution * doc->PAGESIZE_FUNCTION(page)).toSize(),
-                  render_options);
-  switch (page_part) {
-    case LeftHalf:
-      return QPixmap::fromImage(
-          image.copy(0, 0, image.width() / 2, image.height()));
-    case RightHalf:
-      return QPixmap::fromImage(image.copy((image.width() + 1) / 2, 0,
-                                           image.width() / 2, image.height()));
-    default:
-      return QPixmap::fromImage(image);
+    return QImage();
   }
+  const QSize size = (resolution * doc->PAGESIZE_FUNCTION(page)).toSize();
+  const QRect pixels =
+      AbstractRenderer::pixelRect(rect, resolution) & QRect(QPoint(), size);
+  if (pixels.isEmpty()) return QImage();
+  const TraceSpan span("render", "render", page);
+  if (pixels.size() == size) return doc->render(page, size, render_options);
+#if (QT_VERSION_MAJOR >= 6)
+  // Only rasterise the clip rectangle of the scaled page.
+  QPdfDocumentRenderOptions options = render_options;
+  options.setScaledSize(size);
+  options.setScaledClipRect(pixels);
+  return doc->render(page, pixels.size(), options);
+#else
+  return doc->render(page, size, render_options).copy(pixels);
+#endif
+}
+
+const QPixmap QtDocument::getPixmap(const int page, const qreal resolution,
+                                    const PagePart page_part) const
+{
+  return QPixmap::fromImage(getImage(
+      page, resolution, AbstractRenderer::partRect(pageSize(page), page_part)));
 }
 
 const PngPixmap *QtDocument::getPng(const int page, const qreal resolution,
                                     const PagePart page_part) const
 {
-  if (page >= doc->pageCount() || page < 0 ||
-      !checkResolution(page, resolution)) {
-    qWarning() << "Tried to render invalid page or invalid resolution" << page;
-    return nullptr;
-  }
-  QImage image =
-      doc->render(page, (resolution * doc->PAGESIZE_FUNCTION(page)).toSize(),
-                  render_options);
+  const QImage image = getImage(
+      page, resolution, AbstractRenderer::partRect(pageSize(page), page_part));
   if (image.isNull()) {
     qWarning() << "Rendering page to image failed";
     return nullptr;
   }
-  switch (page_part) {
-    case LeftHalf:
-      image = image.copy(0, 0, image.width() / 2, image.height());
-      break;
-    case RightHalf:
-      image = image.copy((image.width() + 1) / 2, 0, image.width() / 2,
-                         image.height());
-      break;
-    default:
-      break;
-  }
+  const TraceSpan span("encode", "render", page);
   QByteArray *const bytes = new QByteArray();
   QBuffer buffer(bytes);
   buffer.open(QIODevice::WriteOnly);
@@ -194,6 +189,34 @@ const PngPixmap *QtDocument::getPng(const int page, const qreal resolution,
   return new PngPixmap(bytes, page, resolution);
 }
 
+QPair<const PngPixmap *, const PngPixmap *> QtDocument::getHalvesPng(
+    const int page, const qreal resolution) const
+{
+  if (page >= doc->pageCount() || page < 0 ||
+      !checkResolution(page, resolution)) {
+    qWarning() << "Tried to render invalid page or invalid resolution" << page;
+    return {nullptr, nullptr};
+  }
+  QImage image;
+  {
+    const TraceSpan span("render", "render", page);
+    image = doc->render(
+        page, (resolution * doc->PAGESIZE_FUNCTION(page)).toSize(),
+        render_options);
+  }
+  if (image.isNull()) {
+    qWarning() << "Rendering page to image failed";
+    return {nullptr, nullptr};
+  }
+  const TraceSpan span("encode", "render", page);
+  const int width = image.width() / 2;
+  return {new PngPixmap(image.copy(0, 0, width, image.height()), page,
+                        resolution),
+          new PngPixmap(image.copy((image.width() + 1) / 2, 0, width,
+                                   image.height()),
+                        page, resolution)};
+}
+
 bool QtDocument::flexiblePageSizes() noexcept
 {
   if (flexible_page_sizes >= 0 || !isValid()) return flexible_page_sizes;
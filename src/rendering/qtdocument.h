@@ -5,8 +5,11 @@
 #define QTDOCUMENT_H
 
 #include <QCoreApplication>
+#include <QImage>
+#include <QPair>
 #include <QPdfDocument>
 #include <QPdfDocumentRenderOptions>
+#include <QRectF>
 
 #include "src/config.h"
 #include "src/enumerates.h"
@@ -49,6 +52,11 @@ class QtDocument : public PdfDocument
 
   PdfEngine type() const noexcept override { return PdfEngine::QtPDF; }
 
+  /// Render only the part rect (in points) of page to QImage. page is given
+  /// as page index. resolution is given in pixels per point (dpi/72).
+  const QImage getImage(const int page, const qreal resolution,
+                        const QRectF &rect) const;
+
   /// Render page to QPixmap. page is given as page index.
   /// resolution is given in pixels per point (dpi/72).
   const QPixmap getPixmap(const int page, const qreal resolution,
@@ -59,6 +67,11 @@ class QtDocument : public PdfDocument
   const PngPixmap *getPng(const int page, const qreal resolution,
                           const PagePart page_part) const;
 
+  /// Render page once and compress left and right half separately to
+  /// PngPixmaps. resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap *, const PngPixmap *> getHalvesPng(
+      const int page, const qreal resolution) const;
+
   /// Load or reload the file. Return true if the file was updated and false
   /// otherwise.
   bool loadDocument() override final;
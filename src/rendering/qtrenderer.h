@@ -4,7 +4,9 @@
 #ifndef QTRENDERER_H
 #define QTRENDERER_H
 
+#include <QImage>
 #include <QPixmap>
+#include <QRectF>
 #include <memory>
 
 #include "src/config.h"
@@ -57,6 +59,23 @@ class QtRenderer : public AbstractRenderer
     return doc ? doc->getPng(page, resolution, page_part) : nullptr;
   }
 
+  /// Render only the part rect (in points) of a page to a QImage.
+  /// Resolution is given in pixels per point (dpi/72).
+  const QImage renderImage(const int page, const qreal resolution,
+                           const QRectF &rect) const override
+  {
+    return doc ? doc->getImage(page, resolution, rect) : QImage();
+  }
+
+  /// Render both halves of a page from a single rasterisation.
+  /// Resolution is given in pixels per point (dpi/72).
+  QPair<const PngPixmap *, const PngPixmap *> renderHalvesPng(
+      const int page, const qreal resolution) const override
+  {
+    if (doc) return doc->getHalvesPng(page, resolution);
+    return {nullptr, nullptr};
+  }
+
   /// Check whether doc is valid.
   bool isValid() const override { return doc && doc->isValid(); }
 };
@@ -0,0 +1,267 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/rendering/sharedrendercache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QThread>
+#include <QtDebug>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "src/log.h"
+#include "src/rendering/pdfdocument.h"
+
+namespace
+{
+/// Identifies the segment format. Change this when the layout changes.
+constexpr quint32 segment_magic = 0x42505201;
+
+/// Number of slots in a segment.
+constexpr int slot_count = 1024;
+
+/// Minimum size of a segment in bytes.
+constexpr qint64 min_segment_size = 1 << 20;
+
+/// Age in ms after which a writer lock is considered stale (left by a
+/// process which crashed while writing).
+constexpr qint64 stale_lock = 1000;
+
+/// Time in ms of a clock which is shared by all processes and is not
+/// affected by changes of the system time. Never 0.
+qint64 monotonicTime()
+{
+  // On Linux steady_clock uses CLOCK_MONOTONIC, which counts from boot.
+  const qint64 now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+  return std::max<qint64>(now, 1);
+}
+
+static_assert(std::atomic<quint32>::is_always_lock_free &&
+                  std::atomic<quint64>::is_always_lock_free &&
+                  std::atomic<qint64>::is_always_lock_free,
+              "shared render cache requires lock-free atomics");
+
+/// Table entry for one image.
+struct Slot {
+  /// Sequence number, odd while the slot is being written. It may remain
+  /// odd if a writer crashed.
+  std::atomic<quint64> sequence;
+  /// Age of the entry, larger is newer.
+  quint64 stamp;
+  /// Offset of the data in the data region.
+  quint64 offset;
+  /// Size of the data in bytes, 0 for unused slots.
+  quint32 size;
+  qint32 page;
+  qint32 part;
+  float resolution;
+};
+
+/// Start writing slot: make the sequence number odd. The parity is set
+/// explicitly, because a crashed writer may have left it odd.
+void beginWrite(Slot &slot)
+{
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) | 1,
+                      std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+/// Finish writing slot: make the sequence number even and larger than
+/// before beginWrite().
+void endWrite(Slot &slot)
+{
+  slot.sequence.store((slot.sequence.load(std::memory_order_relaxed) | 1) + 1,
+                      std::memory_order_release);
+}
+}  // namespace
+
+/// Start of the segment. A new segment consists of zeros, which is a valid
+/// empty segment.
+struct SharedRenderCache::Header {
+  /// segment_magic or 0 for a new segment.
+  std::atomic<quint32> magic;
+  /// Time (see monotonicTime()) at which a writer locked the segment, or 0.
+  std::atomic<qint64> writer;
+  /// Offset in the data region at which the next image is written.
+  /// Only accessed by the writer.
+  quint64 next;
+  /// Last stamp given to a slot. Only accessed by the writer.
+  quint64 stamp;
+  Slot slots[slot_count];
+};
+
+SharedRenderCache::SharedRenderCache(const QString &path, const qint64 size)
+    : file(path)
+{
+  if (path.isEmpty()) return;
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  {
+    // Only one process may create and resize the file.
+    QLockFile lock(path + ".lock");
+    if (!lock.tryLock(1000) || !file.open(QIODevice::ReadWrite)) {
+      qWarning() << "Failed to open shared render cache" << path;
+      return;
+    }
+    if (file.size() < min_segment_size &&
+        !file.resize(std::max(size, min_segment_size))) {
+      qWarning() << "Failed to resize shared render cache" << path;
+      return;
+    }
+    removeStaleSegments(path);
+  }
+  if (file.size() <= qint64(sizeof(Header))) return;
+  uchar *const map = file.map(0, file.size());
+  if (!map) {
+    qWarning() << "Failed to map shared render cache" << path;
+    return;
+  }
+  Header *const segment = reinterpret_cast<Header *>(map);
+  quint32 magic = 0;
+  if (!segment->magic.compare_exchange_strong(magic, segment_magic) &&
+      magic != segment_magic) {
+    qWarning() << "Shared render cache has unknown format" << path;
+    file.unmap(map);
+    return;
+  }
+  header = segment;
+  data = map + sizeof(Header);
+  data_size = file.size() - sizeof(Header);
+  debug_msg(DebugCache, "opened shared render cache" << path << data_size);
+}
+
+SharedRenderCache::~SharedRenderCache()
+{
+  if (header) file.unmap(reinterpret_cast<uchar *>(header));
+}
+
+QString SharedRenderCache::segmentPath(const PdfDocument *document)
+{
+  const QString base =
+      QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+  const QFileInfo info(document->getPath());
+  if (base.isEmpty() || !info.exists()) return QString();
+  // The segment changes when the document is modified.
+  return base + "/beamerpresenter/" +
+         QString::fromLatin1(
+             QCryptographicHash::hash(info.absoluteFilePath().toUtf8(),
+                                      QCryptographicHash::Sha1)
+                 .toHex()) +
+         '-' + QString::number(info.lastModified().toMSecsSinceEpoch()) +
+         ".cache";
+}
+
+void SharedRenderCache::removeStaleSegments(const QString &path)
+{
+  // Segments of older versions of the document share the part of the file
+  // name before '-'. Processes which still map such a segment keep their
+  // mapping.
+  const QFileInfo info(path);
+  const QString prefix = info.fileName().section('-', 0, 0) + '-';
+  const QDir dir = info.absoluteDir();
+  const QStringList stale = dir.entryList(
+      {prefix + "*.cache", prefix + "*.cache.lock"}, QDir::Files);
+  for (const QString &name : stale) {
+    if (name == info.fileName() || name == info.fileName() + ".lock") continue;
+    debug_msg(DebugCache, "removing stale shared render cache" << name);
+    QFile::remove(dir.filePath(name));
+  }
+}
+
+bool SharedRenderCache::lockWriter()
+{
+  for (int i = 0; i < 100; ++i) {
+    const qint64 now = monotonicTime();
+    qint64 locked = header->writer.load(std::memory_order_relaxed);
+    if ((locked == 0 || now - locked > stale_lock) &&
+        header->writer.compare_exchange_weak(locked, now,
+                                             std::memory_order_acquire))
+      return true;
+    QThread::yieldCurrentThread();
+  }
+  return false;
+}
+
+void SharedRenderCache::unlockWriter()
+{
+  header->writer.store(0, std::memory_order_release);
+}
+
+QByteArray SharedRenderCache::find(const int page, const PagePart part,
+                                   const qreal resolution,
+                                   const qreal deviation,
+                                   qreal &found_resolution) const
+{
+  if (!header) return QByteArray();
+  for (const Slot &slot : header->slots) {
+    const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+    if ((sequence & 1) || slot.size == 0 || slot.page != page ||
+        slot.part != part || std::abs(slot.resolution - resolution) > deviation)
+      continue;
+    const quint64 offset = slot.offset, size = slot.size;
+    const qreal slot_resolution = slot.resolution;
+    if (offset + size > data_size) continue;
+    QByteArray png(reinterpret_cast<const char *>(data + offset), size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // The slot or its data was changed while copying.
+    if (slot.sequence.load(std::memory_order_relaxed) != sequence) continue;
+    debug_verbose(DebugCache, "found page in shared cache" << page << size);
+    found_resolution = slot_resolution;
+    return png;
+  }
+  return QByteArray();
+}
+
+void SharedRenderCache::insert(const int page, const PagePart part,
+                               const qreal resolution, const QByteArray &png)
+{
+  // Large images would push out too many other images.
+  const quint64 size = png.size();
+  if (!header || size == 0 || size > data_size / 4 || !lockWriter()) return;
+  quint64 offset = header->next;
+  if (offset + size > data_size) offset = 0;
+  // Keep offsets aligned.
+  header->next = (offset + size + 7) & ~quint64(7);
+
+  // Drop slots whose data is overwritten. Choose a slot for the new image:
+  // the slot of the same page, an unused slot, or the oldest slot.
+  Slot *same = nullptr, *oldest = nullptr;
+  for (Slot &slot : header->slots) {
+    if (slot.size > 0 && slot.offset < offset + size &&
+        offset < slot.offset + slot.size) {
+      beginWrite(slot);
+      slot.size = 0;
+      endWrite(slot);
+    }
+    if (slot.size > 0 && slot.page == page && slot.part == part &&
+        slot.resolution == float(resolution))
+      same = &slot;
+    else if (!oldest || (oldest->size > 0 &&
+                         (slot.size == 0 || slot.stamp < oldest->stamp)))
+      oldest = &slot;
+  }
+  Slot *const target = same ? same : oldest;
+
+  beginWrite(*target);
+  std::memcpy(data + offset, png.constData(), size);
+  target->stamp = ++header->stamp;
+  target->offset = offset;
+  target->size = size;
+  target->page = page;
+  target->part = part;
+  target->resolution = float(resolution);
+  endWrite(*target);
+  unlockWriter();
+  debug_verbose(DebugCache, "wrote page to shared cache" << page << size);
+}
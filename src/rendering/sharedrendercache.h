@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef SHAREDRENDERCACHE_H
+#define SHAREDRENDERCACHE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "src/config.h"
+#include "src/enumerates.h"
+
+class PdfDocument;
+
+/**
+ * @brief Render cache shared by several processes showing the same document
+ *
+ * The cache is a memory mapped file in the runtime directory, which is
+ * identified by a hash of the document path and the modification time.
+ * Segments of older versions of the document are removed. It
+ * contains a fixed table of slots followed by a data region for PNG
+ * images. The data region is used as ring buffer: new images are written
+ * behind the last one, and slots whose data is overwritten are dropped.
+ *
+ * Writers are serialized by a lock in the segment. Readers do not lock:
+ * every slot has a sequence number, which is odd while the slot is being
+ * written and is changed before its data is overwritten. A reader copies
+ * the data and accepts it only if the sequence number did not change.
+ *
+ * Objects of this class are not thread safe.
+ */
+class SharedRenderCache
+{
+  struct Header;
+
+  /// Memory mapped file.
+  QFile file;
+
+  /// Header of the mapped segment, nullptr if the segment is not available.
+  Header *header{nullptr};
+
+  /// Start of the data region.
+  uchar *data{nullptr};
+
+  /// Size of the data region in bytes.
+  quint64 data_size = 0;
+
+  /// Lock the segment for writing. Return false if this fails.
+  bool lockWriter();
+
+  /// Release the lock obtained by lockWriter().
+  void unlockWriter();
+
+  /// Remove segments (and their lock files) of other versions of the
+  /// document of the segment at path.
+  static void removeStaleSegments(const QString &path);
+
+ public:
+  /// Open or create the segment at path. size (in bytes) is only used if
+  /// the segment does not exist yet.
+  SharedRenderCache(const QString &path, const qint64 size);
+
+  /// Destructor: unmap the segment. The file is kept for other processes.
+  ~SharedRenderCache();
+
+  /// Path of the segment for document, empty if there is no suitable
+  /// directory. The path changes when the document is modified.
+  static QString segmentPath(const PdfDocument *document);
+
+  /// Path of the segment.
+  QString path() const { return file.fileName(); }
+
+  /// Check whether the segment is mapped.
+  bool isValid() const noexcept { return header != nullptr; }
+
+  /**
+   * Get a copy of the PNG data stored for the given page.
+   * @param page page number
+   * @param part page part
+   * @param resolution resolution in pixels per point
+   * @param deviation maximum allowed deviation of the resolution
+   * @param found_resolution is set to the resolution of the stored image
+   * @return PNG data or empty QByteArray if the page is not available
+   */
+  QByteArray find(const int page, const PagePart part, const qreal resolution,
+                  const qreal deviation, qreal &found_resolution) const;
+
+  /// Store PNG data of a page. This silently fails if the segment is
+  /// locked by another process for too long.
+  void insert(const int page, const PagePart part, const qreal resolution,
+              const QByteArray &png);
+};
+
+#endif  // SHAREDRENDERCACHE_H
@@ -8,21 +8,26 @@
 #include <QClipboard>
 #include <QDataStream>
 #include <QDesktopServices>
+#include <QGraphicsPixmapItem>
 #include <QGraphicsSceneMouseEvent>
 #include <QGraphicsSceneWheelEvent>
 #include <QGuiApplication>
 #include <QMimeData>
 #include <QParallelAnimationGroup>
+#include <QPixmap>
 #include <QPropertyAnimation>
 #include <QRegularExpression>
 #include <QString>
+#include <QStyleOptionGraphicsItem>
 #include <QSvgGenerator>
 #include <QSvgRenderer>
 #include <QTouchEvent>
 #include <QTransform>
 #include <QXmlStreamWriter>
 #include <algorithm>
+#include <cmath>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <utility>
 
@@ -44,9 +49,11 @@
 #include "src/drawing/texttool.h"
 #include "src/log.h"
 #include "src/media/mediaitem.h"
+#include "src/media/mediaproviderpool.h"
 #include "src/pdfmaster.h"
 #include "src/preferences.h"
 #include "src/slideview.h"
+#include "src/tracer.h"
 
 SlideScene::SlideScene(std::shared_ptr<const PdfMaster> master,
                        const PagePart part, QObject *parent)
@@ -77,6 +84,8 @@ SlideScene::SlideScene(std::shared_ptr<const PdfMaster> master,
           &PdfMaster::bringToBackground, Qt::DirectConnection);
   connect(this, &SlideScene::selectionChanged, this,
           &SlideScene::updateSelectionRect, Qt::DirectConnection);
+  connect(master.get(), &PdfMaster::mediaAnnotationsReady, this,
+          &SlideScene::receiveMediaAnnotations);
   pageItem->setZValue(-1e2);
   addItem(&selection_bounding_rect);
   addItem(pageItem);
@@ -95,6 +104,8 @@ SlideScene::~SlideScene()
   delete pageItem;
   delete pageTransitionItem;
   mediaItems.clear();
+  delete shape_recognizer;
+  delete selection_proxy;
   delete currentlyDrawnItem;
   delete currentItemCollection;
 }
@@ -104,6 +115,12 @@ void SlideScene::stopDrawing()
   debug_msg(DebugDrawing | DebugFunctionCalls,
             "Stop drawing" << page << page_part << currentlyDrawnItem
                            << currentItemCollection << this);
+  if (selection_proxy) finishSelectionProxy(nullptr, QPointF());
+  // Add the remaining samples. The item collection is deleted below.
+  if (input_timer) input_timer->stop();
+  addPathSamples(stroke_filter.finish(), false);
+  input_tool.reset();
+  prediction_item = nullptr;
   if (currentlyDrawnItem) {
     BasicGraphicsPath *newpath = nullptr;
     switch (currentlyDrawnItem->type()) {
@@ -111,16 +128,16 @@ void SlideScene::stopDrawing()
       case FullGraphicsPath::Type: {
         AbstractGraphicsPath *path =
             static_cast<AbstractGraphicsPath *>(currentlyDrawnItem);
+        // The recognizer has collected the moments of the path while
+        // drawing. This must be done before finalize() changes the
+        // coordinates.
+        if (shape_recognizer) newpath = shape_recognizer->recognize();
         path->finalize();
         emit sendNewPath({page, page_part}, currentlyDrawnItem);
-        if (path->getTool().shape() == DrawTool::Recognize) {
-          ShapeRecognizer recognizer(path);
-          newpath = recognizer.recognize();
-          if (newpath) {
-            addItem(newpath);
-            emit replacePath({page, page_part}, currentlyDrawnItem, newpath);
-            currentlyDrawnItem = newpath;
-          }
+        if (newpath) {
+          addItem(newpath);
+          emit replacePath({page, page_part}, currentlyDrawnItem, newpath);
+          currentlyDrawnItem = newpath;
         }
         currentlyDrawnItem->show();
         invalidate(currentlyDrawnItem->sceneBoundingRect(),
@@ -169,6 +186,9 @@ void SlideScene::stopDrawing()
       currentlyDrawnItem = nullptr;
     }
   }
+  delete shape_recognizer;
+  shape_recognizer = nullptr;
+  recognition_preview = nullptr;
   if (currentItemCollection) {
     removeItem(currentItemCollection);
     delete currentItemCollection;
@@ -473,9 +493,13 @@ void SlideScene::handleDrawEvents(std::shared_ptr<const DrawTool> tool,
   // TODO: multi-touch for draw tools
   switch (device & Tool::AnyEvent) {
     case Tool::UpdateEvent:
+      if (Tracer::enabled() && trace_input_ns < 0)
+        trace_input_ns = Tracer::now();
       stepInputEvent(tool, pos.constFirst(), pressure);
       break;
     case Tool::StartEvent:
+      if (Tracer::enabled() && trace_input_ns < 0)
+        trace_input_ns = Tracer::now();
       startInputEvent(tool, pos.constFirst(), pressure);
       break;
     case Tool::StopEvent:
@@ -547,6 +571,10 @@ void SlideScene::handleSelectionEvents(std::shared_ptr<SelectionTool> tool,
       handleSelectionStartEvents(tool, single_pos);
       break;
     case Tool::UpdateEvent:
+      if (!selection_proxy && (tool->type() == SelectionTool::Move ||
+                               tool->type() == SelectionTool::Rotate ||
+                               tool->type() == SelectionTool::Resize))
+        startSelectionProxy(tool);
       tool->liveUpdate(single_pos);
       // TODO: select area for higher efficiency
       invalidate(QRectF(), QGraphicsScene::ForegroundLayer);
@@ -601,6 +629,8 @@ void SlideScene::handleSelectionStartEvents(std::shared_ptr<SelectionTool> tool,
                                             const QPointF &pos)
 {
   debug_verbose(DebugFunctionCalls, tool.get() << pos << this);
+  // Clean up if the previous operation was not finished.
+  if (selection_proxy) finishSelectionProxy(nullptr, pos);
   QList<QGraphicsItem *> selection = selectedItems();
   // Check if anything is selected.
   tool->reset();
@@ -680,6 +710,7 @@ void SlideScene::handleSelectionStopEvents(std::shared_ptr<SelectionTool> tool,
     case SelectionTool::Move:
     case SelectionTool::Rotate:
     case SelectionTool::Resize: {
+      if (selection_proxy) finishSelectionProxy(tool, pos);
       const QHash<QGraphicsItem *, QTransform> &originalTransforms =
           tool->originalTransforms();
       if (originalTransforms.count() <= 1) {
@@ -739,6 +770,97 @@ void SlideScene::handleSelectionStopEvents(std::shared_ptr<SelectionTool> tool,
     tool->reset();
 }
 
+void SlideScene::startSelectionProxy(std::shared_ptr<SelectionTool> tool)
+{
+  proxied_items = selectedItems();
+  QRectF rect;
+  for (const auto item : std::as_const(proxied_items))
+    rect = rect.united(item->sceneBoundingRect());
+  qreal resolution = 0.;
+  for (const auto view : static_cast<const QList<QGraphicsView *>>(views()))
+    resolution = std::max(resolution, view->transform().m11());
+  // Items which are blended with the slide, like highlighter strokes, must
+  // be transformed directly. A raster image would cover the slide.
+  const auto blended = [](const QGraphicsItem *item) {
+    return (item->type() == BasicGraphicsPath::Type ||
+            item->type() == FullGraphicsPath::Type) &&
+           static_cast<const AbstractGraphicsPath *>(item)
+                   ->getTool()
+                   .compositionMode() != QPainter::CompositionMode_SourceOver;
+  };
+  if (proxied_items.isEmpty() || rect.isEmpty() || resolution <= 0. ||
+      std::any_of(proxied_items.cbegin(), proxied_items.cend(), blended)) {
+    proxied_items.clear();
+    return;
+  }
+  resolution = std::min(resolution, max_selection_proxy_size /
+                                        std::max(rect.width(), rect.height()));
+  debug_msg(DebugDrawing, "rasterizing selection" << proxied_items.size()
+                                                  << rect << resolution);
+
+  // Paint the items in the order in which they are stacked.
+  std::sort(proxied_items.begin(), proxied_items.end(),
+            [](const QGraphicsItem *a, const QGraphicsItem *b) {
+              return a->zValue() < b->zValue();
+            });
+  QPixmap pixmap(std::ceil(resolution * rect.width()),
+                 std::ceil(resolution * rect.height()));
+  pixmap.fill(Qt::transparent);
+  QPainter painter(&pixmap);
+  painter.setRenderHint(QPainter::Antialiasing);
+  const QTransform scene_to_pixmap =
+      QTransform::fromTranslate(-rect.left(), -rect.top()) *
+      QTransform::fromScale(resolution, resolution);
+  QStyleOptionGraphicsItem style;
+  for (const auto item : std::as_const(proxied_items)) {
+    painter.setTransform(item->sceneTransform() * scene_to_pixmap);
+    item->paint(&painter, &style);
+  }
+  painter.end();
+
+  selection_proxy = new QGraphicsPixmapItem(pixmap);
+  selection_proxy->setTransformationMode(Qt::SmoothTransformation);
+  selection_proxy->setTransform(
+      QTransform::fromScale(1. / resolution, 1. / resolution));
+  selection_proxy->setPos(rect.topLeft());
+  selection_proxy->setZValue(proxied_items.last()->zValue());
+  addItem(selection_proxy);
+  // Hiding the items would deselect them. Transparent items are not
+  // painted.
+  proxied_opacities.clear();
+  for (const auto item : std::as_const(proxied_items)) {
+    proxied_opacities.append(item->opacity());
+    item->setOpacity(0.);
+  }
+  proxied_rect_transform = selection_bounding_rect.transform();
+  proxy_tool = tool;
+  tool->initTransformations({selection_proxy, &selection_bounding_rect});
+}
+
+void SlideScene::finishSelectionProxy(std::shared_ptr<SelectionTool> tool,
+                                      const QPointF &pos)
+{
+  selection_bounding_rect.setTransform(proxied_rect_transform);
+  for (int i = 0; i < proxied_items.size(); ++i)
+    proxied_items[i]->setOpacity(proxied_opacities.value(i, 1.));
+  if (tool) {
+    // Transform the items once, as the raster image was transformed.
+    QList<QGraphicsItem *> items = proxied_items;
+    items.append(&selection_bounding_rect);
+    tool->initTransformations(items);
+    tool->liveUpdate(pos);
+  } else if (proxy_tool) {
+    // The tool must not keep a pointer to selection_proxy.
+    proxy_tool->reset();
+  }
+  removeItem(selection_proxy);
+  delete selection_proxy;
+  selection_proxy = nullptr;
+  proxy_tool.reset();
+  proxied_items.clear();
+  proxied_opacities.clear();
+}
+
 void SlideScene::renderZoom()
 {
   const auto all_views = views();
@@ -925,6 +1047,8 @@ void SlideScene::navigationEvent(const int newslide, const int newpage,
   debug_msg(DebugPageChange | DebugFunctionCalls,
             "scene" << this << "navigates to" << newpage << "as" << newscene);
   pauseMedia();
+  pending_media_page = -1;
+  if (selection_proxy) finishSelectionProxy(nullptr, QPointF());
   clearSelection();
   setFocusItem(nullptr);
   if (pageTransitionItem) {
@@ -976,9 +1100,14 @@ void SlideScene::navigationEvent(const int newslide, const int newpage,
 
 void SlideScene::loadMedia(const int page)
 {
+  pending_media_page = -1;
   if (!(slide_flags & LoadMedia)) return;
-  const QList<std::shared_ptr<MediaAnnotation>> list =
-      master->getDocument()->annotations(page);
+  QList<std::shared_ptr<MediaAnnotation>> list;
+  if (!master->mediaAnnotations(page, list)) {
+    // Media will be loaded in receiveMediaAnnotations.
+    pending_media_page = page;
+    return;
+  }
   for (const auto &annotation : list) {
     debug_msg(DebugMedia,
               "loading media" << annotation->type() << annotation->rect());
@@ -1001,39 +1130,69 @@ void SlideScene::postRendering()
       page + 1;  ///< newpage is the next page after the currently shown page.
   if (shift.overlay != ShiftOverlays::NoOverlay)
     newpage = master->getDocument()->overlaysShifted(page, {1, shift.overlay});
-  if (slide_flags & CacheVideos) cacheMedia(newpage);
-  // Clean up media
-  if (mediaItems.size() > 2) {
-    debug_verbose(DebugMedia, "Start cleaning up media" << mediaItems.size());
-    for (auto &media : mediaItems) {
-      if (!media->pages().empty()) {
-        // Delete media if the media item is not shown on any of these pages:
-        // page (currently shown), newpage, page-1, page-2
-        const auto it = media->pages().lower_bound(page);
-        if ((it != media->pages().end() && (*it == page || *it == newpage)) ||
-            (it != media->pages().begin() && *(std::prev(it)) >= page - 2))
-          continue;
-      }
-      media->deleteProvider();
-    }
+  if (slide_flags & CacheVideos)
+    cacheMedia(newpage);
+  else if (slide_flags & LoadMedia)
+    master->prefetchMediaAnnotations(newpage);
+  if ((slide_flags & LoadMedia) && page > 0)
+    master->prefetchMediaAnnotations(page - 1);
+  // Clean up media: Release providers of media which are not shown on the
+  // current or next page, starting with media far away from the current
+  // page, as long as too many providers are in use.
+  if (!MediaProviderPool::overBudget()) return;
+  debug_verbose(DebugMedia, "Start cleaning up media"
+                                << mediaItems.size()
+                                << MediaProviderPool::active());
+  QList<std::pair<int, MediaItem *>> candidates;
+  for (auto &media : mediaItems) {
+    if (!media->hasProvider()) continue;
+    const auto &pages = media->pages();
+    if (pages.count(page) || pages.count(newpage)) continue;
+    int distance = std::numeric_limits<int>::max();
+    const auto it = pages.lower_bound(page);
+    if (it != pages.end()) distance = *it - page;
+    if (it != pages.begin())
+      distance = std::min(distance, page - *std::prev(it));
+    candidates.append({distance, media.get()});
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &a, const auto &b) { return a.first > b.first; });
+  for (const auto &candidate : std::as_const(candidates)) {
+    if (!MediaProviderPool::overBudget()) break;
+    candidate.second->deleteProvider();
   }
 }
 
 void SlideScene::cacheMedia(const int page)
 {
   debug_verbose(DebugFunctionCalls, page << this);
-  const QList<std::shared_ptr<MediaAnnotation>> list =
-      master->getDocument()->annotations(page);
+  pending_cache_page = -1;
+  QList<std::shared_ptr<MediaAnnotation>> list;
+  if (!master->mediaAnnotations(page, list)) {
+    pending_cache_page = page;
+    return;
+  }
   for (const auto &annotation : list) {
-#if (QT_VERSION_MAJOR >= 6)
-    getMediaItem(annotation, page);
-#else
-    // workaround for strange behavior in Qt 5
     auto &item = getMediaItem(annotation, page);
+#if (QT_VERSION_MAJOR < 6)
+    // workaround for strange behavior in Qt 5
     item->asQGraphicsItem()->setZValue(-1e9);
     addItem(item->asQGraphicsItem());
 #endif
+    // Decode the first frame before the slide is shown.
+    item->preroll();
   }
+  // Keep a spare provider for media on following pages.
+  if (!list.isEmpty()) MediaProviderPool::reserve(1);
+}
+
+void SlideScene::receiveMediaAnnotations(const int page)
+{
+  if (page == pending_media_page && page == this->page)
+    loadMedia(page);
+  else if (page == pending_media_page)
+    pending_media_page = -1;
+  if (page == pending_cache_page) cacheMedia(page);
 }
 
 std::shared_ptr<MediaItem> &SlideScene::getMediaItem(
@@ -1514,6 +1673,11 @@ void SlideScene::startInputEvent(std::shared_ptr<const DrawTool> tool,
       else
         currentlyDrawnItem = new BasicGraphicsPath(*tool, pos);
       currentlyDrawnItem->hide();
+      stroke_filter.start(pos, pressure, preferences()->input_min_distance,
+                          preferences()->input_smoothing);
+      if (tool->shape() == DrawTool::Recognize)
+        shape_recognizer = new ShapeRecognizer(
+            static_cast<AbstractGraphicsPath *>(currentlyDrawnItem));
       break;
     case DrawTool::Rect: {
       RectGraphicsItem *rect_item = new RectGraphicsItem(*tool, pos);
@@ -1554,34 +1718,27 @@ void SlideScene::stepInputEvent(std::shared_ptr<const DrawTool> tool,
                                                  << pressure);
   if (!currentlyDrawnItem) return;
   switch (currentlyDrawnItem->type()) {
-    case BasicGraphicsPath::Type: {
-      if (!currentItemCollection) break;
-      BasicGraphicsPath *current_path =
-          static_cast<BasicGraphicsPath *>(currentlyDrawnItem);
-      if (current_path->getTool() != *tool) break;
-      FlexGraphicsLineItem *item = new FlexGraphicsLineItem(
-          QLineF(current_path->lastPoint(), pos), tool->compositionMode());
-      current_path->addPoint(current_path->mapFromScene(pos));
-      item->setPen(tool->pen());
-      currentItemCollection->addToGroup(item);
-      currentItemCollection->show();
-      invalidate(item->sceneBoundingRect(), QGraphicsScene::ItemLayer);
-      break;
-    }
+    case BasicGraphicsPath::Type:
     case FullGraphicsPath::Type: {
-      if (!currentItemCollection) break;
-      FullGraphicsPath *current_path =
-          static_cast<FullGraphicsPath *>(currentlyDrawnItem);
-      if (current_path->getTool() != *tool) break;
-      FlexGraphicsLineItem *item = new FlexGraphicsLineItem(
-          QLineF(current_path->lastPoint(), pos), tool->compositionMode());
-      current_path->addPoint(current_path->mapFromScene(pos), pressure);
-      QPen pen = tool->pen();
-      pen.setWidthF(pen.widthF() * pressure);
-      item->setPen(pen);
-      currentItemCollection->addToGroup(item);
-      currentItemCollection->show();
-      invalidate(item->sceneBoundingRect(), QGraphicsScene::ItemLayer);
+      if (!currentItemCollection ||
+          static_cast<AbstractGraphicsPath *>(currentlyDrawnItem)
+                  ->getTool() != *tool)
+        break;
+      // Samples are collected and added to the path once per frame.
+      input_tool = tool;
+      stroke_filter.push(pos, pressure);
+      const int interval = preferences()->input_coalesce_interval;
+      if (interval <= 0) {
+        flushInput();
+      } else {
+        if (!input_timer) {
+          input_timer = new QTimer(this);
+          input_timer->setSingleShot(true);
+          connect(input_timer, &QTimer::timeout, this,
+                  &SlideScene::flushInput);
+        }
+        if (!input_timer->isActive()) input_timer->start(interval);
+      }
       break;
     }
     case RectGraphicsItem::Type:
@@ -1600,6 +1757,63 @@ void SlideScene::stepInputEvent(std::shared_ptr<const DrawTool> tool,
   }
 }
 
+void SlideScene::addPathSamples(const QVector<StrokeFilter::Sample> &samples,
+                                const bool predict)
+{
+  if (!currentlyDrawnItem || !currentItemCollection || !input_tool) return;
+  const bool full = currentlyDrawnItem->type() == FullGraphicsPath::Type;
+  if (!full && currentlyDrawnItem->type() != BasicGraphicsPath::Type) return;
+  AbstractGraphicsPath *path =
+      static_cast<AbstractGraphicsPath *>(currentlyDrawnItem);
+  QRectF rect;
+  if (prediction_item) {
+    rect = prediction_item->sceneBoundingRect();
+    delete prediction_item;
+    prediction_item = nullptr;
+  }
+  QPen pen = input_tool->pen();
+  for (const auto &sample : samples) {
+    FlexGraphicsLineItem *item =
+        new FlexGraphicsLineItem(QLineF(path->lastPoint(), sample.pos),
+                                 input_tool->compositionMode());
+    if (full) {
+      static_cast<FullGraphicsPath *>(path)->addPoint(
+          path->mapFromScene(sample.pos), sample.pressure);
+      pen.setWidthF(input_tool->width() * sample.pressure);
+    } else
+      static_cast<BasicGraphicsPath *>(path)->addPoint(
+          path->mapFromScene(sample.pos));
+    item->setPen(pen);
+    currentItemCollection->addToGroup(item);
+    rect = rect.united(item->sceneBoundingRect());
+  }
+  if (predict && shape_recognizer && !samples.isEmpty()) {
+    // Show the shape which would be recognized if the stroke ended here.
+    if (recognition_preview) {
+      rect = rect.united(recognition_preview->sceneBoundingRect());
+      delete recognition_preview;
+    }
+    recognition_preview = shape_recognizer->recognize();
+    if (recognition_preview) {
+      recognition_preview->setOpacity(0.5);
+      currentItemCollection->addToGroup(recognition_preview);
+      rect = rect.united(recognition_preview->sceneBoundingRect());
+    }
+  }
+  const int prediction = preferences()->input_prediction;
+  if (predict && prediction > 0 && !samples.isEmpty()) {
+    prediction_item = new FlexGraphicsLineItem(
+        QLineF(path->lastPoint(), stroke_filter.predict(prediction)),
+        input_tool->compositionMode());
+    prediction_item->setPen(pen);
+    currentItemCollection->addToGroup(prediction_item);
+    rect = rect.united(prediction_item->sceneBoundingRect());
+  }
+  currentItemCollection->show();
+  // Invalidate once for all samples of this frame.
+  if (!rect.isNull()) invalidate(rect, QGraphicsScene::ItemLayer);
+}
+
 bool SlideScene::stopInputEvent(std::shared_ptr<const DrawTool> tool)
 {
   debug_verbose(DebugFunctionCalls, tool.get() << this);
@@ -1884,6 +2098,7 @@ void SlideScene::pasteFromClipboard()
 void SlideScene::toolChanged(std::shared_ptr<Tool> tool) noexcept
 {
   debug_verbose(DebugFunctionCalls, tool.get() << this);
+  if (selection_proxy) finishSelectionProxy(nullptr, QPointF());
   if (!tool ||
       (tool->tool() & (Tool::AnySelectionTool | Tool::AnyPointingTool)))
     return;
@@ -23,6 +23,7 @@
 #endif
 #endif
 #include "src/drawing/selectionrectitem.h"
+#include "src/drawing/strokefilter.h"
 #include "src/drawing/textgraphicsitem.h"
 #include "src/drawing/tool.h"
 #include "src/enumerates.h"
@@ -33,6 +34,7 @@
 class QAbstractAnimation;
 class QGraphicsItem;
 class QGraphicsRectItem;
+class QGraphicsPixmapItem;
 class PdfMaster;
 class DrawTool;
 class TextTool;
@@ -45,6 +47,9 @@ class PixmapGraphicsItem;
 class QPropertyAnimation;
 class QXmlStreamReader;
 class AbstractGraphicsPath;
+class FlexGraphicsLineItem;
+class ShapeRecognizer;
+class BasicGraphicsPath;
 
 namespace drawHistory
 {
@@ -99,6 +104,46 @@ class SlideScene : public QGraphicsScene
   /// instead.
   QGraphicsItemGroup *currentItemCollection{nullptr};
 
+  /// Filter for samples of the currently drawn freehand path.
+  StrokeFilter stroke_filter;
+
+  /// Tool of the samples in stroke_filter.
+  std::shared_ptr<const DrawTool> input_tool;
+
+  /// Timer for adding collected samples to the currently drawn path.
+  QTimer *input_timer{nullptr};
+
+  /// Predicted continuation of the currently drawn path, part of
+  /// currentItemCollection.
+  FlexGraphicsLineItem *prediction_item{nullptr};
+
+  /// Shape recognizer for the currently drawn path if it uses the shape
+  /// DrawTool::Recognize, nullptr otherwise. Owned by this.
+  ShapeRecognizer *shape_recognizer{nullptr};
+
+  /// Preview of the shape recognized in the currently drawn path, part of
+  /// currentItemCollection.
+  BasicGraphicsPath *recognition_preview{nullptr};
+
+  /// Maximum width and height of selection_proxy in pixels.
+  static constexpr int max_selection_proxy_size = 4096;
+
+  /// Raster image of the selected items, which is transformed instead of
+  /// these items while moving, rotating or resizing a selection.
+  QGraphicsPixmapItem *selection_proxy{nullptr};
+
+  /// Selected items which are hidden behind selection_proxy.
+  QList<QGraphicsItem *> proxied_items;
+
+  /// Opacities of proxied_items before they were hidden.
+  QList<qreal> proxied_opacities;
+
+  /// Tool which transforms selection_proxy.
+  std::shared_ptr<SelectionTool> proxy_tool;
+
+  /// Transform of selection_bounding_rect before selection_proxy was created.
+  QTransform proxied_rect_transform;
+
   /// Searched results which should be highlighted
   /// This item gets many rectangles as child objects.
   QGraphicsItemGroup *searchResults{nullptr};
@@ -114,6 +159,11 @@ class SlideScene : public QGraphicsScene
   /// List of (cached or active) video items.
   QList<std::shared_ptr<MediaItem>> mediaItems;
 
+  /// Pages for which loadMedia and cacheMedia wait for media annotations,
+  /// or -1.
+  int pending_media_page = -1;
+  int pending_cache_page = -1;
+
   /// PDF document, including drawing paths.
   /// This is const, all data sent to master should be send via signals.
   std::shared_ptr<const PdfMaster> master;
@@ -127,6 +177,10 @@ class SlideScene : public QGraphicsScene
   /// FirstOverlay and LastOverlay.
   PageShift shift = {0, ShiftOverlays::NoOverlay};
 
+  /// Time (Tracer::now()) of the first input event which has not been
+  /// painted yet, -1 if there is none. Only used when tracing is enabled.
+  qint64 trace_input_ns = -1;
+
   /// Currently visible page.
   int page = 0;
 
@@ -238,6 +292,17 @@ class SlideScene : public QGraphicsScene
   /// video items on all slides (cached or active).
   QList<std::shared_ptr<MediaItem>> &getMedia() noexcept { return mediaItems; }
 
+  /// Check whether a slide transition is running.
+  bool inTransition() const noexcept { return animation != nullptr; }
+
+  /// Return and reset the time of the first unpainted input event.
+  qint64 takeInputTime() noexcept
+  {
+    const qint64 time = trace_input_ns;
+    trace_input_ns = -1;
+    return time;
+  }
+
   /// Get current page item (the pixmap graphics item showing the current page)
   PixmapGraphicsItem *pageBackground() const noexcept { return pageItem; }
 
@@ -312,6 +377,14 @@ class SlideScene : public QGraphicsScene
   /// Finish handling draw and erase events.
   bool stopInputEvent(std::shared_ptr<const DrawTool> tool);
 
+  /// Add samples collected in stroke_filter to the currently drawn path.
+  void flushInput() { addPathSamples(stroke_filter.take(), true); }
+
+  /// Add samples to the currently drawn path and show them.
+  /// @param predict show predicted continuation of the path
+  void addPathSamples(const QVector<StrokeFilter::Sample> &samples,
+                      const bool predict);
+
   /// Check if currently text is beeing edited.
   bool isTextEditing() const noexcept
   {
@@ -378,6 +451,14 @@ class SlideScene : public QGraphicsScene
   /// Handle selection stop events (only called from handleEvents().
   void handleSelectionStopEvents(std::shared_ptr<SelectionTool> tool,
                                  const QPointF &pos, const QPointF &start_pos);
+  /// Rasterize the selected items at view resolution and transform only the
+  /// raster image in the live updates of tool.
+  void startSelectionProxy(std::shared_ptr<SelectionTool> tool);
+  /// Apply the transformation of tool at pos to the selected items and
+  /// remove selection_proxy. If tool is nullptr, the transformation is
+  /// cancelled and the items are restored.
+  void finishSelectionProxy(std::shared_ptr<SelectionTool> tool,
+                            const QPointF &pos);
 
  public slots:
   /// Stop drawing and convert just drawn path to regular path.
@@ -392,6 +473,10 @@ class SlideScene : public QGraphicsScene
   /// Load media for given page to cache.
   void cacheMedia(const int page);
 
+  /// Media annotations of page have been read in the background. Load or
+  /// cache media if they were requested for page.
+  void receiveMediaAnnotations(const int page);
+
   /// Tasks done after rendering: load media for next page to cache.
   void postRendering();
 
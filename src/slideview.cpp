@@ -19,6 +19,7 @@
 #include "src/preferences.h"
 #include "src/rendering/pixcache.h"
 #include "src/slidescene.h"
+#include "src/tracer.h"
 
 SlideView::SlideView(SlideScene *scene, const PixCache *cache, QWidget *parent)
     : QGraphicsView(scene, parent)
@@ -68,6 +69,7 @@ void SlideView::pageChanged(const int page, SlideScene *scene)
   resetTransform();
   scale(resolution, resolution);
   waitingForPage = page;
+  if (Tracer::enabled()) traceNavigation();
   debug_msg(DebugPageChange, "Request page" << page << "by" << this << "from"
                                             << scene << "with size"
                                             << scene->pageSize() << size());
@@ -88,6 +90,7 @@ void SlideView::pageChangedBlocking(const int page, SlideScene *scene)
   if (resolution < 1e-6 || resolution > 1e6) return;
   resetTransform();
   scale(resolution, resolution);
+  if (Tracer::enabled()) traceNavigation();
   QPixmap pixmap;
   debug_msg(DebugPageChange, "Request page blocking" << page << this);
   emit getPixmapBlocking(page, pixmap, resolution);
@@ -105,6 +108,42 @@ void SlideView::pageReady(const QPixmap pixmap, const int page)
   }
 }
 
+void SlideView::traceNavigation() noexcept
+{
+  // Resize events also call pageChanged. These are not counted as
+  // navigation if Master has not marked a new navigation since.
+  const qint64 time = Tracer::navigationTime();
+  if (time != trace_last_navigation_ns)
+    trace_navigation_ns = trace_last_navigation_ns = time;
+}
+
+void SlideView::paintEvent(QPaintEvent *event)
+{
+  if (!Tracer::enabled()) {
+    QGraphicsView::paintEvent(event);
+    return;
+  }
+  SlideScene *slidescene = static_cast<SlideScene *>(scene());
+  const int page = slidescene ? slidescene->getPage() : -1;
+  const bool transition = slidescene && slidescene->inTransition();
+  // Interval between the starts of two frames of a slide transition.
+  if (transition && trace_frame_ns >= 0)
+    Tracer::complete("frame interval", "paint", trace_frame_ns, page);
+  const qint64 start = Tracer::now();
+  trace_frame_ns = transition ? start : -1;
+  QGraphicsView::paintEvent(event);
+  Tracer::complete(transition ? "transition frame" : "paint", "paint", start,
+                   page);
+  if (!slidescene) return;
+  // The page turn is finished when the rendered page has been painted.
+  if (trace_navigation_ns >= 0 && waitingForPage == INT_MAX) {
+    Tracer::complete("page turn", "navigation", trace_navigation_ns, page);
+    trace_navigation_ns = -1;
+  }
+  Tracer::complete("input to ink", "input", slidescene->takeInputTime(),
+                   page);
+}
+
 void SlideView::resizeEvent(QResizeEvent *event)
 {
   if (event->size().isNull()) return;
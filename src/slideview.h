@@ -14,6 +14,7 @@
 #include "src/media/mediaslider.h"
 
 class QResizeEvent;
+class QPaintEvent;
 class QGestureEvent;
 class PointingTool;
 class PixCache;
@@ -54,6 +55,19 @@ class SlideView : public QGraphicsView
   /// Currently waiting for page: INT_MAX if not waiting for any page.
   int waitingForPage = INT_MAX;
 
+  /// Start of the navigation which has not been painted yet, -1 if none.
+  /// Only used when tracing is enabled.
+  qint64 trace_navigation_ns = -1;
+
+  /// Latest navigation time handled by this view.
+  qint64 trace_last_navigation_ns = -1;
+
+  /// Time of the latest painted transition frame, -1 outside transitions.
+  qint64 trace_frame_ns = -1;
+
+  /// Take start time of a navigation from Tracer.
+  void traceNavigation() noexcept;
+
   /// Show slide transitions, multimedia, etc. (all not implemented yet).
   ViewFlags view_flags = {ShowAll ^ MediaControls};
 
@@ -117,6 +131,9 @@ class SlideView : public QGraphicsView
   /// Handle key events: send them to Master.
   void keyPressEvent(QKeyEvent *event) override;
 
+  /// Paint view. Records frame times if tracing is enabled.
+  void paintEvent(QPaintEvent *event) override;
+
  public slots:
   /// Inform this that the page number has changed.
   void pageChanged(const int page, SlideScene *scene);
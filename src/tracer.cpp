@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#include "src/tracer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QVector>
+#include <utility>
+
+namespace
+{
+/// Maximum number of recorded events (about 20MB).
+constexpr int max_events = 1 << 19;
+
+/// Recorded event.
+struct Event {
+  const char *name;
+  const char *category;
+  qint64 start_ns;
+  /// Duration in ns, -1 for instant events.
+  qint64 duration_ns;
+  /// Index in thread_names.
+  int thread;
+  int page;
+};
+
+/// Clock started when tracing is enabled.
+QElapsedTimer clock;
+/// Mutex for all following variables.
+QMutex mutex;
+QVector<Event> events;
+QMap<QByteArray, Tracer::Statistics> event_statistics;
+QHash<Qt::HANDLE, int> thread_indices;
+QList<QByteArray> thread_names;
+qint64 dropped = 0;
+/// Start of the latest navigation, not protected by mutex.
+std::atomic<qint64> navigation_ns{-1};
+
+/// Index of the current thread in thread_names. mutex must be locked.
+int threadIndex()
+{
+  const Qt::HANDLE handle = QThread::currentThreadId();
+  const auto it = thread_indices.constFind(handle);
+  if (it != thread_indices.cend()) return *it;
+  const QThread *thread = QThread::currentThread();
+  QByteArray name = thread->objectName().toUtf8();
+  if (name.isEmpty())
+    name = thread == QCoreApplication::instance()->thread()
+               ? "main"
+               : thread->metaObject()->className();
+  const int index = thread_names.size();
+  thread_names.append(name + ' ' + QByteArray::number(index));
+  thread_indices.insert(handle, index);
+  return index;
+}
+
+void record(const Event &event)
+{
+  mutex.lock();
+  Tracer::Statistics &stats = event_statistics[event.name];
+  ++stats.count;
+  if (event.duration_ns >= 0) {
+    stats.total_ns += event.duration_ns;
+    stats.last_ns = event.duration_ns;
+    if (event.duration_ns > stats.max_ns) stats.max_ns = event.duration_ns;
+  }
+  if (events.size() < max_events) {
+    events.append(event);
+    events.last().thread = threadIndex();
+  } else
+    ++dropped;
+  mutex.unlock();
+}
+
+/// Format time given in ns in µs for the JSON file.
+QByteArray micro(const qint64 ns)
+{
+  return QByteArray::number(1e-3 * ns, 'f', 3);
+}
+}  // namespace
+
+void Tracer::enable()
+{
+  if (enabled()) return;
+  clock.start();
+  _enabled.store(true);
+}
+
+qint64 Tracer::now() noexcept { return clock.nsecsElapsed(); }
+
+void Tracer::complete(const char *name, const char *category,
+                      const qint64 start_ns, const int page)
+{
+  if (!enabled() || start_ns < 0) return;
+  record({name, category, start_ns, now() - start_ns, 0, page});
+}
+
+void Tracer::instant(const char *name, const char *category, const int page)
+{
+  if (!enabled()) return;
+  record({name, category, now(), -1, 0, page});
+}
+
+void Tracer::markNavigation(const qint64 time_ns) noexcept
+{
+  navigation_ns.store(time_ns);
+}
+
+qint64 Tracer::navigationTime() noexcept
+{
+  const qint64 time = navigation_ns.load();
+  return time >= 0 ? time : now();
+}
+
+QList<QPair<QByteArray, Tracer::Statistics>> Tracer::statistics()
+{
+  QList<QPair<QByteArray, Statistics>> list;
+  mutex.lock();
+  for (auto it = event_statistics.cbegin(); it != event_statistics.cend();
+       ++it)
+    list.append({it.key(), *it});
+  mutex.unlock();
+  return list;
+}
+
+qint64 Tracer::droppedEvents()
+{
+  mutex.lock();
+  const qint64 number = dropped;
+  mutex.unlock();
+  return number;
+}
+
+bool Tracer::writeJson(const QString &filename)
+{
+  QSaveFile file(filename);
+  if (!file.open(QFile::WriteOnly)) return false;
+  const QByteArray pid =
+      QByteArray::number(QCoreApplication::applicationPid());
+  mutex.lock();
+  file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (int i = 0; i < thread_names.size(); ++i)
+    file.write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+               ",\"tid\":" + QByteArray::number(i) + ",\"args\":{\"name\":\"" +
+               thread_names[i] + "\"}},\n");
+  for (const auto &event : std::as_const(events)) {
+    QByteArray line = QByteArray("{\"name\":\"") + event.name +
+                      "\",\"cat\":\"" + event.category + "\",\"ts\":" +
+                      micro(event.start_ns);
+    if (event.duration_ns >= 0)
+      line += ",\"ph\":\"X\",\"dur\":" + micro(event.duration_ns);
+    else
+      line += ",\"ph\":\"i\",\"s\":\"t\"";
+    line += ",\"pid\":" + pid + ",\"tid\":" + QByteArray::number(event.thread);
+    if (event.page >= 0)
+      line += ",\"args\":{\"page\":" + QByteArray::number(event.page) + '}';
+    file.write(line + "},\n");
+  }
+  // Metadata event at the end avoids a trailing comma.
+  file.write("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid +
+             ",\"args\":{\"name\":\"beamerpresenter\"}}\n]}\n");
+  mutex.unlock();
+  return file.commit();
+}
@@ -0,0 +1,117 @@
+// SPDX-FileCopyrightText: 2026 Valentin Bruch <software@vbruch.eu>
+// SPDX-License-Identifier: GPL-3.0-or-later OR AGPL-3.0-or-later
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <atomic>
+
+#include "src/config.h"
+
+/**
+ * @brief Timing instrumentation for rendering, navigation and drawing
+ *
+ * Records timed events (spans with start and duration) and instant events,
+ * for example the time from a navigation key press to the first painted
+ * pixel of each SlideView, cache hits and misses, render and encode times
+ * of cache jobs, frame times of slide transitions and the latency from an
+ * input event to the painted ink.
+ *
+ * The events can be written to a JSON file in Chrome trace format, which
+ * can be viewed in chrome://tracing or https://ui.perfetto.dev. Statistics
+ * of all events are shown by TraceHud.
+ *
+ * Tracing is disabled by default. When it is disabled, enabled() is the
+ * only function which should be called. All functions are thread safe.
+ * Names and categories of events must be string literals.
+ */
+class Tracer
+{
+  inline static std::atomic<bool> _enabled{false};
+
+ public:
+  /// Statistics of all events with the same name.
+  struct Statistics {
+    /// Number of events.
+    qint64 count = 0;
+    /// Sum of durations in ns.
+    qint64 total_ns = 0;
+    /// Duration of the latest event in ns.
+    qint64 last_ns = 0;
+    /// Maximum duration in ns.
+    qint64 max_ns = 0;
+  };
+
+  Tracer() = delete;
+
+  /// Check whether tracing is enabled.
+  static bool enabled() noexcept
+  {
+    return _enabled.load(std::memory_order_relaxed);
+  }
+
+  /// Enable tracing and start the clock.
+  static void enable();
+
+  /// Time in ns since tracing was enabled.
+  static qint64 now() noexcept;
+
+  /// Record event from start_ns to now.
+  /// @param page page number or -1
+  static void complete(const char *name, const char *category,
+                       const qint64 start_ns, const int page = -1);
+
+  /// Record instant event (only counted in statistics).
+  static void instant(const char *name, const char *category,
+                      const int page = -1);
+
+  /// Set the start time of the latest navigation.
+  static void markNavigation(const qint64 time_ns) noexcept;
+
+  /// Start time of the latest navigation.
+  static qint64 navigationTime() noexcept;
+
+  /// Statistics of all event names, sorted by name.
+  static QList<QPair<QByteArray, Statistics>> statistics();
+
+  /// Number of events which were not recorded because the maximum number
+  /// of events was reached. Statistics include these events.
+  static qint64 droppedEvents();
+
+  /// Write all events to file in Chrome trace format.
+  /// @return true on success
+  static bool writeJson(const QString &filename);
+};
+
+/**
+ * @brief Record the lifetime of this object as a Tracer event
+ *
+ * Does nothing if tracing is disabled.
+ */
+class TraceSpan
+{
+  const char *name;
+  const char *category;
+  const int page;
+  const qint64 start_ns;
+
+ public:
+  TraceSpan(const char *name, const char *category, const int page = -1)
+      : name(name),
+        category(category),
+        page(page),
+        start_ns(Tracer::enabled() ? Tracer::now() : -1)
+  {
+  }
+
+  ~TraceSpan()
+  {
+    if (start_ns >= 0) Tracer::complete(name, category, start_ns, page);
+  }
+};
+
+#endif  // TRACER_H